@@ -17,6 +17,14 @@
 #include "lmc/specs.h"
 #include "lmc/computer.h"
 #include "lmc/compiler.h"
+#include "lmc/daemon.h"
+#include "lmc/batch.h"
+#include "lmc/shard.h"
+#include "lmc/archive.h"
+#include "lmc/trace.h"
+#include "lmc/metrics.h"
+#include "lmc/timings.h"
+#include "lmc/library.h"
 
 #include <argp.h>
 #include <stdio.h>
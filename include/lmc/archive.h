@@ -0,0 +1,167 @@
+/**
+ * @file      archive.h
+ * @version   0.1.0
+ * @brief     LMC compiled programs archives.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup Archive
+ * @{
+ *
+ * An archive stores many compiled programs in one file, to be mapped
+ * in memory at once. All its integers are 32 bits little-endian:
+ *
+ * - the header: the #LMC_ARCHIVEMAGIC magic number, the format
+ *   version, the number of entries and the names table size;
+ * - the index of the entries, sorted by name: the name offset in the
+ *   names table, the image offset in the archive, the image size and
+ *   its FNV-1a hash;
+ * - the names table, of null-terminated names;
+ * - the programs images, identical images being stored once.
+ */
+
+#ifndef LMC_ARCHIVE_H_
+#define LMC_ARCHIVE_H_
+
+#include "lmc/specs.h"
+#include "lmc/binary.h"
+
+#include <endian.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @def LMC_ARCHIVEMAGIC
+ * @since 0.1.0
+ * @brief The archives magic number.
+ */
+#define LMC_ARCHIVEMAGIC "LMCA"
+
+/**
+ * @enum LmcArchiveCaracs
+ * @since 0.1.0
+ * @brief The archives characteristics.
+ */
+typedef enum LmcArchiveCaracs {
+    LMC_ARCHIVEVERSION = 1, /**< The archive format version. */
+} LmcArchiveCaracs;
+
+/**
+ * @struct LmcArchiveHeader
+ * @since 0.1.0
+ * @brief The archive header, as stored.
+ */
+typedef struct LmcArchiveHeader {
+    char magic[4];    /**< #LMC_ARCHIVEMAGIC. */
+    uint32_t version; /**< #LMC_ARCHIVEVERSION. */
+    uint32_t count;   /**< The number of entries. */
+    uint32_t names;   /**< The names table size. */
+} LmcArchiveHeader;
+
+/**
+ * @struct LmcArchiveEntry
+ * @since 0.1.0
+ * @brief An archive index entry, as stored.
+ */
+typedef struct LmcArchiveEntry {
+    uint32_t name;   /**< The name offset in the names table. */
+    uint32_t offset; /**< The image offset in the archive. */
+    uint32_t size;   /**< The image size. */
+    uint32_t hash;   /**< The image FNV-1a hash. */
+} LmcArchiveEntry;
+
+/**
+ * @struct LmcArchive
+ * @since 0.1.0
+ * @brief An opened archive.
+ */
+typedef struct LmcArchive {
+    const unsigned char* data;    /**< The mapped archive. */
+    size_t size;                  /**< The archive size. */
+    size_t count;                 /**< The number of entries. */
+    const LmcArchiveEntry* index; /**< The entries index. */
+    const char* names;            /**< The names table. */
+} LmcArchive;
+
+/**
+ * @since 0.1.0
+ * @brief Store compiled programs in an archive.
+ *
+ * The entries are named after the files base names. This function may
+ * raise a fatal error if a file cannot be read or written, or if two
+ * files have the same base name.
+ *
+ * @param path The archive file path, replaced if it exists.
+ * @param count The number of programs.
+ * @param files The compiled programs file paths.
+ * @return @c EXIT_SUCCESS.
+ */
+int lmc_pack(const char* restrict path, size_t count, char* const* files) __attribute__((nonnull (1)));
+
+/**
+ * @since 0.1.0
+ * @brief Extract the programs of an archive.
+ *
+ * This function may raise a fatal error if the archive cannot be
+ * read, or a program cannot be written.
+ *
+ * @param path The archive file path.
+ * @param directory The destination directory.
+ * @return @c EXIT_FAILURE if an image does not match its hash (it is
+ * extracted anyway), otherwise @c EXIT_SUCCESS.
+ */
+int lmc_unpack(const char* restrict path, const char* restrict directory) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Map an archive in memory.
+ *
+ * This function may raise a fatal error if the archive cannot be
+ * read, or if it is malformed.
+ *
+ * @param path The archive file path.
+ * @return The archive, to close with lmc_archiveClose().
+ */
+LmcArchive* lmc_archiveOpen(const char* restrict path) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Unmap an archive.
+ * @param archive The archive.
+ */
+void lmc_archiveClose(LmcArchive* archive);
+
+/**
+ * @since 0.1.0
+ * @brief Get the name of an archive entry.
+ * @param archive The archive.
+ * @param index The entry index, lesser than LmcArchive::count.
+ * @return The entry name.
+ */
+const char* lmc_archiveName(const LmcArchive* archive, size_t index) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Find an archive entry image.
+ * @param archive The archive.
+ * @param name The entry name.
+ * @param size The image size destination.
+ * @return The image, in the archive mapping, or @c NULL if @p name is
+ * not in the archive.
+ */
+const LmcRam* lmc_archiveFind(const LmcArchive* archive, const char* restrict name, size_t* restrict size) __attribute__((nonnull));
+
+#endif // LMC_ARCHIVE_H_
+/** @} */
@@ -0,0 +1,137 @@
+/**
+ * @file      batch.h
+ * @version   0.1.0
+ * @brief     LMC parallel batch runner.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup Batch
+ * @{
+ */
+
+#ifndef LMC_BATCH_H_
+#define LMC_BATCH_H_
+
+#include "lmc/specs.h"
+#include "lmc/computer.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @struct LmcJob
+ * @since 0.1.0
+ * @brief A batch program execution.
+ */
+typedef struct LmcJob {
+    const char* program;  /**< The compiled program file path. */
+    const char* input;    /**< The program input file path (hexadecimal
+                           * words, as in interactive mode), or @c NULL
+                           * for no input. */
+    const char* expected; /**< The expected output file path, or
+                           * @c NULL to skip the check. */
+} LmcJob;
+
+/**
+ * @since 0.1.0
+ * @brief Read a batch manifest.
+ *
+ * Each line of the manifest describes a job by its program, input and
+ * expected output file paths, separated by blanks. The last two are
+ * optional, and @c - stands for a missing one. Blank lines and lines
+ * starting with @c # are ignored. This function may raise a fatal
+ * error if the manifest cannot be read or is malformed.
+ *
+ * @param path The manifest file path, @c "-" for the standard input.
+ * @param count The number of jobs destination.
+ * @return The jobs, to free with lmc_manifestFree().
+ */
+LmcJob* lmc_manifest(const char* restrict path, size_t* restrict count) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Read jobs from an opened manifest.
+ *
+ * See lmc_manifest() for the format.
+ *
+ * @param file The manifest.
+ * @param path The manifest name, for the error messages.
+ * @param max The max number of jobs to read, @c 0 to read up to the
+ * end of @p file.
+ * @param count The number of jobs destination.
+ * @return The jobs, to free with lmc_manifestFree().
+ */
+LmcJob* lmc_manifestRead(FILE* file, const char* restrict path, size_t max, size_t* restrict count) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Free jobs read by lmc_manifest().
+ * @param jobs The jobs.
+ * @param count The number of jobs.
+ */
+void lmc_manifestFree(LmcJob* jobs, size_t count);
+
+/**
+ * @since 0.1.0
+ * @brief Execute programs in parallel.
+ *
+ * The jobs are shared between @p workers threads; a worker which has
+ * run its own jobs steals the remaining ones of the others. The
+ * programs output is captured without prompts, and the results are
+ * written on the standard output as they come, in the jobs order, as
+ * JSON lines:
+ *
+ * @code{.json}
+ * {"program":"product","status":0,"output":"18","cycles":42,"time":0.000012,"pass":true}
+ * @endcode
+ *
+ * The @c status is @c null if @p limit is reached, and @c pass is
+ * only given for the jobs with an expected output. A job whose
+ * program, bootstrap, input or expected output cannot be loaded only
+ * gets a @c null status and an @c error message:
+ *
+ * @code{.json}
+ * {"program":"foobar","status":null,"error":"foobar: No such file or directory"}
+ * @endcode
+ *
+ * This function may raise a fatal error if a worker cannot be started.
+ *
+ * @param bootstrap The compiled bootstrap file path.
+ * @param jobs The jobs.
+ * @param count The number of jobs.
+ * @param workers The number of worker threads, @c 0 for one per
+ * online processor.
+ * @param limit The max number of instructions of each program, @c 0
+ * for no limit.
+ * @param pinned Pin each worker to one of the processors the process
+ * is allowed to run on.
+ * @return @c EXIT_FAILURE if a program output differs from the
+ * expected one, reaches @p limit or cannot be executed, otherwise
+ * @c EXIT_SUCCESS.
+ */
+int lmc_batch(const char* restrict bootstrap, const LmcJob* jobs, size_t count, size_t workers, size_t limit, bool pinned);
+
+/**
+ * @since 0.1.0
+ * @brief Write a JSON string.
+ *
+ * The control and non-ASCII bytes are escaped as is (as Latin-1
+ * characters).
+ *
+ * @param file The destination.
+ * @param string The string bytes.
+ * @param size The string size.
+ */
+void lmc_json(FILE* file, const char* restrict string, size_t size) __attribute__((nonnull));
+
+#endif // LMC_BATCH_H_
+/** @} */
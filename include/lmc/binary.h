@@ -0,0 +1,155 @@
+/**
+ * @file      binary.h
+ * @version   0.1.0
+ * @brief     LMC compiled programs formats.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup Binary
+ * @{
+ *
+ * Two compiled programs formats are loadable:
+ *
+ * - the version 1, a bare header of the start address and the program
+ *   size (see #LmcCompileHeader) followed by the program, fed to the
+ *   bootstrap;
+ * - the version 2, starting with #LMC_BINMAGIC and placed in memory
+ *   by the host, the bootstrap being skipped: the #LmcBinaryHeader,
+ *   the table of the #LmcSegment, then the segments contents, in the
+ *   table order.
+ *
+ * The bytes following a program in its file are the first input of
+ * the program, in both formats.
+ */
+
+#ifndef LMC_BINARY_H_
+#define LMC_BINARY_H_
+
+#include "lmc/specs.h"
+#include "lmc/error.h"
+
+#include <endian.h>
+#include <err.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @enum LmcCompileHeader
+ * @since 0.1.0
+ * @brief Version 1 programs header structure indexes.
+ */
+typedef enum LmcCompileHeader {
+    LMC_STARTPOS = 0, /**< Start address. */
+    LMC_SIZE,         /**< Program size. */
+    LMC_MAXHEADER,    /**< Header max size. */
+} LmcCompileHeader;
+
+/**
+ * @def LMC_BINMAGIC
+ * @since 0.1.0
+ * @brief The version 2 programs magic number.
+ *
+ * A version 1 program cannot start with it, as it would overflow the
+ * memory.
+ */
+#define LMC_BINMAGIC "\xffLMC"
+
+/**
+ * @enum LmcBinaryCaracs
+ * @since 0.1.0
+ * @brief The compiled programs characteristics.
+ */
+typedef enum LmcBinaryCaracs {
+    LMC_BINVERSION  = 2,    /**< The compiled programs format version. */
+    LMC_MAXSEGMENTS = 0xff, /**< Max number of segments. */
+} LmcBinaryCaracs;
+
+/**
+ * @struct LmcBinaryHeader
+ * @since 0.1.0
+ * @brief The version 2 programs header, as stored.
+ */
+typedef struct __attribute__((packed)) LmcBinaryHeader {
+    char magic[4];     /**< #LMC_BINMAGIC. */
+    LmcRam version;    /**< #LMC_BINVERSION. */
+    LmcRam entry;      /**< The program entry point. */
+    LmcRam count;      /**< The number of segments. */
+    uint32_t checksum; /**< The lmc_checksum() of the segments table
+                        * and contents, little-endian. */
+} LmcBinaryHeader;
+
+/**
+ * @struct LmcSegment
+ * @since 0.1.0
+ * @brief A version 2 program segment, as stored.
+ */
+typedef struct LmcSegment {
+    LmcRam address; /**< The segment load address. */
+    LmcRam size;    /**< The segment size. */
+} LmcSegment;
+
+/**
+ * @def LMC_MAXBINARY
+ * @since 0.1.0
+ * @brief Max size of a version 2 program.
+ */
+#define LMC_MAXBINARY (sizeof(LmcBinaryHeader) + LMC_MAXSEGMENTS * sizeof(LmcSegment) + LMC_MAXRAM)
+
+/**
+ * @struct LmcBinary
+ * @since 0.1.0
+ * @brief A validated version 2 program.
+ */
+typedef struct LmcBinary {
+    LmcRam entry;               /**< The program entry point. */
+    size_t count;               /**< The number of segments. */
+    const LmcSegment* segments; /**< The segments table. */
+    const LmcRam* contents;     /**< The segments contents. */
+    size_t size;                /**< The program size, header
+                                 * included. */
+} LmcBinary;
+
+/**
+ * @since 0.1.0
+ * @brief Compute the FNV-1a hash of bytes.
+ * @param data The bytes.
+ * @param size The number of bytes.
+ * @return The hash.
+ */
+uint32_t lmc_checksum(const LmcRam* data, size_t size);
+
+/**
+ * @since 0.1.0
+ * @brief Compute the size of a version 2 program, as far as its first
+ * bytes tell.
+ * @param data The program first bytes.
+ * @param size The number of bytes.
+ * @return The size of the header, or of the header and segments table,
+ * or of the whole program, depending on the known part; @p size is
+ * enough once this value is reached.
+ */
+size_t lmc_binarySize(const LmcRam* data, size_t size) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Validate a version 2 program.
+ *
+ * A warning is printed if the program is truncated, corrupted, of an
+ * unknown version, or if a segment overflows the memory.
+ *
+ * @param path The program file path, for the warnings.
+ * @param data The program file content.
+ * @param size The program file size.
+ * @param binary The program description destination.
+ * @return @c 0 if @p data is not a version 2 program, @c -1 if it is
+ * invalid, otherwise @c 1.
+ */
+int lmc_binaryRead(const char* restrict path, const LmcRam* data, size_t size, LmcBinary* binary) __attribute__((nonnull));
+
+#endif // LMC_BINARY_H_
+/** @} */
@@ -16,23 +16,14 @@
 
 #include "lmc/specs.h"
 #include "lmc/lexer.h"
+#include "lmc/binary.h"
+#include "lmc/timings.h"
 
 #include <err.h>
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-/**
- * @enum LmcCompileHeader
- * @since 0.1.0
- * @brief Programs header structure indexes.
- */
-typedef enum LmcCompileHeader {
-    LMC_STARTPOS = 0, /**< Start address. */
-    LMC_SIZE,         /**< Program size. */
-    LMC_MAXHEADER,    /**< Header max size. */
-} LmcCompileHeader;
-
 /**
  * @def LMC_EXT
  * @since 0.1.0
@@ -57,5 +48,19 @@ typedef enum LmcCompileHeader {
  */
 int lmc_compile(const char* source, const char* dest) __attribute__((nonnull (1)));
 
+/**
+ * @since 0.1.0
+ * @brief Map the addresses of a compiled program to its source lines.
+ *
+ * The source is parsed as by lmc_compile(), without writing the
+ * compiled file.
+ *
+ * @param source The source file path.
+ * @param lines The source line of each address destination, of
+ * #LMC_MAXRAM values, @c 0 for the addresses without code.
+ * @return non-null in case of errors, otherwise @c 0.
+ */
+int lmc_sourceLines(const char* source, unsigned int* lines) __attribute__((nonnull));
+
 #endif // LMC_COMPILER_H_
 /** @} */
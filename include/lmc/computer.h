@@ -15,14 +15,33 @@
 #define LMC_COMPUTER_H_
 
 #include "lmc/specs.h"
+#include "lmc/archive.h"
+#include "lmc/binary.h"
+#include "lmc/error.h"
+#include "lmc/trace.h"
+#include "lmc/metrics.h"
+#include "lmc/timings.h"
 
+#include <ctype.h>
 #include <err.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
 #include <unistd.h>
 
 // clang-format off
@@ -43,6 +62,9 @@ typedef struct LmcMemory {
         LmcRam wr;          /**< Word Register. */
         LmcRam sr;          /**< Selection Register. */
     } cache;                /**< Memory cache. */
+    unsigned int top;       /**< End of the section writable by the
+                             * plain writes: the stack limit, or
+                             * #LMC_MAXRAM if no stack is reserved. */
     LmcRam ram[LMC_MAXRAM]; /**< Random Access Memory. */
 } LmcMemory;
 
@@ -57,6 +79,10 @@ typedef struct LmcControlUnit {
         LmcRam ad; /**< ADdress register. */
     } ir;          /**< Instructions Register. */
     LmcRam pc;     /**< Program Counter. */
+    LmcRam sp;     /**< Stack Pointer (next free stack slot). */
+    LmcRam sl;     /**< Stack Limit (lowest stack address, @c 0 if
+                    * no stack is reserved). */
+    LmcRam ix;     /**< IndeX register (X). */
 } LmcControlUnit;
 
 /**
@@ -67,8 +93,93 @@ typedef struct LmcControlUnit {
 typedef struct LmcLogicUnit {
     LmcRam acc;    /**< ACCumulator. */
     LmcRam opcode; /**< OPerations Code register. */
+    LmcRam carry;  /**< CARRY flag, or borrow flag for the
+                    * substractions. */
 } LmcLogicUnit;
 
+/**
+ * @struct LmcIo
+ * @since 0.1.0
+ * @brief Caller-supplied input and output devices.
+ */
+typedef struct LmcIo {
+    /**
+     * Read at most @c size bytes of input in @c dest, returning the
+     * number of bytes read, @c 0 at the end of the input. The input is
+     * empty if @c NULL.
+     */
+    size_t (*read)(void* context, LmcRam* dest, size_t size);
+    /**
+     * Write @c size bytes of output, returning the number of bytes
+     * written; the computer is shut down if less. The output is
+     * discarded if @c NULL.
+     */
+    size_t (*write)(void* context, const char* data, size_t size);
+    void* context; /**< The callbacks first argument. */
+    bool binary;   /**< Read raw bytes (@c true) or whitespace-separated
+                    * hexadecimal words (@c false). */
+} LmcIo;
+
+/**
+ * @struct LmcStream
+ * @since 0.1.0
+ * @brief A non-interactive data input stream.
+ *
+ * The stream is read by large chunks in a ring buffer.
+ */
+typedef struct LmcStream {
+    int fd;                      /**< The stream file descriptor, or
+                                  * @c -1 if unused. */
+    const LmcIo* io;             /**< The callbacks replacing
+                                  * LmcStream::fd, or @c NULL. */
+    bool binary;                 /**< Raw bytes (@c true) or
+                                  * whitespace-separated hexadecimal
+                                  * words (@c false). */
+    bool prompt;                 /**< Print the prompts (the stream is
+                                  * a terminal). */
+    size_t head;                 /**< Next byte to read. */
+    size_t tail;                 /**< Next byte to fill. */
+    LmcRam ring[LMC_STREAMBUF];  /**< The ring buffer. */
+} LmcStream;
+
+/**
+ * @struct LmcProgram
+ * @since 0.1.0
+ * @brief A compiled program file, loaded at once in memory.
+ */
+typedef struct LmcProgram {
+    const LmcRam* data; /**< The file content, or @c NULL once read. */
+    size_t size;        /**< The file size. */
+    size_t pos;         /**< Next byte to read. */
+    bool mapped;        /**< The content is mapped (@c true) or
+                         * allocated (@c false). */
+    bool archived;      /**< The content belongs to the archive set
+                         * by lmc_setArchive(), thus is not released. */
+} LmcProgram;
+
+/**
+ * @struct LmcRing
+ * @since 0.1.0
+ * @brief A single-producer/single-consumer lock-free ring connecting
+ * two pipeline stages.
+ *
+ * The indexes are free-running, and each one is written by only one
+ * end; they are kept on separate cache lines. An end waiting on the
+ * other polls the ring #LMC_RINGSPIN times, yielding in between, then
+ * sleeps on the LmcRing::event futex.
+ */
+typedef struct LmcRing {
+    size_t head __attribute__((aligned(LMC_CACHELINE))); /**< Next word
+                                                           * to read. */
+    size_t tail __attribute__((aligned(LMC_CACHELINE))); /**< Next word
+                                                           * to write. */
+    bool closed;                  /**< One of the ends is gone. */
+    uint32_t event;               /**< Incremented to wake up the
+                                   * sleeping end. */
+    uint32_t waiters;             /**< Number of sleeping ends. */
+    LmcRam words[LMC_PIPEBUF];    /**< The ring buffer. */
+} LmcRing;
+
 /**
  * @struct Bus
  * @since 0.1.0
@@ -76,9 +187,29 @@ typedef struct LmcLogicUnit {
  */
 typedef struct LmcBus {
     FILE* input;        /**< The computer input device. */
+    LmcProgram program; /**< The compiled program, read before
+                         * LmcBus::input. */
     FILE* output;       /**< The computer output device. */
     const char* prompt; /**< The command line prompt. */
+    LmcStream* data;    /**< Non-interactive data input replacing the
+                         * user input, or @c NULL. */
+    LmcRing* pipein;    /**< Previous pipeline stage output replacing
+                         * the user input, or @c NULL. */
+    LmcRing* pipeout;   /**< Next pipeline stage input replacing
+                         * LmcBus::output, or @c NULL. */
+    struct LmcSession* session; /**< The session replacing the user
+                                 * input and LmcBus::output, or
+                                 * @c NULL. */
+    const LmcIo* io;    /**< The callbacks replacing LmcBus::output,
+                         * or @c NULL. */
+    size_t resume;      /**< Block words already transferred by a
+                         * suspended session. */
     LmcRam buffer;      /**< A one-byte buffer between IO and memory. */
+    struct {
+        char data[LMC_BUSBUF]; /**< Pending output. */
+        size_t size;           /**< Pending output size. */
+    } outbuf;           /**< Output buffer, flushed on input, shutdown,
+                         * or when full. */
 } LmcBus;
 
 /**
@@ -92,6 +223,88 @@ typedef struct LmcDebugger {
     LmcRam opcode; /**< Debugger OPeration Code register. */
 } LmcDebugger;
 
+#ifdef _STATS
+
+/**
+ * @enum LmcStatsFormat
+ * @since 0.1.0
+ * @brief The execution statistics report formats.
+ */
+typedef enum LmcStatsFormat {
+    LMC_STATSOFF,  /**< No report. */
+    LMC_STATSTEXT, /**< One counter per line. */
+    LMC_STATSJSON, /**< A JSON object on one line. */
+} LmcStatsFormat;
+
+/**
+ * @struct LmcStats
+ * @since 0.1.0
+ * @brief The execution statistics of a program, only available if
+ * the #_STATS macro is defined.
+ *
+ * The memory accesses include the instructions fetches, and the
+ * failed accesses are not counted.
+ */
+typedef struct LmcStats {
+    size_t cycles;              /**< Instructions executed, the debugger
+                                 * commands excluded. */
+    size_t opcodes[LMC_MAXRAM]; /**< Instructions executed per opcode,
+                                 * thus per operation and indirection
+                                 * level. */
+    size_t reads;               /**< Memory bytes read. */
+    size_t writes;              /**< Memory bytes written. */
+    size_t faults;              /**< ROM protection faults. */
+    size_t inputs;              /**< IN, INS and INSB instructions. */
+    size_t outputs;             /**< OUT, OUTS and OUTSB instructions. */
+    size_t taken;               /**< Conditional branches taken. */
+    size_t untaken;             /**< Conditional branches not taken. */
+    size_t selfmod;             /**< Bytes written at an address
+                                 * previously fetched as an
+                                 * instruction. */
+    size_t ucodes;              /**< Microcodes executed, only counted
+                                 * if the #_UCODES macro is defined. */
+    double seconds;             /**< Host time between the boot and the
+                                 * shutdown. */
+} LmcStats;
+
+#endif // _STATS
+
+#ifdef _HOOKS
+
+/**
+ * @struct LmcHooks
+ * @since 0.1.0
+ * @brief The instrumentation callbacks of a computer, only available
+ * if the #_HOOKS macro is defined.
+ *
+ * Each callback is optional, and receives LmcHooks::context first.
+ * The memory accesses are reported before they happen, the failed
+ * ones excluded. The instructions of a suspended session report their
+ * fetch and operand once, but their memory accesses again when
+ * restarted.
+ */
+typedef struct LmcHooks {
+    void* context; /**< The callbacks context. */
+    void (*fetch)(void* context, LmcRam pc);
+    /**< An instruction is about to be fetched at @c pc, the debugger
+     * commands excluded. */
+    void (*operand)(void* context, LmcRam opcode, LmcRam address, LmcRam value);
+    /**< The operand of the @c opcode instruction is resolved: its
+     * @c address after indirection, and the @c value read there. */
+    void (*read)(void* context, unsigned int address, size_t length);
+    /**< A memory section is read. */
+    void (*write)(void* context, unsigned int address, size_t length);
+    /**< A memory section is written. */
+    void (*input)(void* context, const LmcRam* words, size_t size);
+    /**< Words are read from the bus, the compiled program excluded. */
+    void (*output)(void* context, const LmcRam* words, size_t size);
+    /**< Words are output by the program (by #OUT, #OUTS or #OUTSB). */
+    void (*halt)(void* context, LmcRam status);
+    /**< The computer stops with the word register @c status. */
+} LmcHooks;
+
+#endif // _HOOKS
+
 /**
  * @struct LmcComputer
  * @since 0.1.0
@@ -105,8 +318,62 @@ typedef struct LmcComputer {
     LmcDebugger dbg;   /**< DeBuGger. */
     bool on;           /**< flag indicating of the computer is on, or
                         * (if @c false) in shutdown process/off. */
+    LmcTrace* trace;   /**< The execution trace, or @c NULL if not
+                        * traced. */
+#ifdef _STATS
+    LmcStats stats;        /**< STATiSticS of the execution. */
+    bool code[LMC_MAXRAM]; /**< The addresses fetched as instructions
+                            * (operation or argument). */
+    struct timespec start; /**< The boot time, zeroed once stopped. */
+    const char* path;      /**< The program file path, or @c NULL. */
+    struct LmcProfile* profile; /**< The execution profile, or @c NULL
+                                 * if not profiled. */
+#endif
+#ifdef _HOOKS
+    LmcHooks hooks;        /**< The instrumentation callbacks. */
+#endif
 } LmcComputer;
 
+/**
+ * @struct LmcSession
+ * @since 0.1.0
+ * @brief A suspendable computer, reading and writing on non-blocking
+ * file descriptors.
+ *
+ * The session runs until its input is empty or its output is full,
+ * then its instruction is rolled back and it waits for
+ * LmcSession::events.
+ */
+typedef struct LmcSession {
+    LmcComputer vm;   /**< The suspended computer. */
+    int in;           /**< The input file descriptor. */
+    int out;          /**< The output file descriptor. */
+    short events;     /**< The poll(2) events the session waits for,
+                       * @c 0 once stopped. */
+    bool eof;         /**< The input end is reached. */
+    bool prompted;    /**< The prompt of the next input is written. */
+    bool report;      /**< Write the status after the output at
+                       * shutdown. */
+    bool sized;       /**< The program image size is known. */
+    bool header;      /**< A header line holding the instructions
+                       * limit precedes the program image. */
+    size_t image;     /**< Bytes of the binary program image still to
+                       * read before the hexadecimal input (set it to
+                       * the header size, @c 2, to read an image). */
+    LmcRam* binary;   /**< The version 2 program image being read, or
+                       * @c NULL. */
+    size_t loaded;    /**< Bytes of LmcSession::binary read. */
+    size_t limit;     /**< Max number of instructions, @c 0 for no
+                       * limit. */
+    size_t steps;     /**< Number of instructions executed. */
+    size_t invalid;   /**< Number of invalid input words read. */
+    bool suspended;   /**< The current instruction is suspended, and
+                       * restarted at the next resume. */
+    bool stopped;     /**< The program is stopped and counted. */
+    size_t size;      /**< Pending input size. */
+    LmcRam input[LMC_SESSIONBUF]; /**< Pending input. */
+} LmcSession;
+
 // clang-format off
 
 /******************************************************************************
@@ -117,7 +384,8 @@ typedef struct LmcComputer {
  * @param filepath The compiled program to run. @c NULL indicate to
  * swtch to in interactive mode where the user must enter the program
  * manually.
- * @param bootstrap A compiled bootstrap file path.
+ * @param bootstrap A compiled bootstrap file path, or @c NULL for the
+ * default bootstrap.
  * @return The word register value at shutdown.
  ******************************************************************************/
 // clang-format on
@@ -141,6 +409,230 @@ LmcRam lmc_shell(const char* restrict bootstrap, const char* restrict filepath);
  */
 LmcRam lmc_dbgShell(const char* restrict bootstrap, const char* restrict filepath);
 
+/**
+ * @since 0.1.0
+ * @brief Execute a compiled program image through callbacks.
+ *
+ * The program is executed without the debugger, reading its input with
+ * @p io (without prompts) and writing its output with it. This
+ * function may raise a fatal error if the bootstrap or the program
+ * cannot be loaded.
+ *
+ * @param bootstrap The compiled bootstrap file path, or @c NULL for
+ * the default bootstrap.
+ * @param program The compiled program image, which must stay valid
+ * during the execution.
+ * @param size The image size.
+ * @param io The input and output callbacks.
+ * @param limit Max number of instructions, @c 0 for no limit; a
+ * warning is reported if it is reached.
+ * @return The word register value at shutdown.
+ */
+LmcRam lmc_execute(const char* restrict bootstrap, const LmcRam* program, size_t size, const LmcIo* io, size_t limit)
+    __attribute__((nonnull (2, 4)));
+
+/**
+ * @since 0.1.0
+ * @brief Stop the statistics and the trace of an execution of this
+ * thread interrupted by a caught fatal error.
+ *
+ * Nothing is done for the ones already stopped.
+ */
+void lmc_abort(void);
+
+/**
+ * @since 0.1.0
+ * @brief Read the programs data from a non-interactive stream instead
+ * of the user input, for all the following programs.
+ *
+ * The prompts are only printed if the stream is a terminal. This
+ * function may raise a fatal error if @p path cannot be opened.
+ *
+ * @param path The data file path, @c "-" for the standard input, or
+ * @c NULL to switch back to the user input.
+ * @param binary Read raw bytes (@c true) instead of
+ * whitespace-separated hexadecimal words (@c false).
+ */
+void lmc_setData(const char* restrict path, bool binary);
+
+/**
+ * @since 0.1.0
+ * @brief Replay the input recorded in a trace instead of the user
+ * input, for all the following programs, until lmc_setData() is
+ * called.
+ *
+ * This function may raise a fatal error if the trace cannot be read.
+ *
+ * @param trace The trace file path.
+ * @param program The traced program file path destination, of
+ * @c PATH_MAX bytes, empty if unknown.
+ */
+void lmc_setReplay(const char* restrict trace, char* restrict program) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Load a bootstrap once for all the following programs.
+ *
+ * The bootstrap is otherwise loaded by the first program using it;
+ * preloading it before forking shares it between the processes. This
+ * function may raise a fatal error if the bootstrap cannot be loaded.
+ *
+ * @param bootstrap The compiled bootstrap file path.
+ */
+void lmc_preload(const char* restrict bootstrap) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Look the programs up in an archive before the file system,
+ * for all the following programs.
+ *
+ * A program path naming an archive entry is executed directly from
+ * the archive mapping, which must stay open while programs run.
+ *
+ * @param archive The archive, or @c NULL to stop using it.
+ */
+void lmc_setArchive(const LmcArchive* archive);
+
+/**
+ * @since 0.1.0
+ * @brief Trace all the following programs, except the sessions.
+ *
+ * The first trace is written at @p path, and the next ones at @p path
+ * followed by their number (@c path.2, @c path.3...), until the next
+ * call. The debugger
+ * commands are not traced, but their input is.
+ *
+ * @param path The traces file path, or @c NULL to stop tracing.
+ */
+void lmc_setTrace(const char* restrict path);
+
+#ifdef _STATS
+
+/**
+ * @since 0.1.0
+ * @brief Report the execution statistics of all the following
+ * programs on the standard error at their shutdown.
+ *
+ * Only available if the #_STATS macro is defined.
+ *
+ * @param format The report format, #LMC_STATSOFF to stop reporting.
+ */
+void lmc_setStats(LmcStatsFormat format);
+
+/**
+ * @since 0.1.0
+ * @brief Profile all the following programs, and write their profiles
+ * in the callgrind format at their shutdown.
+ *
+ * Only available if the #_STATS macro is defined. The first profile
+ * is written at @p path, and the next ones at @p path followed by
+ * their number (@c path.2, @c path.3...). The addresses are mapped to
+ * the lines of the program source if it is found next to the program
+ * file, with the #LMC_EXT extension.
+ *
+ * @param path The profiles file path, or @c NULL to stop profiling.
+ */
+void lmc_setProfile(const char* restrict path);
+
+/**
+ * @since 0.1.0
+ * @brief Get the execution statistics of the last program executed
+ * by the calling thread.
+ *
+ * Only available if the #_STATS macro is defined. The statistics of a
+ * session are in its LmcComputer::stats; the instructions of a
+ * suspended session are counted once, even if restarted.
+ *
+ * @param dest The statistics destination.
+ */
+void lmc_getStats(LmcStats* dest) __attribute__((nonnull));
+
+#endif // _STATS
+
+#ifdef _HOOKS
+
+/**
+ * @since 0.1.0
+ * @brief Instrument all the following programs booted by the calling
+ * thread.
+ *
+ * Only available if the #_HOOKS macro is defined. Each computer keeps
+ * the callbacks set at its boot: a session keeps the ones of the
+ * thread which opened it, and the pipeline stages the ones of the
+ * thread which started the pipeline.
+ *
+ * @param hooks The callbacks, copied, or @c NULL to stop
+ * instrumenting.
+ */
+void lmc_setHooks(const LmcHooks* hooks);
+
+#endif // _HOOKS
+
+/**
+ * @since 0.1.0
+ * @brief Execute compiled programs as a pipeline.
+ *
+ * Each program runs on its own thread, and its output words are the
+ * input of the next one, without formatting. The first program reads
+ * the usual input, and the last one writes on the standard output. A
+ * program stops when its input pipe is empty and the previous one has
+ * stopped, or when the next one has stopped.
+ *
+ * @param bootstrap The compiled bootstrap file path.
+ * @param count The number of programs; @c 0 switches to interactive
+ * mode.
+ * @param files The file paths of the compiled programs.
+ * @return The word register value at the last program shutdown.
+ */
+LmcRam lmc_pipeline(const char* restrict bootstrap, size_t count, char* const* files);
+
+/**
+ * @since 0.1.0
+ * @brief Start a session executing a compiled program.
+ *
+ * The session reads the user input from @p in and writes its output
+ * on @p out, both switched to non-blocking mode; they are not closed
+ * by the session. This function may raise a fatal error if the
+ * session cannot be allocated or the files cannot be opened.
+ *
+ * @param bootstrap The compiled bootstrap file path.
+ * @param filepath The file path of the compiled program. @c NULL
+ * switches to interactive mode (manual programmation).
+ * @param in,out The input and output file descriptors.
+ * @return The session, to free with lmc_sessionClose().
+ */
+LmcSession* lmc_sessionOpen(const char* restrict bootstrap, const char* restrict filepath, int in, int out);
+
+/**
+ * @since 0.1.0
+ * @brief Execute a session until it is suspended or stopped.
+ * @param session The session.
+ * @return @c true if the session is suspended, waiting for
+ * LmcSession::events, @c false once it is stopped.
+ */
+bool lmc_sessionResume(LmcSession* session) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Free a session.
+ * @param session The session.
+ * @return The word register value at the session shutdown.
+ */
+LmcRam lmc_sessionClose(LmcSession* session) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Execute sessions until they are all stopped.
+ *
+ * The sessions are shared between @p threads host threads, each one
+ * resuming its sessions when their file descriptors are ready.
+ *
+ * @param sessions The sessions.
+ * @param count The number of sessions.
+ * @param threads The number of host threads.
+ */
+void lmc_schedule(LmcSession* const* sessions, size_t count, size_t threads);
+
 // clang-format off
 /******************************************************************************
  * @}
@@ -0,0 +1,76 @@
+/**
+ * @file      daemon.h
+ * @version   0.1.0
+ * @brief     LMC execution daemon.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup Daemon
+ * @{
+ */
+
+#ifndef LMC_DAEMON_H_
+#define LMC_DAEMON_H_
+
+#include "lmc/specs.h"
+#include "lmc/computer.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @since 0.1.0
+ * @brief Execute the programs sent on a Unix domain socket.
+ *
+ * Each connection is a session: the client sends a header line, the
+ * compiled program image in binary, then the program input in
+ * hexadecimal (as typed in interactive mode, without prompts), and
+ * receives the program output as it is produced. At shutdown, the
+ * daemon sends a new line, the program status (or @c -- if the limit
+ * is reached) and a new line, then closes the connection.
+ *
+ * The header line holds the instructions limit of the program in
+ * decimal, lowered to @p limit if greater; an empty line or @c 0
+ * selects @p limit. An invalid header closes the connection without
+ * status.
+ *
+ * The sessions are shared between @p workers threads, each one
+ * resuming its sessions from an epoll(7) event loop, and a long
+ * computation yields to the other sessions of its thread every
+ * #LMC_SESSIONSLICE instructions. With
+ * @p processes, the threads are run by as many forked processes
+ * sharing the socket, and a process stopped by a fatal error only
+ * drops its own connections: the daemon restarts it. The bootstrap is
+ * loaded before, thus once for all the processes.
+ *
+ * This function only returns on errors, and may raise a fatal error
+ * if the socket cannot be created or the bootstrap cannot be loaded.
+ *
+ * @param path The socket path, replaced if it exists.
+ * @param bootstrap The compiled bootstrap file path.
+ * @param processes The number of worker processes, @c 0 to run the
+ * workers in the calling process.
+ * @param workers The number of worker threads (per process), @c 0 for
+ * one per online processor.
+ * @param limit The max number of instructions of each program, @c 0
+ * for the default (16777216 instructions).
+ * @return non-null in case of errors.
+ */
+int lmc_daemon(const char* restrict path, const char* restrict bootstrap, size_t processes, size_t workers, size_t limit)
+    __attribute__((nonnull (1)));
+
+#endif // LMC_DAEMON_H_
+/** @} */
@@ -0,0 +1,102 @@
+/**
+ * @file      error.h
+ * @version   0.1.0
+ * @brief     LMC errors reporting.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup Error
+ * @{
+ *
+ * The messages are printed on the standard error as by err(3) and
+ * warn(3), and the fatal errors exit the process, except on a thread
+ * catching them with lmc_catch(): the messages are then recorded, and
+ * the fatal errors jump back to the catching function.
+ */
+
+#ifndef LMC_ERROR_H_
+#define LMC_ERROR_H_
+
+#include <err.h>
+#include <errno.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @def LMC_MAXERROR
+ * @since 0.1.0
+ * @brief Max size of the recorded messages, terminating null byte
+ * included.
+ */
+#define LMC_MAXERROR 256
+
+/**
+ * @struct LmcError
+ * @since 0.1.0
+ * @brief A recorded message.
+ */
+typedef struct LmcError {
+    int code;                   /**< The errno(3) value of the message,
+                                 * @c 0 if none. */
+    char message[LMC_MAXERROR]; /**< The message, empty if none. */
+} LmcError;
+
+/**
+ * @since 0.1.0
+ * @brief Catch the messages and fatal errors of the calling thread.
+ * @param handler The jump buffer set by setjmp(3) in the catching
+ * function, which must not have returned, or @c NULL to stop catching.
+ * @param error The messages destination.
+ */
+void lmc_catch(jmp_buf* handler, LmcError* error);
+
+/**
+ * @since 0.1.0
+ * @brief Report a message followed by the errno(3) description, as
+ * warn(3).
+ * @param format The message printf(3) format, or @c NULL.
+ */
+void lmc_warn(const char* restrict format, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * @since 0.1.0
+ * @brief Report a message, as warnx(3).
+ * @param format The message printf(3) format.
+ */
+void lmc_warnx(const char* restrict format, ...) __attribute__((format(printf, 1, 2), nonnull (1)));
+
+/**
+ * @since 0.1.0
+ * @brief Report a message as is, on its own line.
+ * @param format The message printf(3) format.
+ */
+void lmc_notice(const char* restrict format, ...) __attribute__((format(printf, 1, 2), nonnull (1)));
+
+/**
+ * @since 0.1.0
+ * @brief Raise a fatal error, as err(3) with an #EXIT_FAILURE status.
+ * @param format The message printf(3) format, or @c NULL.
+ */
+void lmc_err(const char* restrict format, ...) __attribute__((format(printf, 1, 2), noreturn));
+
+/**
+ * @since 0.1.0
+ * @brief Raise a fatal error, as errx(3) with an #EXIT_FAILURE status.
+ * @param format The message printf(3) format.
+ */
+void lmc_errx(const char* restrict format, ...) __attribute__((format(printf, 1, 2), noreturn, nonnull (1)));
+
+/**
+ * @since 0.1.0
+ * @brief Raise a fatal error already reported.
+ */
+void lmc_exit(void) __attribute__((noreturn));
+
+#endif // LMC_ERROR_H_
+/** @} */
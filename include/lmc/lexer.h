@@ -15,6 +15,7 @@
 #define LMC_LEXER_H_
 
 #include "lmc/specs.h"
+#include "lmc/error.h"
 
 #include <ctype.h>
 #include <err.h>
@@ -75,6 +76,7 @@ extern FILE* yyin;
 extern char* yytext;
 extern int yylineno;
 int yylex(void);
+void yyrestart(FILE* file);
 int yyerror(LmcLexer* lexer, const char* restrict msg) __attribute__((nonnull));
 int yyparse(LmcLexer* lexer);
 /** }@ */
@@ -96,6 +98,16 @@ LmcOpCodes lmc_opcode(char* keyword) __attribute__((nonnull));
  */
 const char* lmc_keyword(LmcOpCodes opcode) __attribute__((returns_nonnull));
 
+/**
+ * @since 0.1.0
+ * @brief Name an opcode by its keywords, the invalid operations by
+ * their bytecode.
+ * @param dest The name destination, of at least 16 bytes.
+ * @param opcode The opcode, indirection included.
+ * @return @p dest.
+ */
+char* lmc_opname(char* restrict dest, LmcRam opcode) __attribute__((nonnull));
+
 /**
  * @since 0.1.0
  * @brief Add  the instruction couple (@p code, @p value) in the
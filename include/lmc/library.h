@@ -0,0 +1,67 @@
+/**
+ * @file      library.h
+ * @version   0.1.0
+ * @brief     LMC embedding interface, the public header of liblmc.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup Library
+ * @{
+ *
+ * The library functions never exit the process: their fatal errors
+ * are returned, and their messages are recorded instead of printed.
+ * They may be called concurrently from several threads, except
+ * lmc_libCompile(), the compiler being single-threaded.
+ */
+
+#ifndef LMC_LIBRARY_H_
+#define LMC_LIBRARY_H_
+
+#include "lmc/specs.h"
+#include "lmc/error.h"
+#include "lmc/computer.h"
+#include "lmc/compiler.h"
+
+/**
+ * @struct LmcRun
+ * @since 0.1.0
+ * @brief A program execution request.
+ */
+typedef struct LmcRun {
+    const char* bootstrap; /**< The compiled bootstrap file path, or
+                            * @c NULL for the default bootstrap. */
+    const LmcRam* program; /**< The compiled program image. */
+    size_t size;           /**< The image size. */
+    LmcIo io;              /**< The input and output callbacks. */
+    size_t limit;          /**< Max number of instructions, @c 0 for
+                            * no limit. */
+} LmcRun;
+
+/**
+ * @since 0.1.0
+ * @brief Execute a compiled program image.
+ * @param run The execution request.
+ * @param status The word register value at shutdown destination.
+ * @param error The last message destination; its code is #ETIME if
+ * the instructions limit is reached.
+ * @return @c -1 in case of fatal error, described by @p error,
+ * otherwise @c 0.
+ */
+int lmc_libRun(const LmcRun* run, LmcRam* status, LmcError* error) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Compile a source file.
+ * @param source The source file path.
+ * @param dest The compiled file path, defaults to #LMC_BIN if @c NULL.
+ * @param error The last message destination.
+ * @return @c -1 in case of error, described by @p error, otherwise
+ * @c 0.
+ */
+int lmc_libCompile(const char* restrict source, const char* restrict dest, LmcError* error)
+    __attribute__((nonnull (1, 3)));
+
+#endif // LMC_LIBRARY_H_
+/** @} */
@@ -0,0 +1,127 @@
+/**
+ * @file      metrics.h
+ * @version   0.1.0
+ * @brief     LMC live metrics.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup Metrics
+ * @{
+ *
+ * The metrics count the programs executed by the process, and are
+ * exported in the Prometheus text format while they run. Each thread
+ * counts in its own slot, on its own cache line, and the slots are
+ * summed by the exporter with atomic loads: exporting never stops the
+ * execution.
+ */
+
+#ifndef LMC_METRICS_H_
+#define LMC_METRICS_H_
+
+#include "lmc/specs.h"
+
+#include <err.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @enum LmcMetric
+ * @since 0.1.0
+ * @brief The counters.
+ */
+typedef enum LmcMetric {
+    LMC_MCOMPLETED,    /**< Programs stopped with a null status. */
+    LMC_MFAILED,       /**< Programs stopped with another status, or
+                        * by the instructions limit. */
+    LMC_MINSTRUCTIONS, /**< Instructions executed. */
+    LMC_MINPUT,        /**< Bytes read from the bus, the compiled
+                        * programs excluded. */
+    LMC_MOUTPUT,       /**< Bytes written on the bus. */
+    LMC_METRICS,       /**< Number of counters. */
+} LmcMetric;
+
+/**
+ * @enum LmcMetricsCaracs
+ * @since 0.1.0
+ * @brief The metrics characteristics.
+ */
+typedef enum LmcMetricsCaracs {
+    LMC_METRICSLOTS  = 256,     /**< Number of threads slots, released
+                                 * at the threads exit; the threads
+                                 * beyond share the last one. */
+    LMC_METRICSTEP   = 1 << 16, /**< The instructions are counted by
+                                 * steps of this size while a program
+                                 * runs. */
+    LMC_METRICSDELAY = 10,      /**< Default delay between two exports
+                                 * (seconds). */
+} LmcMetricsCaracs;
+
+/**
+ * @since 0.1.0
+ * @brief Increase a counter of the calling thread.
+ * @param metric The counter.
+ * @param n The increment.
+ */
+void lmc_metricsAdd(LmcMetric metric, size_t n);
+
+/**
+ * @since 0.1.0
+ * @brief Get the sum of a counter over all the threads.
+ * @param metric The counter.
+ * @return The counter value.
+ */
+size_t lmc_metricsCount(LmcMetric metric);
+
+/**
+ * @since 0.1.0
+ * @brief Change the number of programs waiting to be executed.
+ * @param delta The change.
+ */
+void lmc_metricsQueue(long delta);
+
+/**
+ * @since 0.1.0
+ * @brief Write the metrics in the Prometheus text format.
+ *
+ * The @c lmc_mips gauge is the rate of instructions since the
+ * previous call, or since the first counted program.
+ *
+ * @param output The destination.
+ */
+void lmc_metricsWrite(FILE* output) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Export the metrics in a file every @p delay seconds, and
+ * when the process receives @c SIGUSR1, until lmc_metricsStop().
+ *
+ * The file is replaced atomically (through @c path.tmp). @c SIGUSR1
+ * is blocked in the calling thread, thus this function must be
+ * called before starting the threads of the process. This function
+ * may raise a fatal error if the exporter cannot be started.
+ *
+ * @param path The metrics file path.
+ * @param delay The delay between two exports (seconds), @c 0 to only
+ * export on @c SIGUSR1.
+ */
+void lmc_metricsStart(const char* restrict path, unsigned int delay) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Export the metrics a last time, and stop the exporter, if
+ * started.
+ */
+void lmc_metricsStop(void);
+
+#endif // LMC_METRICS_H_
+/** @} */
@@ -0,0 +1,104 @@
+/**
+ * @file      shard.h
+ * @version   0.1.0
+ * @brief     LMC multi-process batch coordinator.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup Shard
+ * @{
+ *
+ * The coordinator and its workers exchange text lines:
+ *
+ * - the coordinator sends a shard as a @c "shard COUNT" line followed
+ *   by @c COUNT jobs, in the manifest format (see lmc_manifest()) with
+ *   @c - for the missing files;
+ * - the worker answers with the @c COUNT JSON results of lmc_batch(),
+ *   followed by an @c "end STATUS COUNTERS" line, @c COUNTERS being
+ *   the increase of its metrics (see #LmcMetric) during the shard, in
+ *   their order.
+ *
+ * The worker side reads its standard input and writes on its standard
+ * output, thus any stream (a pipe, a socket, a remote shell...) can
+ * connect a coordinator to a worker.
+ */
+
+#ifndef LMC_SHARD_H_
+#define LMC_SHARD_H_
+
+#include "lmc/specs.h"
+#include "lmc/batch.h"
+
+#include <err.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * @enum LmcShardCaracs
+ * @since 0.1.0
+ * @brief The coordinator characteristics.
+ */
+typedef enum LmcShardCaracs {
+    LMC_SHARDJOBS  = 64, /**< Default number of jobs per shard. */
+    LMC_SHARDTRIES = 3,  /**< Max number of workers stopped in a row by
+                          * a job before giving it up. */
+} LmcShardCaracs;
+
+/**
+ * @since 0.1.0
+ * @brief Execute jobs in shards dispatched to worker processes.
+ *
+ * The jobs are split in shards of @p size jobs, sent to @p processes
+ * forked workers running lmc_shardWorker(). A worker which stops
+ * before the end of its shard is replaced, its results received so
+ * far are kept, and the next job of the shard is sent again alone,
+ * then the remaining ones; the job stopping #LMC_SHARDTRIES workers
+ * in a row is given up, and reported with a @c null status and an
+ * @c "error" field. The results
+ * are merged on the standard output as they come, in the jobs order,
+ * as lmc_batch() does. This function may raise a fatal error if the
+ * workers cannot be started.
+ *
+ * @param bootstrap The compiled bootstrap file path.
+ * @param jobs The jobs.
+ * @param count The number of jobs.
+ * @param processes The number of worker processes.
+ * @param size The number of jobs per shard, @c 0 for #LMC_SHARDJOBS.
+ * @param threads The number of threads of each worker, @c 0 to share
+ * the online processors between the workers.
+ * @param limit The max number of instructions of each program, @c 0
+ * for no limit.
+ * @return @c EXIT_FAILURE if a shard is given up or a worker reports a
+ * failure, otherwise @c EXIT_SUCCESS.
+ */
+int lmc_coordinate(const char* restrict bootstrap, const LmcJob* jobs, size_t count, size_t processes, size_t size, size_t threads, size_t limit);
+
+/**
+ * @since 0.1.0
+ * @brief Execute the shards read on the standard input, and write their
+ * results on the standard output, until the end of the input.
+ *
+ * This function may raise a fatal error on malformed shards, like any
+ * fatal error of the executed programs.
+ *
+ * @param bootstrap The compiled bootstrap file path.
+ * @param threads The number of threads, @c 0 for one per online
+ * processor.
+ * @param limit The max number of instructions of each program, @c 0
+ * for no limit.
+ * @param pinned Pin each thread to a processor.
+ * @return @c EXIT_SUCCESS.
+ */
+int lmc_shardWorker(const char* restrict bootstrap, size_t threads, size_t limit, bool pinned);
+
+#endif // LMC_SHARD_H_
+/** @} */
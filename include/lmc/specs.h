@@ -44,6 +44,15 @@ typedef enum LmcMemoryCaracs {
     LMC_MEMCOL    = 0x0f,               /**< Max number of addresses per line for the dumps. */
     LMC_SIGN      = LMC_MAXRAM >> 1,    /**< Sign bit mask. */
     LMC_MAXVAL    = LMC_MAXRAM,         /**< Max value for each memory slot. */
+    LMC_STACKBASE = LMC_MAXRAM - 1,     /**< Stack base address (the stack grows downwards). */
+    LMC_BUSBUF    = LMC_MAXRAM,         /**< Bus output buffer size (bytes). */
+    LMC_STREAMBUF = 1 << 16,            /**< Data input ring size (bytes). */
+    LMC_PIPEBUF   = 1 << 12,            /**< Pipeline ring size (bytes, a power of 2). */
+    LMC_CACHELINE = 64,                 /**< Host cache line size (bytes). */
+    LMC_RINGSPIN  = 64,            /**< Pipeline ring polls before sleeping. */
+    LMC_SESSIONBUF = 64,                /**< Session pending input size (bytes). */
+    LMC_SESSIONSLICE = 1 << 16,         /**< Instructions executed by a session before yielding. */
+    LMC_SESSIONINVALID = 8,             /**< Invalid input words stopping a session. */
 } LmcMemoryCaracs;
 
 // clang-format off
@@ -94,6 +103,7 @@ typedef enum __attribute__((__packed__)) LmcOpCodes {
 
     // Combinations
     INDIR = VAR | PTR, /**< Pointer dereferencing. */
+    IDX   = PTR,       /**< Indexed variable: the argument plus the X register is an address. */
 
     // Instructions
     // The !WRT are indeed useless, but used anyway to indicate the
@@ -107,7 +117,39 @@ typedef enum __attribute__((__packed__)) LmcOpCodes {
     JUMP  = JMP,        /**< Set the PC to the given address ("jump to").*/
     BRN   = JMP | INV,  /**< JUMP but only if the accumulator is less than @c 0. */
     BRZ   = JMP | NOT,  /**< JUMP but only if the accumulator is equal to @c 0. */
-    START = PTR,        /**< The value is a start address. */
+    BRC   = BRZ | INV,  /**< JUMP but only if the carry flag is set. */
+    ADC   = ADD | JMP,  /**< Addition with carry. */
+    SBC   = ADC | INV,  /**< Substraction with borrow. */
+    // All the operation primitives at once are not a valid
+    // instruction, thus usable by the compiler.
+    START = INV | NOT | HLT | WRT | JMP | ADD, /**< The value is a start address. */
+    SEGMENT = START | PTR, /**< The value is the address of a new program segment. */
+
+    // Index register instructions.
+    LDX = LOAD | NOT, /**< Load the argument in the X register. */
+    INX = LDX  | INV, /**< Increment the X register. */
+    DEX = LDX  | HLT, /**< Decrement the X register. */
+
+    // Stack instructions.
+    PUSH  = STORE | NOT, /**< Push the accumulator on the stack. */
+    POP   = PUSH  | INV, /**< Pop the top of the stack in the accumulator. */
+    CALL  = JUMP  | WRT, /**< Push the return address on the stack and JUMP. */
+    RET   = CALL  | INV, /**< Pop the return address from the stack and JUMP to it. */
+    STACK = CALL  | NOT, /**< Reserve the RAM between the given address and #LMC_STACKBASE for the stack. */
+
+    // Block instructions. The argument is the address of a parameter
+    // block storing, in order, the destination (or first) address, the
+    // source address (or value) and the length.
+    COPY  = WRT  | ADD, /**< Copy a memory block (as memmove()). */
+    CMP   = COPY | INV, /**< Compare two memory blocks (as memcmp()). */
+    FILL  = COPY | NOT, /**< Fill a memory block with a value (as memset()). */
+
+    // Block IO instructions. The argument is the address of a
+    // length-prefixed memory block.
+    INS   = COPY | HLT, /**< Input a memory block from the bus input. */
+    OUTS  = INS  | INV, /**< Output a memory block on the bus output. */
+    INSB  = INS  | NOT, /**< INS but always in binary. */
+    OUTSB = OUTS | NOT, /**< OUTS but in binary. */
 
     // Debugger instructions.
     DEBUG = HLT   | INV, /**< Step in the debugger depending on the argument. */
@@ -131,6 +173,7 @@ typedef enum __attribute__((__packed__)) LmcOpCodes {
 #define LMC_PROGLANG(macro)                     \
     macro(VAR,"@")                              \
     macro(INDIR,"*@")                           \
+    macro(IDX,"+@")                             \
     macro(ADD,"add")                            \
     macro(SUB,"sub")                            \
     macro(NAND,"nand")                          \
@@ -141,8 +184,27 @@ typedef enum __attribute__((__packed__)) LmcOpCodes {
     macro(JUMP,"jump")                          \
     macro(BRN,"brn")                            \
     macro(BRZ,"brz")                            \
+    macro(BRC,"brc")                            \
+    macro(ADC,"adc")                            \
+    macro(SBC,"sbc")                            \
     macro(HLT,"stop")                           \
     macro(START,"start")                        \
+    macro(SEGMENT,"segment")                    \
+    macro(PUSH,"push")                          \
+    macro(POP,"pop")                            \
+    macro(CALL,"call")                          \
+    macro(RET,"ret")                            \
+    macro(STACK,"stack")                        \
+    macro(COPY,"copy")                          \
+    macro(CMP,"compare")                        \
+    macro(FILL,"fill")                          \
+    macro(INS,"ins")                            \
+    macro(OUTS,"outs")                          \
+    macro(INSB,"insb")                          \
+    macro(OUTSB,"outsb")                        \
+    macro(LDX,"ldx")                            \
+    macro(INX,"inx")                            \
+    macro(DEX,"dex")                            \
     macro(DEBUG, "debug")                       \
     macro(BREAK, "break")                       \
     macro(FREE, "free")                         \
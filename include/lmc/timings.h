@@ -0,0 +1,120 @@
+/**
+ * @file      timings.h
+ * @version   0.1.0
+ * @brief     LMC host timings.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup Timings
+ * @{
+ *
+ * The timings measure where the host spends its time, as opposed to
+ * the statistics of the emulated programs. They are only compiled if
+ * the #_TIMINGS macro is defined: each timed function then records its
+ * latency in a histogram, and the percentiles are reported on the
+ * standard error at the process exit.
+ *
+ * The histograms are log-linear, as the HDR ones: the latencies below
+ * #LMC_TIMINGSUB nanoseconds are exact, and each power of two above is
+ * split in #LMC_TIMINGSUB buckets, thus the reported values are at
+ * most 1/#LMC_TIMINGSUB above the real ones. Each thread fills its own
+ * histograms, summed for the report.
+ */
+
+#ifndef LMC_TIMINGS_H_
+#define LMC_TIMINGS_H_
+
+#ifdef _TIMINGS
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @enum LmcTimer
+ * @since 0.1.0
+ * @brief The timed functions; a timing includes the timed functions
+ * it calls.
+ */
+typedef enum LmcTimer {
+    LMC_TPHASEONE,   /**< lmc_phaseOne(), the instruction fetch. */
+    LMC_TPHASETWO,   /**< lmc_phaseTwo(), the instruction execution,
+                      * the bus input and output included. */
+    LMC_TPHASETHREE, /**< lmc_phaseThree(), the argument skip. */
+    LMC_TBUSINPUT,   /**< lmc_busInput(), a word read. */
+    LMC_TBUSOUTPUT,  /**< lmc_busOutput(), a buffer written. */
+    LMC_TBOOTSTRAP,  /**< lmc_bootstrap(), the bootstrap load. */
+    LMC_TPARSE,      /**< The source parsing by yyparse(). */
+    LMC_TCOMPWRITE,  /**< lmc_compilerWrite(), the compiled file
+                      * write. */
+    LMC_TIMERS,      /**< Number of timers. */
+} LmcTimer;
+
+/**
+ * @enum LmcTimingsCaracs
+ * @since 0.1.0
+ * @brief The timings histograms characteristics.
+ */
+typedef enum LmcTimingsCaracs {
+    LMC_TIMINGSHIFT   = 4,                       /**< log2 of #LMC_TIMINGSUB. */
+    LMC_TIMINGSUB     = 1 << LMC_TIMINGSHIFT,    /**< Buckets per power of
+                                                  * two. */
+    LMC_TIMINGBUCKETS = (64 - LMC_TIMINGSHIFT + 1) * LMC_TIMINGSUB, /**< Buckets
+                                                  * per histogram. */
+} LmcTimingsCaracs;
+
+/**
+ * @struct LmcTiming
+ * @since 0.1.0
+ * @brief A running timing.
+ */
+typedef struct LmcTiming {
+    LmcTimer timer; /**< The timer. */
+    uint64_t start; /**< The start time (ns). */
+} LmcTiming;
+
+/**
+ * @def lmc_timing
+ * @since 0.1.0
+ * @brief Time the rest of the current block, until it is left by any
+ * way but a long jump.
+ * @param timer The #LmcTimer.
+ */
+#define lmc_timing(timer) \
+    LmcTiming lmc_timing_ __attribute__((cleanup(lmc_timingStop))) = { timer, lmc_timingNow() }
+
+/**
+ * @since 0.1.0
+ * @brief Get the monotonic clock time.
+ * @return The time (ns).
+ */
+uint64_t lmc_timingNow(void);
+
+/**
+ * @since 0.1.0
+ * @brief Record a timing in the histogram of the calling thread.
+ * @param timing The timing, stopped now.
+ */
+void lmc_timingStop(const LmcTiming* timing) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Print the percentiles of the timers used, one per line.
+ * @param output The report destination.
+ */
+void lmc_timingsReport(FILE* output) __attribute__((nonnull));
+
+#else
+
+#define lmc_timing(timer)
+
+#endif // _TIMINGS
+
+#endif // LMC_TIMINGS_H_
+/** @} */
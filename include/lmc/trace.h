@@ -0,0 +1,195 @@
+/**
+ * @file      trace.h
+ * @version   0.1.0
+ * @brief     LMC execution traces.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup Trace
+ * @{
+ *
+ * A trace records each instruction executed by a program, and the
+ * input it consumed, in a compact binary log. It starts with the
+ * #LMC_TRACEMAGIC magic number, the #LMC_TRACEVERSION format version
+ * byte, and the program file path (its length then its bytes, empty
+ * if unknown). It is followed by the events, each one starting with
+ * a tag:
+ *
+ * - an even tag is an instruction: the tag halved is the difference
+ *   between its address and the one following the previous
+ *   instruction. It is followed by its operation and argument bytes,
+ *   the difference of the accumulator since the previous
+ *   instruction, and the memory sections it wrote: their number, then
+ *   for each one its address, its length and its new content;
+ * - an odd tag is an input: the tag halved is the number of words
+ *   read from the bus, which follow.
+ *
+ * The numbers are unsigned LEB128 variable-length integers, the
+ * differences being zigzag-encoded bytes (@c 0, @c -1, @c 1, @c -2...
+ * are @c 0, @c 1, @c 2, @c 3...): a sequential instruction which does
+ * not change the accumulator nor the memory takes five bytes.
+ */
+
+#ifndef LMC_TRACE_H_
+#define LMC_TRACE_H_
+
+#include "lmc/specs.h"
+#include "lmc/error.h"
+#include "lmc/lexer.h"
+
+#include <err.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @def LMC_TRACEMAGIC
+ * @since 0.1.0
+ * @brief The traces magic number.
+ */
+#define LMC_TRACEMAGIC "LMCT"
+
+/**
+ * @enum LmcTraceCaracs
+ * @since 0.1.0
+ * @brief The traces characteristics.
+ */
+typedef enum LmcTraceCaracs {
+    LMC_TRACEVERSION = 1,       /**< The trace format version. */
+    LMC_TRACEBUF     = 1 << 12, /**< Size of the trace blocks (bytes). */
+    LMC_TRACEBLOCKS  = 16,      /**< Number of blocks of the trace
+                                 * ring. */
+    LMC_TRACERUNS    = 4,       /**< Max number of memory sections
+                                 * written by an instruction. */
+    LMC_TRACERECORD  = 32,      /**< Max size of an instruction record,
+                                 * the sections contents excluded. */
+} LmcTraceCaracs;
+
+/**
+ * @struct LmcTrace
+ * @since 0.1.0
+ * @brief A trace being written.
+ *
+ * The computer fills the blocks of a ring, which are written on the
+ * trace file by a background thread; the computer only waits for it
+ * if the ring is full.
+ */
+typedef struct LmcTrace {
+    FILE* file;             /**< The trace file. */
+    pthread_t thread;       /**< The flushing thread. */
+    pthread_mutex_t lock;   /**< The ring lock. */
+    pthread_cond_t filled;  /**< A block is filled, or the trace is
+                             * closed. */
+    pthread_cond_t flushed; /**< A block is flushed. */
+    size_t head;            /**< Next block to flush. */
+    size_t tail;            /**< Block being filled. */
+    bool closed;            /**< No more block will be filled. */
+    bool failed;            /**< A block could not be written. */
+    size_t sizes[LMC_TRACEBLOCKS]; /**< The filled blocks sizes. */
+    size_t size;            /**< Size of the block being filled. */
+    LmcRam blocks[LMC_TRACEBLOCKS][LMC_TRACEBUF]; /**< The ring. */
+    struct {
+        bool started;       /**< An instruction is pending. */
+        LmcRam pc;          /**< Its address. */
+        LmcRam opcode;      /**< Its operation. */
+        LmcRam argument;    /**< Its argument. */
+        size_t count;       /**< Number of sections it wrote. */
+        struct {
+            LmcRam address; /**< The section address. */
+            size_t length;  /**< The section length. */
+        } runs[LMC_TRACERUNS]; /**< The sections it wrote. */
+    } pending;              /**< The instruction being executed,
+                             * recorded once done. */
+    LmcRam next;            /**< The address following the last
+                             * recorded instruction. */
+    LmcRam acc;             /**< The accumulator after the last
+                             * recorded instruction. */
+} LmcTrace;
+
+/**
+ * @since 0.1.0
+ * @brief Open a trace and start its flushing thread.
+ * @param path The trace file path, replaced if it exists.
+ * @param program The traced program file path, or @c NULL.
+ * @return The trace, to close with lmc_traceClose(), or @c NULL if
+ * the file cannot be opened (a warning is then reported).
+ */
+LmcTrace* lmc_traceOpen(const char* restrict path, const char* restrict program) __attribute__((nonnull (1)));
+
+/**
+ * @since 0.1.0
+ * @brief Record the instruction about to be fetched, and the previous
+ * one which is done.
+ * @param trace The trace.
+ * @param ram The computer memory.
+ * @param pc The instruction address.
+ * @param acc The accumulator.
+ */
+void lmc_traceFetch(LmcTrace* trace, const LmcRam* ram, LmcRam pc, LmcRam acc) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Record a memory section written by the current instruction,
+ * its content being recorded once the instruction is done.
+ * @param trace The trace.
+ * @param address The section start.
+ * @param length The section length.
+ */
+void lmc_traceWrite(LmcTrace* trace, unsigned int address, size_t length) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Record words read from the bus.
+ * @param trace The trace.
+ * @param words The words.
+ * @param size The number of words.
+ */
+void lmc_traceInput(LmcTrace* trace, const LmcRam* words, size_t size) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Record the last instruction, flush and close a trace.
+ * @param trace The trace.
+ * @param ram The computer memory.
+ * @param acc The accumulator.
+ */
+void lmc_traceClose(LmcTrace* trace, const LmcRam* ram, LmcRam acc) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Print a trace as text, one event per line.
+ *
+ * The instructions are printed as their address, bytes, keywords, the
+ * accumulator, and the memory sections written. This function may
+ * raise a fatal error if the trace cannot be read.
+ *
+ * @param path The trace file path.
+ * @param output The text destination.
+ * @return @c EXIT_FAILURE if the trace is malformed (it is printed up
+ * to the error), otherwise @c EXIT_SUCCESS.
+ */
+int lmc_tracePrint(const char* restrict path, FILE* output) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Get the input words of a trace, to replay it.
+ *
+ * This function may raise a fatal error if the trace cannot be read,
+ * or if it is malformed.
+ *
+ * @param path The trace file path.
+ * @param program The traced program file path destination, of
+ * @c PATH_MAX bytes, empty if unknown.
+ * @param size The number of words destination.
+ * @return The words, to free.
+ */
+LmcRam* lmc_traceInputs(const char* restrict path, char* restrict program, size_t* restrict size) __attribute__((nonnull));
+
+#endif // LMC_TRACE_H_
+/** @} */
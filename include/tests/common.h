@@ -20,6 +20,12 @@
  */
 #include "sccroll.h"
 
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lmc/specs.h"
+
 /**
  * @def MANUALIN
  * @since 0.1.0
@@ -157,6 +163,20 @@
  */
 #define PRODUCT PROGS "product"
 
+/**
+ * @def V1PRODUCT
+ * @since 0.1.0
+ * @brief #PRODUCT compiled in the version 1 format.
+ */
+#define V1PRODUCT PROGS "v1_product"
+
+/**
+ * @def SEGMENTS
+ * @since 0.1.0
+ * @brief Program storing its data in a second segment.
+ */
+#define SEGMENTS PROGS "segments"
+
 /**
  * @def QUOTIENT
  * @since 0.1.0
@@ -165,6 +185,34 @@
  */
 #define QUOTIENT PROGS "quotient"
 
+/**
+ * @def DOUBLE
+ * @since 0.1.0
+ * @brief Compiled program doubling each input integer.
+ */
+#define DOUBLE PROGS "double"
+
+/**
+ * @def SELFMOD
+ * @since 0.1.0
+ * @brief Program overwriting its own code, then the ROM.
+ */
+#define SELFMOD PROGS "selfmod"
+
+/**
+ * @def CALLS
+ * @since 0.1.0
+ * @brief Compiled program calling a subroutine twice.
+ */
+#define CALLS PROGS "calls"
+
+/**
+ * @def FOREVER
+ * @since 0.1.0
+ * @brief Compiled program looping forever.
+ */
+#define FOREVER PROGS "forever"
+
 /**
  * @def CMDLINE
  * @since 0.1.0
@@ -193,7 +241,7 @@
 /**
  * @def DUMMYCODE
  * @since 0.1.0
- * @brief Expected compiled code of #DUMMY.
+ * @brief Expected translation of #DUMMY, with a version 1 header.
  *
  * The null byte near the end is there on purpose, to ensure that the
  * whole string is considered, not up to the first null.
@@ -210,6 +258,67 @@
  * for the tests.
  */
 #define DUMMYCODELEN (strlen(DUMMYCODE)+3)
+
+/**
+ * @def DUMMYBIN
+ * @since 0.1.0
+ * @brief Expected compiled code of #DUMMY: the version 2 header, one
+ * segment, and the translation.
+ */
+#define DUMMYBIN                                \
+    "\xff\x4c\x4d\x43\x02\xad\x01\x30\x6e\xf7\x40" \
+    "\xad\x0e" "\x20\x23\x40\x53\xd0\xaf\x09\x02\x41\xff\x40\x00\x12\x56"
+
+/**
+ * @def DUMMYBINLEN
+ * @since 0.1.0
+ * @brief Bytes length of #DUMMYBIN.
+ */
+#define DUMMYBINLEN 27
+/** @} */
+
+/**
+ * @name Helpers.
+ * @{
+ */
+
+/**
+ * @since 0.1.0
+ * @brief Read the test input, for LmcIo::read.
+ * @param context The input left, as a pointer to a string.
+ * @param dest The destination.
+ * @param size Max number of bytes to read.
+ * @return The number of bytes read.
+ */
+static inline size_t test_read(void* context, LmcRam* dest, size_t size)
+{
+    const char** input = context;
+    size_t length = strlen(*input);
+
+    size = size < length ? size : length;
+    memcpy(dest, *input, size);
+    *input += size;
+    return size;
+}
+
+/**
+ * @since 0.1.0
+ * @brief Read a whole file, followed by a null byte.
+ * @param path The file path.
+ * @param content The content destination, of #BUFSIZ bytes.
+ * @return The content size.
+ */
+static inline size_t test_load(const char* path, LmcRam* content)
+{
+    FILE* file = fopen(path, "rb");
+    size_t size = 0;
+
+    assert(file);
+    size = fread(content, sizeof(LmcRam), BUFSIZ - 1, file);
+    fclose(file);
+    content[size] = 0;
+    return size;
+}
 /** @} */
 
 #endif // LMC_COMMON_H_
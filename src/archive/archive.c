@@ -0,0 +1,275 @@
+/**
+ * @file      archive.c
+ * @version   0.1.0
+ * @brief     LMC compiled programs archives module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup ArchiveInternals
+ * @{
+ */
+
+#include "lmc/archive.h"
+
+/**
+ * @struct LmcPacked
+ * @since 0.1.0
+ * @brief A program being archived.
+ */
+typedef struct LmcPacked {
+    const char* name; /**< The entry name. */
+    LmcRam* image;    /**< The program image. */
+    size_t size;      /**< The image size. */
+    uint32_t hash;    /**< The image hash. */
+    uint32_t offset;  /**< The image offset in the archive. */
+    bool stored;      /**< The image is stored (@c false if it is the
+                       * one of a previous entry). */
+} LmcPacked;
+
+/**
+ * @since 0.1.0
+ * @brief Compare two programs names, for qsort(3).
+ * @param a,b The programs (#LmcPacked).
+ * @return The strcmp(3) result of their names.
+ */
+static int lmc_compare(const void* a, const void* b) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Read a whole compiled program.
+ *
+ * This function may raise a fatal error if the file cannot be read.
+ *
+ * @param path The file path.
+ * @param size The image size destination.
+ * @return The image, to free.
+ */
+static LmcRam* lmc_read(const char* restrict path, size_t* restrict size) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Raise a fatal error for a malformed archive.
+ * @param path The archive file path.
+ */
+static void lmc_malformed(const char* restrict path) __attribute__((noreturn, nonnull));
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * Implementation
+ ******************************************************************************/
+// clang-format on
+
+int lmc_pack(const char* restrict path, size_t count, char* const* files)
+{
+    LmcPacked* programs = calloc(count ? count : 1, sizeof(LmcPacked));
+    LmcArchiveHeader header = { .magic = LMC_ARCHIVEMAGIC, };
+    LmcArchiveEntry entry = { 0 };
+    size_t names = 0, offset = 0;
+    const char* name = NULL;
+    FILE* archive = NULL;
+
+    if (!programs) lmc_err("could not allocate for the archive");
+    for (size_t i = 0; i < count; ++i) {
+        name = strrchr(files[i], '/');
+        programs[i].name  = name ? name + 1 : files[i];
+        programs[i].image = lmc_read(files[i], &programs[i].size);
+        programs[i].hash  = lmc_checksum(programs[i].image, programs[i].size);
+        names += strlen(programs[i].name) + 1;
+    }
+
+    // The index is sorted for the lookups.
+    qsort(programs, count, sizeof(LmcPacked), lmc_compare);
+    for (size_t i = 1; i < count; ++i)
+        if (!strcmp(programs[i - 1].name, programs[i].name)) {
+            errno = EEXIST;
+            lmc_err("%s: duplicate entry name", programs[i].name);
+        }
+
+    // The identical images are stored once.
+    offset = sizeof(LmcArchiveHeader) + count * sizeof(LmcArchiveEntry) + names;
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = 0; j < i && !programs[i].stored && !programs[i].offset; ++j)
+            if (programs[j].stored
+                && programs[j].hash == programs[i].hash
+                && programs[j].size == programs[i].size
+                && !memcmp(programs[j].image, programs[i].image, programs[i].size))
+                programs[i].offset = programs[j].offset;
+        if (programs[i].offset) continue;
+        programs[i].offset = offset;
+        programs[i].stored = true;
+        if ((offset += programs[i].size) > UINT32_MAX) {
+            errno = EFBIG;
+            lmc_err("%s", path);
+        }
+    }
+
+    if (!(archive = fopen(path, "wb"))) lmc_err("%s", path);
+    header.version = htole32(LMC_ARCHIVEVERSION);
+    header.count   = htole32(count);
+    header.names   = htole32(names);
+    fwrite(&header, sizeof(header), 1, archive);
+    names = 0;
+    for (size_t i = 0; i < count; ++i) {
+        entry = (LmcArchiveEntry){
+            .name   = htole32(names),
+            .offset = htole32(programs[i].offset),
+            .size   = htole32(programs[i].size),
+            .hash   = htole32(programs[i].hash),
+        };
+        fwrite(&entry, sizeof(entry), 1, archive);
+        names += strlen(programs[i].name) + 1;
+    }
+    for (size_t i = 0; i < count; ++i)
+        fwrite(programs[i].name, sizeof(char), strlen(programs[i].name) + 1, archive);
+    for (size_t i = 0; i < count; ++i)
+        if (programs[i].stored)
+            fwrite(programs[i].image, sizeof(LmcRam), programs[i].size, archive);
+    if (ferror(archive) || fclose(archive)) lmc_err("%s", path);
+
+    for (size_t i = 0; i < count; ++i) free(programs[i].image);
+    free(programs);
+    return EXIT_SUCCESS;
+}
+
+int lmc_unpack(const char* restrict path, const char* restrict directory)
+{
+    LmcArchive* archive = lmc_archiveOpen(path);
+    const LmcRam* image = NULL;
+    const char* name = NULL;
+    char output[PATH_MAX];
+    FILE* file = NULL;
+    size_t size = 0;
+    int status = EXIT_SUCCESS;
+
+    for (size_t i = 0; i < archive->count; ++i) {
+        name  = lmc_archiveName(archive, i);
+        image = &archive->data[le32toh(archive->index[i].offset)];
+        size  = le32toh(archive->index[i].size);
+        if (lmc_checksum(image, size) != le32toh(archive->index[i].hash)) {
+            errno = EBADMSG;
+            lmc_warn("%s: %s: corrupted image", path, name);
+            status = EXIT_FAILURE;
+        }
+
+        if (snprintf(output, sizeof(output), "%s/%s", directory, name) >= (int)sizeof(output)) {
+            errno = ENAMETOOLONG;
+            lmc_err("%s/%s", directory, name);
+        }
+        if (!(file = fopen(output, "wb"))
+            || fwrite(image, sizeof(LmcRam), size, file) < size
+            || fclose(file))
+            lmc_err("%s", output);
+    }
+
+    lmc_archiveClose(archive);
+    return status;
+}
+
+LmcArchive* lmc_archiveOpen(const char* restrict path)
+{
+    LmcArchive* archive = calloc(1, sizeof(LmcArchive));
+    const LmcArchiveHeader* header = NULL;
+    struct stat info = { 0 };
+    size_t names = 0, offset = 0;
+    const char* name = NULL;
+    int fd = open(path, O_RDONLY);
+
+    if (!archive) lmc_err("could not allocate for the archive");
+    if (fd < 0 || fstat(fd, &info)) lmc_err("%s", path);
+    if ((size_t)info.st_size < sizeof(LmcArchiveHeader)) lmc_malformed(path);
+    archive->size = info.st_size;
+    if ((archive->data = mmap(NULL, archive->size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+        lmc_err("%s", path);
+    close(fd);
+
+    header = (const LmcArchiveHeader*)archive->data;
+    if (memcmp(header->magic, LMC_ARCHIVEMAGIC, sizeof(header->magic))
+        || le32toh(header->version) != LMC_ARCHIVEVERSION)
+        lmc_malformed(path);
+    archive->count = le32toh(header->count);
+    names  = le32toh(header->names);
+    offset = sizeof(LmcArchiveHeader) + archive->count * sizeof(LmcArchiveEntry);
+    if (offset + names > archive->size || (names && archive->data[offset + names - 1]))
+        lmc_malformed(path);
+    archive->index = (const LmcArchiveEntry*)&archive->data[sizeof(LmcArchiveHeader)];
+    archive->names = (const char*)&archive->data[offset];
+
+    // The entries must stay in the archive, and their names in the
+    // destination directory of lmc_unpack(). The names are strictly
+    // increasing, for the binary search of lmc_archiveFind().
+    for (size_t i = 0; i < archive->count; ++i) {
+        if (le32toh(archive->index[i].name) >= names
+            || (size_t)le32toh(archive->index[i].offset) + le32toh(archive->index[i].size) > archive->size)
+            lmc_malformed(path);
+        name = lmc_archiveName(archive, i);
+        if (!*name || strchr(name, '/') || !strcmp(name, ".") || !strcmp(name, "..")
+            || (i && strcmp(lmc_archiveName(archive, i - 1), name) >= 0))
+            lmc_malformed(path);
+    }
+    return archive;
+}
+
+void lmc_archiveClose(LmcArchive* archive)
+{
+    if (!archive) return;
+    munmap((void*)archive->data, archive->size);
+    free(archive);
+}
+
+const char* lmc_archiveName(const LmcArchive* archive, size_t index)
+{
+    return &archive->names[le32toh(archive->index[index].name)];
+}
+
+const LmcRam* lmc_archiveFind(const LmcArchive* archive, const char* restrict name, size_t* restrict size)
+{
+    size_t low = 0, high = archive->count, middle = 0;
+    int order = 0;
+
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (!(order = strcmp(name, lmc_archiveName(archive, middle)))) {
+            *size = le32toh(archive->index[middle].size);
+            return &archive->data[le32toh(archive->index[middle].offset)];
+        }
+        if (order < 0) high = middle;
+        else low = middle + 1;
+    }
+    return NULL;
+}
+
+static int lmc_compare(const void* a, const void* b)
+{
+    return strcmp(((const LmcPacked*)a)->name, ((const LmcPacked*)b)->name);
+}
+
+static LmcRam* lmc_read(const char* restrict path, size_t* restrict size)
+{
+    LmcRam* image = NULL;
+    ssize_t done = 0;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) lmc_err("%s", path);
+    *size = 0;
+    do {
+        if (!(image = realloc(image, *size + LMC_MAXRAM)))
+            lmc_err("%s", path);
+        if ((done = read(fd, &image[*size], LMC_MAXRAM)) < 0)
+            lmc_err("%s", path);
+        *size += done;
+    } while (done);
+    close(fd);
+    return image;
+}
+
+static void lmc_malformed(const char* restrict path)
+{
+    errno = EINVAL;
+    lmc_err("%s: malformed archive", path);
+}
+
+/** @} */
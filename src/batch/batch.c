@@ -0,0 +1,446 @@
+/**
+ * @file      batch.c
+ * @version   0.1.0
+ * @brief     LMC parallel batch runner module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup BatchInternals
+ * @{
+ */
+
+// The workers pinning uses the GNU CPU affinity extensions.
+#define _GNU_SOURCE
+#include "lmc/batch.h"
+
+/**
+ * @struct LmcResult
+ * @since 0.1.0
+ * @brief A job result.
+ */
+typedef struct LmcResult {
+    char* output;  /**< The program output. */
+    size_t size;   /**< The program output size. */
+    size_t cycles; /**< The number of instructions executed. */
+    double time;   /**< The wall time of the execution, in seconds. */
+    LmcRam status; /**< The word register value at shutdown. */
+    bool limited;  /**< The instructions limit is reached. */
+    bool passed;   /**< The output is the expected one. */
+    bool done;     /**< The result is ready. */
+    LmcError error; /**< The error preventing the execution, if any. */
+} LmcResult;
+
+/**
+ * @struct LmcQueue
+ * @since 0.1.0
+ * @brief A worker and its jobs queue.
+ *
+ * The worker takes its jobs from the head of its queue, while the
+ * others steal from the tail.
+ */
+typedef struct LmcQueue {
+    size_t* jobs;         /**< The jobs indexes. */
+    size_t head;          /**< Next job to take. */
+    size_t tail;          /**< Next free slot. */
+    pthread_mutex_t lock; /**< The queue lock. */
+    pthread_t thread;     /**< The worker thread. */
+    struct LmcPool* pool; /**< The worker pool. */
+} LmcQueue;
+
+/**
+ * @struct LmcPool
+ * @since 0.1.0
+ * @brief The batch workers and jobs.
+ */
+typedef struct LmcPool {
+    const char* bootstrap; /**< The compiled bootstrap file path. */
+    const LmcJob* jobs;    /**< The jobs. */
+    LmcResult* results;    /**< The jobs results. */
+    LmcQueue* queues;      /**< The workers queues. */
+    size_t workers;        /**< The number of workers. */
+    size_t limit;          /**< The max number of instructions per
+                            * program. */
+    pthread_mutex_t lock;  /**< The results lock. */
+    pthread_cond_t ready;  /**< Signaled when a result is done. */
+} LmcPool;
+
+/**
+ * @since 0.1.0
+ * @brief Run the jobs of a worker queue, then the ones stolen from the
+ * other queues.
+ * @param queue The worker queue (a #LmcQueue).
+ * @return @c NULL.
+ */
+static void* lmc_worker(void* queue) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Take a job from a queue.
+ * @param queue The queue.
+ * @param steal Take it from the tail (@c true) or the head (@c false).
+ * @param job The job index destination.
+ * @return @c false if the queue is empty, otherwise @c true.
+ */
+static bool lmc_take(LmcQueue* queue, bool steal, size_t* job) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Execute a job and store its result.
+ * @param pool The worker pool.
+ * @param index The job index.
+ */
+static void lmc_run(LmcPool* pool, size_t index) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Open the session of a job, catching its errors.
+ * @param bootstrap The compiled bootstrap file path.
+ * @param program The compiled program file path.
+ * @param in,out See lmc_sessionOpen().
+ * @param error The error destination.
+ * @return The session, or @c NULL in case of errors.
+ */
+static LmcSession* lmc_open(const char* restrict bootstrap, const char* restrict program, int in, int out, LmcError* error)
+    __attribute__((nonnull (2, 5)));
+
+/**
+ * @since 0.1.0
+ * @brief Record in a job result the error of a file.
+ * @param result The job result.
+ * @param path The file path.
+ */
+static void lmc_fail(LmcResult* restrict result, const char* restrict path) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Read a whole file.
+ *
+ * This function may raise a fatal error if the file cannot be read.
+ *
+ * @param fd The file descriptor, read from its start.
+ * @param path The file path, for the error messages.
+ * @param size The content size destination.
+ * @return The content, to free.
+ */
+static char* lmc_slurp(int fd, const char* restrict path, size_t* restrict size) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Write a job result as a JSON line on the standard output.
+ *
+ * The jobs which could not be executed have a @c null status and an
+ * @c error message instead of their output.
+ *
+ * @param job The job.
+ * @param result The job result.
+ */
+static void lmc_report(const LmcJob* restrict job, const LmcResult* restrict result) __attribute__((nonnull));
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * Implementation
+ ******************************************************************************/
+// clang-format on
+
+LmcJob* lmc_manifest(const char* restrict path, size_t* restrict count)
+{
+    FILE* file = strcmp(path, "-") ? fopen(path, "r") : stdin;
+    LmcJob* jobs = NULL;
+
+    if (!file) err(EXIT_FAILURE, "%s", path);
+    jobs = lmc_manifestRead(file, path, 0, count);
+    if (file != stdin) fclose(file);
+    return jobs;
+}
+
+LmcJob* lmc_manifestRead(FILE* file, const char* restrict path, size_t max, size_t* restrict count)
+{
+    LmcJob* jobs = NULL;
+    size_t allocated = 0, size = 0, number = 0;
+    char* line = NULL, * field = NULL, * save = NULL;
+
+    *count = 0;
+    while ((!max || *count < max) && getline(&line, &size, file) >= 0) {
+        ++number;
+        if (!(field = strtok_r(line, " \t\r\n", &save)) || *field == '#') continue;
+        // exponential growth to reduce the reallocarray calls.
+        if (*count == allocated) {
+            allocated = allocated ? allocated * 2 : 16;
+            if (!(jobs = reallocarray(jobs, allocated, sizeof(LmcJob))))
+                err(EXIT_FAILURE, "could not allocate for the jobs");
+        }
+
+        LmcJob* job = &jobs[(*count)++];
+        const char** fields[] = { &job->program, &job->input, &job->expected };
+        *job = (LmcJob){ 0 };
+        for (size_t i = 0; field; ++i, field = strtok_r(NULL, " \t\r\n", &save)) {
+            if (i >= sizeof(fields)/sizeof(*fields)) {
+                errno = EINVAL;
+                err(EXIT_FAILURE, "%s:%zu: too many fields", path, number);
+            }
+            if (i && !strcmp(field, "-")) continue;
+            if (!(*fields[i] = strdup(field)))
+                err(EXIT_FAILURE, "could not allocate for the jobs");
+        }
+    }
+    if (ferror(file)) err(EXIT_FAILURE, "%s", path);
+
+    free(line);
+    return jobs;
+}
+
+void lmc_manifestFree(LmcJob* jobs, size_t count)
+{
+    for (size_t i = 0; jobs && i < count; ++i) {
+        free((char*)jobs[i].program);
+        free((char*)jobs[i].input);
+        free((char*)jobs[i].expected);
+    }
+    free(jobs);
+}
+
+int lmc_batch(const char* restrict bootstrap, const LmcJob* jobs, size_t count, size_t workers, size_t limit, bool pinned)
+{
+    LmcPool pool = {
+        .bootstrap = bootstrap,
+        .jobs      = jobs,
+        .limit     = limit,
+        .lock      = PTHREAD_MUTEX_INITIALIZER,
+        .ready     = PTHREAD_COND_INITIALIZER,
+    };
+    pthread_attr_t attributes;
+    cpu_set_t cpu, allowed;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t skip = 0;
+    int status = EXIT_SUCCESS;
+
+    if (!count) return status;
+    lmc_metricsQueue(count);
+    cpus = cpus > 0 ? cpus : 1;
+    workers = workers ? workers : (size_t)cpus;
+    pool.workers = workers = workers < count ? workers : count;
+    if (!(pool.results = calloc(count, sizeof(LmcResult)))
+        || !(pool.queues = calloc(workers, sizeof(LmcQueue))))
+        err(EXIT_FAILURE, "could not allocate the workers");
+
+    // The jobs are dealt in turn, thus the first ones, which are
+    // reported first, are also run first.
+    for (size_t i = 0; i < workers; ++i) {
+        LmcQueue* queue = &pool.queues[i];
+        if (!(queue->jobs = calloc(count / workers + 1, sizeof(size_t))))
+            err(EXIT_FAILURE, "could not allocate the workers");
+        for (size_t job = i; job < count; job += workers)
+            queue->jobs[queue->tail++] = job;
+        queue->pool = &pool;
+        pthread_mutex_init(&queue->lock, NULL);
+    }
+
+    // The workers are pinned in turn to the processors the process is
+    // allowed to run on, which may not be the first online ones.
+    if (pinned && sched_getaffinity(0, sizeof(allowed), &allowed))
+        err(EXIT_FAILURE, "could not pin the workers");
+    for (size_t i = 0; i < workers; ++i) {
+        if ((errno = pthread_attr_init(&attributes)))
+            err(EXIT_FAILURE, "could not start the workers");
+        if (pinned) {
+            CPU_ZERO(&cpu);
+            skip = i % CPU_COUNT(&allowed);
+            for (int n = 0; n < CPU_SETSIZE; ++n)
+                if (CPU_ISSET(n, &allowed) && !skip--) {
+                    CPU_SET(n, &cpu);
+                    break;
+                }
+            if ((errno = pthread_attr_setaffinity_np(&attributes, sizeof(cpu), &cpu)))
+                err(EXIT_FAILURE, "could not pin the workers");
+        }
+        if ((errno = pthread_create(&pool.queues[i].thread, &attributes, lmc_worker, &pool.queues[i])))
+            err(EXIT_FAILURE, "could not start the workers");
+        pthread_attr_destroy(&attributes);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        pthread_mutex_lock(&pool.lock);
+        while (!pool.results[i].done) pthread_cond_wait(&pool.ready, &pool.lock);
+        pthread_mutex_unlock(&pool.lock);
+
+        lmc_report(&jobs[i], &pool.results[i]);
+        if (pool.results[i].limited || !pool.results[i].passed || *pool.results[i].error.message)
+            status = EXIT_FAILURE;
+        free(pool.results[i].output);
+    }
+
+    for (size_t i = 0; i < workers; ++i) {
+        pthread_join(pool.queues[i].thread, NULL);
+        pthread_mutex_destroy(&pool.queues[i].lock);
+        free(pool.queues[i].jobs);
+    }
+    free(pool.queues);
+    free(pool.results);
+    return status;
+}
+
+void lmc_json(FILE* file, const char* restrict string, size_t size)
+{
+    fputc('"', file);
+    for (size_t i = 0; i < size; ++i) {
+        unsigned char c = string[i];
+        if (c == '"' || c == '\\') fprintf(file, "\\%c", c);
+        else if (c == '\n') fprintf(file, "\\n");
+        else if (c < 0x20 || c > 0x7e) fprintf(file, "\\u%04x", c);
+        else fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+static void* lmc_worker(void* queue)
+{
+    LmcQueue* self = queue;
+    LmcPool* pool = self->pool;
+    size_t job = 0, victim = self - pool->queues;
+
+    // The jobs are never added once the workers are started, thus
+    // the worker stops when all the queues are empty.
+    for (size_t tries = 0; tries < pool->workers;) {
+        if (lmc_take(&pool->queues[victim], victim != (size_t)(self - pool->queues), &job)) {
+            lmc_run(pool, job);
+            tries = 0;
+        }
+        else {
+            victim = (victim + 1) % pool->workers;
+            ++tries;
+        }
+    }
+    return NULL;
+}
+
+static bool lmc_take(LmcQueue* queue, bool steal, size_t* job)
+{
+    bool taken = false;
+
+    pthread_mutex_lock(&queue->lock);
+    if ((taken = queue->head < queue->tail))
+        *job = queue->jobs[steal ? --queue->tail : queue->head++];
+    pthread_mutex_unlock(&queue->lock);
+    return taken;
+}
+
+static void lmc_run(LmcPool* pool, size_t index)
+{
+    const LmcJob* job = &pool->jobs[index];
+    const char* input = job->input ? job->input : "/dev/null";
+    LmcResult result = { .passed = true, .done = true };
+    struct timespec start = { 0 }, end = { 0 };
+    LmcSession* session = NULL;
+    FILE* output = NULL;
+    int in = -1, expected = -1;
+    char* content = NULL;
+    size_t size = 0;
+
+    lmc_metricsQueue(-1);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    // A missing file only fails its own job: the files are opened
+    // first, and the program and bootstrap errors are caught.
+    if ((in = open(input, O_RDONLY | O_CLOEXEC)) < 0) lmc_fail(&result, input);
+    else if (job->expected && (expected = open(job->expected, O_RDONLY | O_CLOEXEC)) < 0)
+        lmc_fail(&result, job->expected);
+    else if (!(output = tmpfile())) lmc_fail(&result, "the captured output");
+    else if (!(session = lmc_open(pool->bootstrap, job->program, in, fileno(output), &result.error)))
+        result.passed = false;
+
+    if (session) {
+        session->vm.bus.prompt = "";
+        session->limit = pool->limit;
+        // The files never block, but the input may be a pipe.
+        while (lmc_sessionResume(session))
+            poll(&(struct pollfd){
+                    .fd     = session->events & POLLIN ? session->in : session->out,
+                    .events = session->events,
+                }, 1, -1);
+        result.limited = pool->limit && session->steps > pool->limit;
+        result.cycles  = result.limited ? pool->limit : session->steps;
+        result.status  = lmc_sessionClose(session);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        result.time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+        result.output = lmc_slurp(fileno(output), "the captured output", &result.size);
+        if (job->expected) {
+            content = lmc_slurp(expected, job->expected, &size);
+            result.passed = size == result.size && !memcmp(content, result.output, size);
+            free(content);
+        }
+    }
+    if (output) fclose(output);
+    if (in >= 0) close(in);
+    if (expected >= 0) close(expected);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->results[index] = result;
+    pthread_cond_signal(&pool->ready);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static LmcSession* lmc_open(const char* restrict bootstrap, const char* restrict program, int in, int out, LmcError* error)
+{
+    LmcSession* session = NULL;
+    jmp_buf handler;
+
+    if (setjmp(handler)) return NULL;
+    lmc_catch(&handler, error);
+    session = lmc_sessionOpen(bootstrap, program, in, out);
+    lmc_catch(NULL, NULL);
+    // The caught warnings are not errors.
+    if (*error->message) warnx("%s", error->message);
+    *error = (LmcError){ 0 };
+    return session;
+}
+
+static void lmc_fail(LmcResult* restrict result, const char* restrict path)
+{
+    result->error.code = errno;
+    snprintf(result->error.message, LMC_MAXERROR, "%s: %s", path, strerror(errno));
+    result->passed = false;
+}
+
+static char* lmc_slurp(int fd, const char* restrict path, size_t* restrict size)
+{
+    char* content = NULL;
+    ssize_t done = 0;
+
+    *size = 0;
+    if (lseek(fd, 0, SEEK_SET) < 0) err(EXIT_FAILURE, "%s", path);
+    do {
+        if (!(content = realloc(content, *size + BUFSIZ)))
+            err(EXIT_FAILURE, "%s", path);
+        if ((done = read(fd, &content[*size], BUFSIZ)) < 0)
+            err(EXIT_FAILURE, "%s", path);
+        *size += done;
+    } while (done);
+    return content;
+}
+
+static void lmc_report(const LmcJob* restrict job, const LmcResult* restrict result)
+{
+    printf("{\"program\":");
+    lmc_json(stdout, job->program, strlen(job->program));
+    if (*result->error.message) {
+        printf(",\"status\":null,\"error\":");
+        lmc_json(stdout, result->error.message, strlen(result->error.message));
+        printf("}\n");
+        fflush(stdout);
+        return;
+    }
+    if (result->limited) printf(",\"status\":null");
+    else printf(",\"status\":%u", result->status);
+    printf(",\"output\":");
+    lmc_json(stdout, result->output, result->size);
+    printf(",\"cycles\":%zu,\"time\":%.6f", result->cycles, result->time);
+    if (job->expected) printf(",\"pass\":%s", result->passed ? "true" : "false");
+    printf("}\n");
+    fflush(stdout);
+}
+
+/** @} */
@@ -0,0 +1,89 @@
+/**
+ * @file      binary.c
+ * @version   0.1.0
+ * @brief     LMC compiled programs formats module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup BinaryInternals
+ * @{
+ */
+
+#include "lmc/binary.h"
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * Implementation
+ ******************************************************************************/
+// clang-format on
+
+uint32_t lmc_checksum(const LmcRam* data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+size_t lmc_binarySize(const LmcRam* data, size_t size)
+{
+    const LmcBinaryHeader* header = (const LmcBinaryHeader*)data;
+    const LmcSegment* segments = (const LmcSegment*)&data[sizeof(LmcBinaryHeader)];
+    size_t needed = sizeof(LmcBinaryHeader);
+
+    if (size < needed) return needed;
+    needed += header->count * sizeof(LmcSegment);
+    if (size < needed) return needed;
+    for (size_t i = 0; i < header->count; ++i) needed += segments[i].size;
+    return needed;
+}
+
+int lmc_binaryRead(const char* restrict path, const LmcRam* data, size_t size, LmcBinary* binary)
+{
+    const LmcBinaryHeader* header = (const LmcBinaryHeader*)data;
+    size_t table = sizeof(LmcBinaryHeader);
+
+    if (size < sizeof(header->magic) || memcmp(header->magic, LMC_BINMAGIC, sizeof(header->magic)))
+        return 0;
+    if (size < table || header->version != LMC_BINVERSION) {
+        errno = ENOEXEC;
+        lmc_warn("%s: unknown program format", path);
+        return -1;
+    }
+
+    *binary = (LmcBinary){
+        .entry    = header->entry,
+        .count    = header->count,
+        .segments = (const LmcSegment*)&data[table],
+        .contents = &data[table + header->count * sizeof(LmcSegment)],
+        .size     = table + header->count * sizeof(LmcSegment),
+    };
+    if (binary->size > size) goto truncated;
+    for (size_t i = 0; i < binary->count; ++i) {
+        if (binary->segments[i].address + binary->segments[i].size > LMC_MAXRAM) {
+            errno = EFAULT;
+            lmc_warn("%s: segment " LMC_HEXFMT " overflows the memory",
+                     path, LMC_MAXDIGITS, binary->segments[i].address);
+            return -1;
+        }
+        binary->size += binary->segments[i].size;
+    }
+    if (binary->size > size) goto truncated;
+
+    if (lmc_checksum(&data[table], binary->size - table) != le32toh(header->checksum)) {
+        errno = EBADMSG;
+        lmc_warn("%s: corrupted program", path);
+        return -1;
+    }
+    return 1;
+
+truncated:
+    errno = ENOEXEC;
+    lmc_warn("%s: truncated program (%zu bytes)", path, size);
+    return -1;
+}
+
+/** @} */
@@ -13,6 +13,33 @@
 
 #include "lmc/compiler.h"
 
+/**
+ * @var lmc_segments
+ * @since 0.1.0
+ * @brief The segments of the program being compiled.
+ */
+static struct {
+    LmcSegment table[LMC_MAXSEGMENTS]; /**< The segments. */
+    size_t count;                      /**< The number of segments. */
+} lmc_segments;
+
+/**
+ * @var lmc_lines
+ * @since 0.1.0
+ * @brief The source lines of the addresses destination, set by
+ * lmc_sourceLines(), or @c NULL.
+ */
+static unsigned int* lmc_lines = NULL;
+
+/**
+ * @since 0.1.0
+ * @brief Parse a source file.
+ * @param source The source file path.
+ * @param lexer The translation information.
+ * @return non-null in case of errors, otherwise @c 0.
+ */
+static int lmc_parse(const char* restrict source, LmcLexer* lexer) __attribute__((nonnull));
+
 /**
  * @since 0.1.0
  * @brief Add a (instruction, argument) bytecodes couple to the
@@ -25,7 +52,7 @@ static void lmc_compilerCallback(LmcRamArray* array, LmcRam code, LmcRam value);
 /**
  * @since 0.1.0
  * @brief Write the translated program bytecode into the destination
- * file.
+ * file, as a version 2 program (see #LmcBinaryHeader).
  * @param lexer The translation information.
  * @param path The destination file path.
  */
@@ -46,26 +73,15 @@ int lmc_compile(const char* source, const char* dest)
     int status = 0;
     const char* output = dest && *dest ? dest : LMC_BIN;
 
-    // Init the start position at LMC_MAXROM+3 as it is the first
-    // writable memory slot after the last bootstrap JUMP instruction
-    // argument slot and the two slots used for calculation of the
-    // remaining bytes to load (thus in RAM, but loosely considered
-    // part of ROM). This is a default value tied to the default
-    // bootstrap, and that can be changed in the source of the
-    // compiled program.
-    LmcRam array[LMC_MAXRAM] = { [LMC_STARTPOS] = LMC_MAXROM + 3 };
+    LmcRam array[LMC_MAXRAM] = { 0 };
 
     LmcLexer lexer = {
-        // .current value reserves space for the header.
-        .values   = { .values = array, .max = LMC_MAXRAM, .current = LMC_MAXHEADER, },
+        .values   = { .values = array, .max = LMC_MAXRAM, },
         .callback = lmc_compilerCallback,
         .desc     = source,
     };
 
-    if (!(yyin = fopen(source, "r"))) err(EXIT_FAILURE, "%s", source);
-    status = yyparse(&lexer);
-    fclose(yyin);
-
+    status = lmc_parse(source, &lexer);
     if (!status) {
         lmc_compilerWrite(&lexer, output);
         // Print the final destination for clarity.
@@ -75,15 +91,82 @@ int lmc_compile(const char* source, const char* dest)
     return status;
 }
 
+int lmc_sourceLines(const char* source, unsigned int* lines)
+{
+    int status = 0;
+    LmcRam array[LMC_MAXRAM] = { 0 };
+    LmcLexer lexer = {
+        .values   = { .values = array, .max = LMC_MAXRAM, },
+        .callback = lmc_compilerCallback,
+        .desc     = source,
+    };
+
+    memset(lines, 0, LMC_MAXRAM * sizeof(unsigned int));
+    lmc_lines = lines;
+    yylineno  = 1;
+    status = lmc_parse(source, &lexer);
+    lmc_lines = NULL;
+    return status;
+}
+
+static int lmc_parse(const char* restrict source, LmcLexer* lexer)
+{
+    int status = 0;
+
+    // Init the start position at LMC_MAXROM+3 as it is the first
+    // writable memory slot after the last bootstrap JUMP instruction
+    // argument slot and the two slots used for calculation of the
+    // remaining bytes to load (thus in RAM, but loosely considered
+    // part of ROM). This is a default value tied to the default
+    // bootstrap, and that can be changed in the source of the
+    // compiled program. The first segment starts at the start
+    // position.
+    lmc_segments.table[0] = (LmcSegment){ .address = LMC_MAXROM + 3, };
+    lmc_segments.count = 1;
+
+    // The scanner may have been left in the middle of a previous
+    // source by a caught fatal error.
+    if (!(yyin = fopen(source, "r"))) lmc_err("%s", source);
+    yyrestart(yyin);
+    // Only the parser is timed, without the file opening.
+    {
+        lmc_timing(LMC_TPARSE);
+        status = yyparse(lexer);
+    }
+    fclose(yyin);
+    yyin = NULL;
+    return status;
+}
+
 static void lmc_compilerCallback(LmcRamArray* array, LmcRam code, LmcRam value)
 {
+    LmcSegment* current = &lmc_segments.table[lmc_segments.count - 1];
+
     switch(code)
     {
-    case START:       array->values[LMC_STARTPOS] += value; break;
-    case START | VAR: array->values[LMC_STARTPOS]  = value; break;
+    case START:       lmc_segments.table[0].address += value; break;
+    case START | VAR: lmc_segments.table[0].address  = value; break;
+    case SEGMENT:
+        // An empty segment is only moved, except the first one which
+        // starts at the start position.
+        if (current->size || lmc_segments.count == 1) {
+            if (lmc_segments.count >= LMC_MAXSEGMENTS) {
+                errno = ENOMEM;
+                lmc_err("too many segments at " LMC_HEXFMT, LMC_MAXDIGITS, value);
+            }
+            current = &lmc_segments.table[lmc_segments.count++];
+        }
+        *current = (LmcSegment){ .address = value, };
+        break;
     default:
+        // The couple is reduced once its argument is read, or once
+        // its line end is read if it has none.
+        if (lmc_lines)
+            lmc_lines[(current->address + current->size) % LMC_MAXRAM]
+                = lmc_lines[(current->address + current->size + 1) % LMC_MAXRAM]
+                = (unsigned int)yylineno - (*yytext == '\n');
         lmc_append(array, code, value);
-        array->values[LMC_SIZE] = array->current - LMC_MAXHEADER;
+        current->size += 2;
         break;
     }
 }
@@ -91,9 +174,36 @@ static void lmc_compilerCallback(LmcRamArray* array, LmcRam code, LmcRam value)
 static void lmc_compilerWrite(LmcLexer* lexer, const char* restrict path)
 {
     FILE* output = NULL;
+    bool written = false;
     size_t towrite = lexer->values.current;
-    if (!(output = fopen(path, "w"))
-        || fwrite(lexer->values.values, sizeof(LmcRam), towrite, output) != towrite)
-        err(EXIT_FAILURE, "%s", path);
-    fclose(output);
+    size_t table = lmc_segments.count * sizeof(LmcSegment);
+    LmcRam image[sizeof(lmc_segments.table) + LMC_MAXRAM];
+    LmcBinaryHeader header = {
+        .magic   = LMC_BINMAGIC,
+        .version = LMC_BINVERSION,
+        .entry   = lmc_segments.table[0].address,
+        .count   = lmc_segments.count,
+    };
+    lmc_timing(LMC_TCOMPWRITE);
+
+    for (size_t i = 0; i < lmc_segments.count; ++i)
+        if (lmc_segments.table[i].address + lmc_segments.table[i].size > LMC_MAXRAM) {
+            errno = ENOMEM;
+            lmc_err("%s: segment " LMC_HEXFMT " overflows the memory",
+                    lexer->desc, LMC_MAXDIGITS, lmc_segments.table[i].address);
+        }
+
+    // The checksum covers the segments table and contents, which are
+    // contiguous in the file.
+    memcpy(image, lmc_segments.table, table);
+    memcpy(&image[table], lexer->values.values, towrite);
+    header.checksum = htole32(lmc_checksum(image, table + towrite));
+
+    // The errors may be caught, thus the file is closed before
+    // raising them. The buffered write errors are only known once
+    // closed.
+    if (!(output = fopen(path, "w"))) lmc_err("%s", path);
+    written = fwrite(&header, sizeof(header), 1, output) == 1
+           && fwrite(image, sizeof(LmcRam), table + towrite, output) == table + towrite;
+    if (fclose(output) || !written) lmc_err("%s", path);
 }
@@ -13,6 +13,16 @@
 
 #include "lmc/computer.h"
 
+#ifdef _STATS
+#include "lmc/compiler.h"
+#endif
+
+#ifdef __has_include
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#endif
+#endif
+
 // clang-format off
 
 /******************************************************************************
@@ -21,6 +31,24 @@
  ******************************************************************************/
 // clang-format on
 
+/**
+ * @struct LmcStage
+ * @since 0.1.0
+ * @brief A pipeline stage.
+ */
+typedef struct LmcStage {
+    const char* bootstrap; /**< The compiled bootstrap file path. */
+    const char* file;      /**< The compiled program file path. */
+    LmcRing* in;           /**< The input ring, or @c NULL. */
+    LmcRing* out;          /**< The output ring, or @c NULL. */
+    pthread_t thread;      /**< The stage thread. */
+    LmcRam status;         /**< The program exit status. */
+#ifdef _HOOKS
+    LmcHooks hooks;        /**< The callbacks of the thread starting
+                            * the pipeline. */
+#endif
+} LmcStage;
+
 /**
  * @since 0.1.0
  * @brief Execute a compiled program with or without the debugger.
@@ -28,119 +56,95 @@
  * @param filepath The file path of the compiled program. @c NULL
  * switches to interactive mode (manual programmation).
  * @param debug Use the debugger if @c true.
+ * @param stage The pipeline stage, or @c NULL.
  * @return The word register value at shutdown.
  */
-static LmcRam lmc_exec(const char* restrict bootstrap, const char* restrict filepath, bool debug);
-
-/**
- * @since 0.1.0
- * @brief Load a bootstrap in #lmc_hal::mem::ram ROM section.
- *
- * This function may raise a fatal error if @p path cannot be
- * @c rb opened.
- *
- * @param path The compiled bootstrap file path.
- */
-static void lmc_bootstrap(const char* restrict path) __attribute__((nonnull));
-
-// clang-format off
-
-/******************************************************************************
- * @}
- * @name Debugging
- * @{
- ******************************************************************************/
-// clang-format on
+static LmcRam lmc_exec(const char* restrict bootstrap, const char* restrict filepath, bool debug, const LmcStage* stage);
 
 /**
  * @since 0.1.0
- * @def LMC_DBGPROMPT
- * @since 0.1.0
- * @brief The debug mode prompt outputted on #lmc_hal::bus::output.
+ * @brief Execute a pipeline stage, and close its rings at shutdown.
+ * @param stage The stage (a #LmcStage).
+ * @return @c NULL.
  */
-#define LMC_DBGPROMPT                                       \
-    "PC: " LMC_HEXFMT ", ACC: " LMC_HEXFMT " " LMC_PROMPT,  \
-        LMC_MAXDIGITS, lmc_hal.cu.pc,                       \
-        LMC_MAXDIGITS, lmc_hal.alu.acc
+static void* lmc_stage(void* stage) __attribute__((nonnull));
 
 /**
  * @since 0.1.0
- * @brief Step in the debugger.
- * @return @c true to execute the next program instruction, @c false
- * to immediately re-step in the debugger.
+ * @brief Reset #lmc_hal, load the bootstrap and the program, and
+ * switch the computer on.
+ * @param bootstrap The compiled bootstrap file path.
+ * @param filepath The file path of the compiled program. @c NULL
+ * switches to interactive mode (manual programmation).
+ * @param debug Use the debugger if @c true.
+ * @param stage The pipeline stage, or @c NULL.
  */
-static bool lmc_debug(void);
+static void lmc_boot(const char* restrict bootstrap, const char* restrict filepath, bool debug, const LmcStage* stage);
 
 /**
+ * @struct LmcShard
  * @since 0.1.0
- * @brief Debugger phase 1.
- *
- * Print the current PC address value if it is stored in
- * #lmc_hal::dbg::prt and indicate if the computer must go into the
- * debugger second phase.
- *
- * @return @c false to skip the next debug phase, @c true to execute
- * it.
+ * @brief The sessions of a scheduler thread.
  */
-static bool lmc_dbg_phaseOne(void);
+typedef struct LmcShard {
+    LmcSession* const* sessions; /**< The first session. */
+    size_t count;                /**< The number of sessions. */
+    size_t step;                 /**< The distance between two
+                                  * sessions. */
+    pthread_t thread;            /**< The scheduler thread. */
+} LmcShard;
 
 /**
  * @since 0.1.0
- * @brief Debugger phase 2.
- *
- * Print #lmc_hal::cu::pc and #lmc_hal::alu:acc, then wait for
- * instructions input.
+ * @brief Resume the sessions of a shard when their file descriptors
+ * are ready, until they are all stopped.
+ * @param shard The shard (a #LmcShard).
+ * @return @c NULL.
  */
-static void lmc_dbg_phaseTwo(void);
+static void* lmc_scheduler(void* shard) __attribute__((nonnull));
 
 /**
  * @since 0.1.0
- * @brief Debugger phase 3.
+ * @brief Load a bootstrap in #lmc_hal::mem::ram ROM section.
  *
- * Execute the instructions input at phase 2.
+ * This function may raise a fatal error if @p path cannot be
+ * @c rb opened.
  *
- * @return @c true to immediately re-step in the debugger, @c false to
- * continue the program execution.
- */
-static bool lmc_dbg_phaseThree(void);
-
-/**
- * @since 0.1.0
- * @brief Print all the values between two #lmc_hal::mem::ram
- * addresses.
- * @param start,end The memory start and end address for the dump.
+ * @param path The compiled bootstrap file path.
  */
-static void lmc_dump(LmcRam start, LmcRam end);
+static void lmc_bootstrap(const char* restrict path) __attribute__((nonnull));
 
 // clang-format off
 
 /******************************************************************************
  * @}
- * @name LMC phases.
+ * @name Debugging
  * @{
  ******************************************************************************/
 // clang-format on
 
 /**
  * @since 0.1.0
- * @brief LMC Phase 1: seek for the next instruction.
- */
-static void lmc_phaseOne(void);
-
-/**
+ * @def LMC_DBGPROMPT
  * @since 0.1.0
- * @brief LMC phase 2: decode the instruction, seek the operand, and
- * apply the instruction.
- * @param debug Indicate if the phase is executed from the debugger.
- * @return @c true to execute phase 3, @c false to skip it.
+ * @brief The debug mode prompt outputted on #lmc_hal::bus::output.
  */
-static bool lmc_phaseTwo(bool debug);
+#define LMC_DBGPROMPT                                       \
+    "PC: " LMC_HEXFMT ", ACC: " LMC_HEXFMT " " LMC_PROMPT,  \
+        LMC_MAXDIGITS, lmc_hal.cu.pc,                       \
+        LMC_MAXDIGITS, lmc_hal.alu.acc
 
 /**
  * @since 0.1.0
- * @brief LMC phase 3: increment PC.
+ * @brief Print all the values between two #lmc_hal::mem::ram
+ * addresses.
+ *
+ * The dump is formatted row by row, as all the addresses are
+ * readable.
+ *
+ * @param start,end The memory start and end address for the dump.
  */
-static void lmc_phaseThree(void);
+static void lmc_dump(LmcRam start, LmcRam end);
 
 // clang-format off
 
@@ -184,33 +188,69 @@ static void lmc_phaseThree(void);
 #define LMC_PROMPT "? >"
 
 /**
- * @def LMC_WRDVAL
  * @since 0.1.0
- * @brief #lmc_hal::mem::cache::wr value printable using a printf()
- * family function (no arguments needed).
+ * @brief Handle bus input.
+ *
+ * @attention This function may raise a fatal error if @p filepath
+ * cannot be read.
+ *
+ * @param filepath A compiled program file path, or @c NULL for user
+ * direct input.
+ * @return @c false if @p filepath is @c NULL and user sends @c EOF,
+ * (thus a "QUIT" signal) otherwise @p true.
  */
-#define LMC_WRDVAL LMC_HEXFMT, LMC_MAXDIGITS, lmc_hal.mem.cache.wr
+static bool lmc_setInput(const char* restrict filepath);
 
 /**
  * @since 0.1.0
- * @brief Wait for input from #lmc_hal::bus::input and store it in
- * #lmc_hal::bus::buffer.
+ * @brief Load a compiled program file in #lmc_hal::bus::program.
+ *
+ * Regular files are mapped in memory, the others are read at once.
+ * This function may raise a fatal error if @p path cannot be read.
+ *
+ * @param path The compiled program file path.
  */
-static void lmc_busInput(void);
+static void lmc_load(const char* restrict path) __attribute__((nonnull));
 
 /**
  * @since 0.1.0
- * @brief Handle bus input.
+ * @brief Prepare the execution of the program loaded in
+ * #lmc_hal::bus::program.
  *
- * @attention This function may raise a fatal error if @p filepath
- * cannot be @c rb opened.
+ * A version 2 program is placed in memory, and a version 1 program
+ * header is checked. This function may raise a fatal error if the
+ * program is invalid.
  *
- * @param filepath A compiled program file path, or @c NULL for user
- * direct input.
- * @return @c false if @p filepath is @c NULL and user sends @c EOF,
- * (thus a "QUIT" signal) otherwise @p true.
+ * @param path The program file path, for the errors messages.
  */
-static bool lmc_setInput(const char* restrict filepath);
+static void lmc_prepare(const char* restrict path) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Place the segments of a version 2 program in memory and jump
+ * to its entry point.
+ * @param path The program file path, for the warnings.
+ * @param binary The program.
+ * @return @c false if a segment is in the ROM, otherwise @c true.
+ */
+static bool lmc_place(const char* restrict path, const LmcBinary* binary) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Release a compiled program loaded by lmc_load().
+ * @param program The program.
+ */
+static void lmc_unload(LmcProgram* program) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Copy bytes from #lmc_hal::bus::program.
+ * @param dest The destination.
+ * @param size The number of bytes to copy.
+ * @return The number of bytes copied, less than @p size only at the
+ * end of the program file.
+ */
+static size_t lmc_programRead(LmcRam* dest, size_t size) __attribute__((nonnull));
 
 /**
  * @since 0.1.0
@@ -222,247 +262,1361 @@ static bool lmc_setInput(const char* restrict filepath);
 static int lmc_convert(const char* restrict number) __attribute__((nonnull));
 
 /**
- * @def lmc_busPrint
  * @since 0.1.0
- * @brief Print a formatted message on #lmc_hal::bus::output.
- * @param fmt The format string.
- * @param ... The format string arguments.
+ * @brief Wait for input from #lmc_hal::bus::data and store it in
+ * #lmc_hal::bus::buffer.
+ *
+ * The computer is shut down at the end of the stream.
  */
-#define lmc_busOutput(fmt, ...) fprintf(lmc_hal.bus.output, fmt, ##__VA_ARGS__)
+static void lmc_streamInput(void);
 
-// clang-format off
-
-/******************************************************************************
- * @}
- * @name Operations
- * @{
- ******************************************************************************/
-// clang-format on
+/**
+ * @since 0.1.0
+ * @brief Get the next byte of #lmc_hal::bus::data, refilling its ring
+ * if empty.
+ * @return The byte, or @c EOF at the end of the stream.
+ */
+static int lmc_streamGet(void);
 
 /**
- * since 0.1.0
- * @brief Check if #lmc_hal::alu::opcode value must change.
- * @param operation The operation bytecode without indirection
- * instructions.
+ * @since 0.1.0
+ * @brief Copy raw bytes from #lmc_hal::bus::data.
+ * @param dest The destination.
+ * @param size The number of bytes to copy.
+ * @return The number of bytes copied, less than @p size only at the
+ * end of the stream.
  */
-static void lmc_opcalc(LmcRam operation);
+static size_t lmc_streamRead(LmcRam* dest, size_t size) __attribute__((nonnull));
 
 /**
  * @since 0.1.0
- * @brief Fetch the value of the current #lmc_hal::mem::cache::sr
- * address, applying the indicated indirection level.
- * @param type The indirection level (@c 0, #VAR or #VAR|#PTR).
+ * @brief Read a word from #lmc_hal::bus::session and store it in
+ * #lmc_hal::bus::buffer, suspending the session until it is complete.
+ *
+ * The computer is shut down at the end of the input, or once
+ * #LMC_SESSIONINVALID invalid words are read.
  */
-static void lmc_indirection(LmcRam type);
+static void lmc_sessionInput(void);
 
 /**
  * @since 0.1.0
- * @brief Execute an operation.
- * @param operation The operation bytecode without indirection
- * instructions.
+ * @brief Copy raw bytes from #lmc_hal::bus::session, suspending the
+ * session until they are all read.
+ *
+ * The copy starts at #lmc_hal::bus::resume.
+ *
+ * @param dest The destination.
+ * @param size The number of bytes to copy.
+ * @return The number of bytes copied, less than @p size only at the
+ * end of the input.
  */
-static bool lmc_operation(LmcRam operation);
+static size_t lmc_sessionRead(LmcRam* dest, size_t size) __attribute__((nonnull));
 
 /**
+ * @def LMC_REJECTED
  * @since 0.1.0
- * @brief Execute the arithmetic instruction store in
- * #lmc_hal::alu::opcode with the #lmc_hal::mem::cache::wr and
- * #lmc_hal::alu::acc operands.
+ * @brief The answer of a session whose program image is invalid,
+ * instead of its status.
  */
-static void lmc_calc(void);
+#define LMC_REJECTED "\nerror: invalid program\n"
 
 /**
  * @since 0.1.0
- * @brief Read/Write in #lmc_hal::mem::ram.
+ * @brief Read and place a version 2 program image from
+ * #lmc_hal::bus::session.
  *
- * This function checks that the address and operation are valid,
- * i.e. that ROM is read-only and RAM is read-write. The function
- * raises an @c EFAULT error if not and cleanly shutdowns the
- * computer.
+ * A version 1 image is left to the bootstrap, and the computer is shut
+ * down if the image is invalid, answering #LMC_REJECTED.
  *
- * @param address The read memory address, or write destination address.
- * @param value The storage destination for read mode, the source
- * value for write mode.
- * @param mode The mode, either 'r' for read or 'w' for write.
+ * @return @c false if the image is incomplete and no input is
+ * available yet, otherwise @c true.
  */
-static void lmc_rwMemory(LmcRam address, LmcRam* value, char mode) __attribute__((nonnull (2)));
+static bool lmc_sessionBinary(void);
 
-#ifdef _UCODES
+/**
+ * @since 0.1.0
+ * @brief Read the header line of #lmc_hal::bus::session, and lower
+ * its instructions limit accordingly.
+ *
+ * The computer is shut down, without status, if the header is
+ * invalid.
+ *
+ * @return @c false if the line is incomplete and no input is
+ * available yet, otherwise @c true.
+ */
+static bool lmc_sessionHeader(void);
 
-// clang-format off
-
-/******************************************************************************
- * @}
- * @name Microcodes
+/**
+ * @since 0.1.0
+ * @brief Read the available input of #lmc_hal::bus::session.
+ * @return @c false if no input is available yet, otherwise @c true.
+ */
+static bool lmc_sessionFill(void);
+
+/**
+ * @since 0.1.0
+ * @brief Write as much of #lmc_hal::bus::outbuf as possible on the
+ * #lmc_hal::bus::session output.
  *
- * This section is optional, can optionally be loaded at compile-time
- * for a deeper level of emulation, by defining the #_UCODES macro.
- * @{
- ******************************************************************************/
-// clang-format on
+ * The computer is shut down if the output is closed.
+ */
+static void lmc_sessionFlush(void);
 
 /**
- * @enum LmcUcodes
  * @since 0.1.0
- * @brief The microcodes.
+ * @brief Suspend #lmc_hal::bus::session, rolling back the current
+ * instruction.
+ * @param events The poll(2) events to wait for.
  */
-typedef enum __attribute__ ((__packed__)) LmcUcodes {
-    PCTOSR = 1, /**< 01 Write #lmc_hal::cu:pc in #lmc_hal::mem::cache::sr. */
-    WRTOPC,     /**< 02 Write #lmc_hal::mem::cache::wr in #lmc_hal::cu::pc. */
-    WRTOAC,     /**< 03 Write #lmc_hal::mem::cache::wr in #lmc_hal::alu::acc. */
-    ACTOWR,     /**< 04 Write #lmc_hal::alu::acc in #lmc_hal::mem::cache::wr. */
-    WRTOOP,     /**< 05 Write #lmc_hal::mem::cache::wr in #lmc_hal::alu::opcode. */
-    WRTOAD,     /**< 06 Write #lmc_hal::mem::cache::wr in #lmc_hal::cu::ir::ad. */
-    ADTOSR,     /**< 07 Write #lmc_hal::cu::ir::ad in #lmc_hal::mem::cache::sr. */
-    INTOWR,     /**< 08 Write #lmc_hal::bus::buffer in #lmc_hal::mem::cache::wr. */
-    WRTOOU,     /**< 09 Write #lmc_hal::mem::cache::wr in #lmc_hal::bus::output. */
-    ADDOPD,     /**< 10 Write #ADD in #lmc_hal::alu::opcode. */
-    SUBOPD,     /**< 11 Write #SUB in #lmc_hal::alu::opcode. */
-    DOCALC,     /**< 12 Execute the instruction stored in #lmc_hal::alu::opcode. */
-    SVTOWR,     /**< 13 Write the memory slot value pointed by #lmc_hal::mem::cache::sr in #lmc_hal::mem::cache::wr. */
-    WRTOSV,     /**< 14 Write #lmc_hal::mem::cache::wr in the memory slot pointed by #lmc_hal::mem::cache::sr. */
-    INCRPC,     /**< 15 Increment #lmc_hal::cu::pc. */
-    WINPUT,     /**< 16 Wait for input in #lmc_hal::bus::input. */
-    NANDOP,     /**< 17 Write #NAND in #lmc_hal::alu::opcode. */
-    LMCHLT,     /**< 18 Set #lmc_hal::on to @c false. */
-} LmcUcodes;
+static void lmc_suspend(short events) __attribute__((noreturn));
 
 /**
+ * @var lmc_yield
  * @since 0.1.0
- * @brief Execute a series of microcodes operations.
- * @attention Needs a @c NULL sentinel value.
- * @param ucode A microcode.
- * @param ... The remaining microcodes with a @c NULL as last
- * argument.
+ * @brief The session suspension point.
  */
-static void lmc_useries(unsigned int ucode, ...) __attribute__((sentinel));
+static __thread jmp_buf lmc_yield;
 
 /**
+ * @var lmc_saved
  * @since 0.1.0
- * @brief Execute one microcode operation.
- * @param ucode The microcode.
+ * @brief The registers at the start of the current session
+ * instruction, restored on suspension.
  */
-static void lmc_ucode(LmcUcodes ucode);
+static __thread struct {
+    __typeof__(((LmcMemory*)0)->cache) cache; /**< The memory cache. */
+    LmcControlUnit cu;                        /**< The control unit. */
+    LmcLogicUnit alu;                         /**< The logic unit. */
+    const char* prompt;                       /**< The input prompt. */
+#ifdef _STATS
+    size_t reads;                             /**< The bytes read. */
+    size_t faults;                            /**< The ROM faults. */
+    size_t ucodes;                            /**< The microcodes. */
+#endif
+} lmc_saved;
 
-#endif // _UCODES
+/**
+ * @var lmc_restart
+ * @since 0.1.0
+ * @brief The current session instruction is restarted after a
+ * suspension, thus already counted and its fetch and operand already
+ * reported.
+ */
+static __thread bool lmc_restart = false;
 
-// clang-format off
-
-/******************************************************************************
- * @}
- * @name The LMC.
- * @{
- ******************************************************************************/
+/**
+ * @since 0.1.0
+ * @brief Append raw data to #lmc_hal::bus::outbuf, flushing it when
+ * full.
+ * @param data The data.
+ * @param size The data size.
+ */
+static void lmc_busWrite(const void* restrict data, size_t size) __attribute__((nonnull));
 
 /**
- * @var lmc_hal
  * @since 0.1.0
- * @brief The LMC computer.
+ * @brief Write the #lmc_hal::bus::prompt on the output, and flush it.
+ *
+ * A pipeline stage writes it directly, as its words go to the next
+ * stage.
  */
-static LmcComputer lmc_hal = {0};
+static void lmc_busPrompt(void);
 
 /**
- * @var lmc_template
  * @since 0.1.0
- * @brief A template for #lmc_hal, including a default bootstrap.
+ * @brief Write words on #lmc_hal::bus::pipeout, shutting down the
+ * computer if the next stage is gone.
+ * @param data The words.
+ * @param size The number of words.
  */
-static const LmcComputer lmc_template = {
-    .bus = { .prompt = LMC_PROMPT, },
-    .mem.ram = {
-        // The bootstrap
-        // operation    argument adress  instruction translation (base 16)
-        IN | VAR,       0x20, // 00      in @ 20
-        IN | VAR,       0x22, // 02      in @ 22
-        LOAD | VAR,     0x20, // 04      load @ 20
-        STORE | VAR,    0x21, // 06      store @ 21
-        IN | INDIR,     0x21, // 08      in *@ 21
-        LOAD | VAR,     0x22, // 0a      load @ 22
-        SUB,            0x01, // 0c      sub 01
-        BRZ,    LMC_MAXROM-1, // 0e      brz 1f
-        STORE | VAR,    0x22, // 10      store @ 22
-        LOAD | VAR,     0x21, // 12      load @ 21
-        ADD,            0x01, // 14      add 01
-        JUMP,           0x06, // 16      jump 06
-        // The last instruction is at the end of the ROM, the slots
-        // in-between are set to 0. This instruction does not have a
-        // preset argument, as the latter is the program start address
-        // given by the program header. This instruction is in ROM,
-        // while the address is in RAM.
-        [LMC_MAXROM-1] = JUMP,
-    },
-};
+static void lmc_busPipe(const LmcRam* restrict data, size_t size) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Read words from a ring, waiting while it is empty.
+ * @param ring The ring.
+ * @param dest The destination.
+ * @param size The number of words to read.
+ * @return The number of words read, less than @p size only if the
+ * ring is empty and closed.
+ */
+static size_t lmc_ringRead(LmcRing* ring, LmcRam* dest, size_t size) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Write words in a ring, waiting while it is full.
+ * @param ring The ring.
+ * @param src The words.
+ * @param size The number of words to write.
+ * @return The number of words written, less than @p size only if the
+ * ring is closed.
+ */
+static size_t lmc_ringWrite(LmcRing* ring, const LmcRam* src, size_t size) __attribute__((nonnull));
 
+/**
+ * @since 0.1.0
+ * @brief Wait until a ring index moves, or the ring is closed.
+ *
+ * The ring is polled #LMC_RINGSPIN times, yielding the core between
+ * the polls, before sleeping: the other end usually moves on shortly.
+ * @param ring The ring.
+ * @param index The index moved by the other end.
+ * @param seen The last value seen of @p index.
+ */
+static void lmc_ringWait(LmcRing* ring, const size_t* index, size_t seen) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Wake up the end sleeping on a ring, if any, after one of its
+ * indexes moved or its closing.
+ * @param ring The ring.
+ */
+static void lmc_ringWake(LmcRing* ring) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Write #lmc_hal::bus::outbuf on #lmc_hal::bus::output and
+ * empty it.
+ */
+static void lmc_busFlush(void);
+
+/**
+ * @since 0.1.0
+ * @brief Write data on #lmc_hal::bus::output, or with
+ * #lmc_hal::bus::io.
+ *
+ * The computer is shut down if the callback output is closed.
+ *
+ * @param data The data.
+ * @param size The data size.
+ */
+static void lmc_busOutput(const void* restrict data, size_t size) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Format a value in hexadecimal, on #LMC_MAXDIGITS digits.
+ * @param dest The destination, of at least #LMC_MAXDIGITS characters
+ * (no terminating null byte is written).
+ * @param value The value.
+ * @return The character following the last digit in @p dest.
+ */
+static char* lmc_hex(char* restrict dest, LmcRam value) __attribute__((nonnull));
+
+/**
+ * @var lmc_hexdigits
+ * @since 0.1.0
+ * @brief The hexadecimal digits, indexed by their value.
+ */
+static const char lmc_hexdigits[] = "0123456789abcdef";
+
+// clang-format off
 
 /******************************************************************************
  * @}
- * Implementation
+ * @name Operations
+ * @{
  ******************************************************************************/
 // clang-format on
 
-LmcRam lmc_shell(const char* restrict bootstrap, const char* restrict filepath)
-{ return lmc_exec(bootstrap, filepath, false); }
+/**
+ * @since 0.1.0
+ * @brief Execute the arithmetic instruction store in
+ * #lmc_hal::alu::opcode with the #lmc_hal::mem::cache::wr and
+ * #lmc_hal::alu::acc operands.
+ *
+ * The additions and substractions update #lmc_hal::alu::carry.
+ */
+static void lmc_calc(void);
+
+/**
+ * @since 0.1.0
+ * @brief Emulate a memory access error.
+ *
+ * The function raises an @c EFAULT error and cleanly shutdowns the
+ * computer.
+ *
+ * @param address The faulty memory address.
+ * @param reason A short description of the fault.
+ */
+static void lmc_fault(LmcRam address, const char* restrict reason) __attribute__((nonnull, cold));
+
+/**
+ * @since 0.1.0
+ * @brief Emulate a ROM write error, as lmc_fault().
+ * @param address The faulty memory address.
+ */
+static void lmc_romFault(LmcRam address) __attribute__((cold));
+
+/**
+ * @since 0.1.0
+ * @brief Reserve the #lmc_hal::mem::ram section between @p limit and
+ * #LMC_STACKBASE for the stack, and reset #lmc_hal::cu::sp.
+ *
+ * The stack section can only be written by the stack instructions,
+ * thus #lmc_hal::mem::top is lowered to @p limit. A @p limit of @c 0
+ * frees the stack.
+ *
+ * @param limit The lowest address of the stack.
+ */
+static void lmc_setStack(LmcRam limit);
+
+/**
+ * @def lmc_isStack
+ * @since 0.1.0
+ * @brief Check if an address is in the stack section.
+ * @param address The memory address.
+ * @return @c true if @p address is in the stack, otherwise @c false.
+ */
+#define lmc_isStack(address) (lmc_hal.cu.sl && (address) >= lmc_hal.cu.sl)
+
+/**
+ * @enum LmcBlockParams
+ * @since 0.1.0
+ * @brief Block instructions parameter block indexes.
+ */
+typedef enum LmcBlockParams {
+    LMC_BLKDST = 0, /**< Destination (or first) address. */
+    LMC_BLKSRC,     /**< Source address, or value for #FILL. */
+    LMC_BLKLEN,     /**< Block length. */
+    LMC_BLKMAX,     /**< Parameter block size. */
+} LmcBlockParams;
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * @name Statistics
+ *
+ * This section is optional, and only compiled if the #_STATS macro is
+ * defined; otherwise its hooks expand to nothing.
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+#ifdef _STATS
+
+/**
+ * @enum LmcProfileCaracs
+ * @since 0.1.0
+ * @brief The profiles limits.
+ */
+typedef enum LmcProfileCaracs {
+    LMC_MAXCALLS = 256, /**< Max number of distinct calls (caller, call
+                         * address and callee); the next ones are not
+                         * recorded. */
+    LMC_MAXDEPTH = 256, /**< Max depth of the recorded calls. */
+} LmcProfileCaracs;
+
+/**
+ * @struct LmcCall
+ * @since 0.1.0
+ * @brief A call graph edge.
+ */
+typedef struct LmcCall {
+    LmcRam caller; /**< The calling function. */
+    LmcRam site;   /**< The CALL instruction address. */
+    LmcRam callee; /**< The called function. */
+    size_t count;  /**< Number of calls. */
+    size_t hits;   /**< Instructions executed by the calls. */
+    size_t cycles; /**< Cycles spent by the calls. */
+} LmcCall;
+
+/**
+ * @struct LmcFrame
+ * @since 0.1.0
+ * @brief A call being executed.
+ */
+typedef struct LmcFrame {
+    size_t call;   /**< The LmcProfile::calls index, or #LMC_MAXCALLS
+                    * if not recorded. */
+    LmcRam caller; /**< The calling function. */
+    size_t hits;   /**< Instructions executed before the call. */
+    size_t cycles; /**< Cycles spent before the call. */
+} LmcFrame;
+
+/**
+ * @struct LmcProfile
+ * @since 0.1.0
+ * @brief The execution profile of a program.
+ *
+ * The functions are named by their entry address: the first executed
+ * instruction for the main one, the target of a CALL instruction for
+ * the others. Each address belongs to the function executing it
+ * first.
+ */
+typedef struct LmcProfile {
+    size_t hits[LMC_MAXRAM];      /**< Instructions executed per
+                                   * address. */
+    size_t cycles[LMC_MAXRAM];    /**< Cycles per address: microcodes
+                                   * if the #_UCODES macro is defined,
+                                   * memory accesses otherwise. */
+    LmcRam owner[LMC_MAXRAM];     /**< The function of each address. */
+    LmcCall calls[LMC_MAXCALLS];  /**< The call graph edges. */
+    size_t ncalls;                /**< Number of LmcProfile::calls. */
+    LmcFrame stack[LMC_MAXDEPTH]; /**< The calls being executed. */
+    size_t depth;                 /**< Number of calls being executed,
+                                   * beyond #LMC_MAXDEPTH included. */
+    LmcRam function;              /**< The function being executed. */
+    LmcRam address;               /**< The last instruction address. */
+    LmcRam opcode;                /**< The last instruction opcode. */
+    size_t mark;                  /**< Cycles spent before the last
+                                   * instruction. */
+    bool started;                 /**< An instruction was executed. */
+} LmcProfile;
+
+/**
+ * @since 0.1.0
+ * @brief Count an instruction about to be fetched, mark its addresses
+ * as code, and profile it.
+ */
+static void lmc_statsCycle(void);
+
+/**
+ * @since 0.1.0
+ * @brief Count an executed instruction per opcode.
+ * @param opcode The instruction opcode, indirection included.
+ */
+static void lmc_statsOpcode(LmcRam opcode);
+
+/**
+ * @since 0.1.0
+ * @brief Count the bytes written in a memory section, and the
+ * self-modifying ones.
+ * @param address The section start.
+ * @param length The section length.
+ */
+static void lmc_statsWrite(unsigned int address, LmcRam length);
+
+/**
+ * @since 0.1.0
+ * @brief Start the execution timer, and the profile if requested by
+ * lmc_setProfile().
+ * @param path The program file path, or @c NULL.
+ */
+static void lmc_statsStart(const char* restrict path);
+
+/**
+ * @since 0.1.0
+ * @brief Stop the execution timer, report the statistics if requested
+ * by lmc_setStats(), and write the profile.
+ *
+ * Only the first call after lmc_statsStart() is effective.
+ */
+static void lmc_statsStop(void);
+
+/**
+ * @since 0.1.0
+ * @brief Report the statistics on the standard error.
+ */
+static void lmc_statsReport(void);
+
+/**
+ * @since 0.1.0
+ * @brief Total cycles spent, as counted by LmcProfile::cycles.
+ * @return The cycles.
+ */
+static size_t lmc_statsCost(void);
+
+/**
+ * @since 0.1.0
+ * @brief Profile an instruction about to be fetched.
+ *
+ * The previous instruction cycles are attributed to it, and the calls
+ * and returns are detected once their destination is reached.
+ *
+ * @param profile The profile.
+ * @param address The instruction address.
+ */
+static void lmc_profileStep(LmcProfile* profile, LmcRam address) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Record the end of the last call being executed.
+ * @param profile The profile.
+ */
+static void lmc_profileReturn(LmcProfile* profile) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Write a profile in the callgrind format.
+ * @param profile The profile.
+ */
+static void lmc_profileWrite(const LmcProfile* profile) __attribute__((nonnull));
+
+/**
+ * @def lmc_count
+ * @since 0.1.0
+ * @brief Increase a #lmc_hal::stats counter.
+ * @param counter The LmcStats counter.
+ * @param n The increment.
+ */
+#define lmc_count(counter, n) (lmc_hal.stats.counter += (n))
+
+#else
+
+#define lmc_count(counter, n) ((void) 0)
+#define lmc_statsCycle() ((void) 0)
+#define lmc_statsOpcode(opcode) ((void) 0)
+#define lmc_statsWrite(address, length) ((void) 0)
+#define lmc_statsStart(path) ((void) 0)
+#define lmc_statsStop() ((void) 0)
+
+#endif // _STATS
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * @name Metrics
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+/**
+ * @def lmc_metricsStep
+ * @since 0.1.0
+ * @brief Count an executed instruction in #lmc_steps, and in the
+ * metrics by steps of #LMC_METRICSTEP.
+ */
+#define lmc_metricsStep() \
+    (++lmc_steps & (LMC_METRICSTEP - 1) ? (void) 0 : lmc_metricsAdd(LMC_MINSTRUCTIONS, LMC_METRICSTEP))
+
+/**
+ * @since 0.1.0
+ * @brief Count a stopped program and the instructions not counted yet
+ * in the metrics.
+ * @param failed The program status is not null, or it is stopped by
+ * the instructions limit.
+ */
+static void lmc_metricsDone(bool failed);
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * @name Tracing
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+/**
+ * @since 0.1.0
+ * @brief Open the trace of the program, if requested by
+ * lmc_setTrace().
+ * @param path The program file path, or @c NULL.
+ */
+static void lmc_traceStart(const char* restrict path);
+
+/**
+ * @since 0.1.0
+ * @brief Close the trace of the program, if any.
+ */
+static void lmc_traceStop(void);
+
+/**
+ * @since 0.1.0
+ * @brief Read the replayed input, for LmcIo::read.
+ * @param context The replay (#lmc_replay).
+ * @param dest The destination.
+ * @param size Max number of bytes to read.
+ * @return The number of bytes read.
+ */
+static size_t lmc_replayRead(void* context, LmcRam* dest, size_t size) __attribute__((nonnull));
+
+/**
+ * @def LMC_INSTRUMENTED
+ * @since 0.1.0
+ * @brief Expand the instrumentation sites (traces and hooks).
+ *
+ * The functions out of the instructions cycle are always
+ * instrumented, as they only run a few times per program; the cycle
+ * is compiled with and without the instrumentation (see cycle.h).
+ */
+#define LMC_INSTRUMENTED 1
+
+/**
+ * @def lmc_traced
+ * @since 0.1.0
+ * @brief Call a trace function on #lmc_hal::trace, if the program is
+ * traced.
+ *
+ * In the instructions cycle, the call is only expanded in its
+ * instrumented copy (see cycle.h).
+ *
+ * @param function The trace function.
+ * @param ... Its arguments, following the trace.
+ */
+#define lmc_traced(function, ...) \
+    (LMC_INSTRUMENTED && lmc_hal.trace ? function(lmc_hal.trace, __VA_ARGS__) : (void) 0)
+
+/**
+ * @def lmc_instrumented
+ * @since 0.1.0
+ * @brief Check if the run needs the instrumented cycle.
+ * @return @c true if the program is traced or hooked, otherwise
+ * @c false.
+ */
+#define lmc_instrumented() (lmc_hal.trace != NULL || lmc_hooked())
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * @name Probes
+ *
+ * The USDT probes of the @c lmc provider, available to perf, bpftrace
+ * or SystemTap if the LMC is compiled with the @c sys/sdt.h header:
+ *
+ * - @c program__start (path): a program boots;
+ * - @c program__stop (path, status): a program shuts down;
+ * - @c fetch (pc, acc): an instruction is fetched;
+ * - @c mem__write (address, length): a memory section is written;
+ * - @c rom__fault (address): a ROM write is refused;
+ * - @c bus__input (words, size): words are read from the bus, the
+ *   compiled program excluded;
+ * - @c bus__output (data, size): data is written on the bus;
+ * - @c debug__enter (pc): the debugger prompts for a command.
+ *
+ * The paths are @c NULL for the programs given in memory. A probe is a
+ * single @c nop instruction while nothing is attached to it.
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+/**
+ * @def lmc_probe
+ * @since 0.1.0
+ * @brief Fire a USDT probe of the @c lmc provider.
+ * @param ... The probe name, then its arguments.
+ */
+#ifdef STAP_PROBEV
+#define lmc_probe(...) STAP_PROBEV(lmc, __VA_ARGS__)
+#else
+#define lmc_probe(...) ((void) 0)
+#endif
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * @name Hooks
+ *
+ * The instrumentation callbacks are only compiled if the #_HOOKS
+ * macro is defined; otherwise the hooks do not exist at all.
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+#ifdef _HOOKS
+
+/**
+ * @def lmc_hook
+ * @since 0.1.0
+ * @brief Call a #lmc_hal::hooks callback, if it is set.
+ *
+ * In the instructions cycle, the call is only expanded in its
+ * instrumented copy (see cycle.h).
+ *
+ * @param hook The LmcHooks callback.
+ * @param ... Its arguments, following the context.
+ */
+#define lmc_hook(hook, ...) \
+    (LMC_INSTRUMENTED && lmc_hal.hooks.hook ? lmc_hal.hooks.hook(lmc_hal.hooks.context, __VA_ARGS__) : (void) 0)
+
+/**
+ * @def lmc_hooked
+ * @since 0.1.0
+ * @brief Check if a hook of the instructions cycle is set.
+ * @return @c true if one of them is set, otherwise @c false.
+ */
+#define lmc_hooked()                                            \
+    (lmc_hal.hooks.fetch || lmc_hal.hooks.operand               \
+     || lmc_hal.hooks.read || lmc_hal.hooks.write               \
+     || lmc_hal.hooks.input || lmc_hal.hooks.output)
+
+#else
+
+#define lmc_hook(hook, ...) ((void) 0)
+#define lmc_hooked() false
+
+#endif // _HOOKS
+
+#ifdef _UCODES
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * @name Microcodes
+ *
+ * This section is optional, can optionally be loaded at compile-time
+ * for a deeper level of emulation, by defining the #_UCODES macro.
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+/**
+ * @enum LmcUcodes
+ * @since 0.1.0
+ * @brief The microcodes.
+ */
+typedef enum __attribute__ ((__packed__)) LmcUcodes {
+    PCTOSR = 1, /**< 01 Write #lmc_hal::cu:pc in #lmc_hal::mem::cache::sr. */
+    WRTOPC,     /**< 02 Write #lmc_hal::mem::cache::wr in #lmc_hal::cu::pc. */
+    WRTOAC,     /**< 03 Write #lmc_hal::mem::cache::wr in #lmc_hal::alu::acc. */
+    ACTOWR,     /**< 04 Write #lmc_hal::alu::acc in #lmc_hal::mem::cache::wr. */
+    WRTOOP,     /**< 05 Write #lmc_hal::mem::cache::wr in #lmc_hal::alu::opcode. */
+    WRTOAD,     /**< 06 Write #lmc_hal::mem::cache::wr in #lmc_hal::cu::ir::ad. */
+    ADTOSR,     /**< 07 Write #lmc_hal::cu::ir::ad in #lmc_hal::mem::cache::sr. */
+    INTOWR,     /**< 08 Write #lmc_hal::bus::buffer in #lmc_hal::mem::cache::wr. */
+    WRTOOU,     /**< 09 Write #lmc_hal::mem::cache::wr in #lmc_hal::bus::output. */
+    ADDOPD,     /**< 10 Write #ADD in #lmc_hal::alu::opcode. */
+    SUBOPD,     /**< 11 Write #SUB in #lmc_hal::alu::opcode. */
+    DOCALC,     /**< 12 Execute the instruction stored in #lmc_hal::alu::opcode. */
+    SVTOWR,     /**< 13 Write the memory slot value pointed by #lmc_hal::mem::cache::sr in #lmc_hal::mem::cache::wr. */
+    WRTOSV,     /**< 14 Write #lmc_hal::mem::cache::wr in the memory slot pointed by #lmc_hal::mem::cache::sr. */
+    INCRPC,     /**< 15 Increment #lmc_hal::cu::pc. */
+    WINPUT,     /**< 16 Wait for input in #lmc_hal::bus::input. */
+    NANDOP,     /**< 17 Write #NAND in #lmc_hal::alu::opcode. */
+    LMCHLT,     /**< 18 Set #lmc_hal::on to @c false. */
+    SPTOSR,     /**< 19 Write #lmc_hal::cu::sp in #lmc_hal::mem::cache::sr. */
+    INCRSP,     /**< 20 Increment #lmc_hal::cu::sp. */
+    DECRSP,     /**< 21 Decrement #lmc_hal::cu::sp. */
+    PCTOWR,     /**< 22 Write #lmc_hal::cu::pc in #lmc_hal::mem::cache::wr. */
+    ADTOPC,     /**< 23 Write #lmc_hal::cu::ir::ad in #lmc_hal::cu::pc. */
+    WRTOSK,     /**< 24 Push #lmc_hal::mem::cache::wr in the stack slot pointed by #lmc_hal::mem::cache::sr. */
+    SKTOWR,     /**< 25 Pop the stack slot pointed by #lmc_hal::mem::cache::sr in #lmc_hal::mem::cache::wr. */
+    WRTOSL,     /**< 26 Reserve the stack from the #lmc_hal::mem::cache::wr address. */
+    BLKCPY,     /**< 27 Copy the memory block described at the #lmc_hal::mem::cache::wr address. */
+    BLKCMP,     /**< 28 Compare the memory blocks described at the #lmc_hal::mem::cache::wr address. */
+    BLKSET,     /**< 29 Fill the memory block described at the #lmc_hal::mem::cache::wr address. */
+    ADDXSR,     /**< 30 Add #lmc_hal::cu::ix to #lmc_hal::mem::cache::sr. */
+    WRTOIX,     /**< 31 Write #lmc_hal::mem::cache::wr in #lmc_hal::cu::ix. */
+    INCRIX,     /**< 32 Increment #lmc_hal::cu::ix. */
+    DECRIX,     /**< 33 Decrement #lmc_hal::cu::ix. */
+    ADCOPD,     /**< 34 Write #ADC in #lmc_hal::alu::opcode. */
+    SBCOPD,     /**< 35 Write #SBC in #lmc_hal::alu::opcode. */
+    BLKBUS,     /**< 36 Transfer the memory block at the #lmc_hal::mem::cache::wr address through the bus. */
+} LmcUcodes;
+
+#endif // _UCODES
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * @name The LMC.
+ * @{
+ ******************************************************************************/
+
+/**
+ * @var lmc_hal
+ * @since 0.1.0
+ * @brief The LMC computer.
+ */
+static __thread LmcComputer lmc_hal = {0};
+
+/**
+ * @var lmc_rom
+ * @since 0.1.0
+ * @brief The last loaded bootstrap ROM, shared by all the programs.
+ */
+static struct {
+    char path[PATH_MAX];    /**< The bootstrap file path. */
+    dev_t dev;              /**< The bootstrap file device. */
+    ino_t ino;              /**< The bootstrap file inode. */
+    struct timespec mtime;  /**< The bootstrap file modification time. */
+    LmcRam rom[LMC_MAXROM]; /**< The ROM content. */
+    pthread_mutex_t lock;   /**< The cache lock. */
+} lmc_rom = { .lock = PTHREAD_MUTEX_INITIALIZER, };
+
+/**
+ * @var lmc_archive
+ * @since 0.1.0
+ * @brief The archive searched for the programs, shared by all the
+ * programs.
+ */
+static const LmcArchive* lmc_archive = NULL;
+
+/**
+ * @var lmc_stream
+ * @since 0.1.0
+ * @brief The non-interactive data stream, shared by all the programs.
+ */
+static LmcStream lmc_stream = { .fd = -1, };
+
+/**
+ * @var lmc_ioStream
+ * @since 0.1.0
+ * @brief The stream of the lmc_execute() callbacks input, kept
+ * between the executions of a thread, as its ring is large.
+ */
+static __thread LmcStream lmc_ioStream;
+
+#ifdef _STATS
+
+/**
+ * @var lmc_statsFormat
+ * @since 0.1.0
+ * @brief The statistics report format, shared by all the programs.
+ */
+static LmcStatsFormat lmc_statsFormat = LMC_STATSOFF;
+
+/**
+ * @var lmc_profiles
+ * @since 0.1.0
+ * @brief The profiles destination, shared by all the programs.
+ */
+static struct {
+    const char* path;     /**< The first profile path, or @c NULL if
+                           * the programs are not profiled. */
+    size_t count;         /**< Number of profiles written. */
+    pthread_mutex_t lock; /**< The profiles lock, also protecting the
+                           * compiler. */
+} lmc_profiles = { .lock = PTHREAD_MUTEX_INITIALIZER, };
+
+#endif // _STATS
+
+/**
+ * @var lmc_traces
+ * @since 0.1.0
+ * @brief The traces destination, shared by all the programs.
+ */
+static struct {
+    const char* path;     /**< The first trace path, or @c NULL if the
+                           * programs are not traced. */
+    size_t count;         /**< Number of traces opened. */
+    pthread_mutex_t lock; /**< The traces lock. */
+} lmc_traces = { .lock = PTHREAD_MUTEX_INITIALIZER, };
+
+/**
+ * @var lmc_replay
+ * @since 0.1.0
+ * @brief The replayed input, read through #lmc_stream.
+ */
+static struct {
+    LmcRam* words; /**< The input words. */
+    size_t size;   /**< The number of words. */
+    size_t pos;    /**< Next word to read. */
+    LmcIo io;      /**< The callbacks reading the words. */
+} lmc_replay = { .io = { .read = lmc_replayRead, .context = &lmc_replay, .binary = true, }, };
+
+/**
+ * @var lmc_steps
+ * @since 0.1.0
+ * @brief The instructions executed by the thread and not counted yet
+ * in the metrics.
+ */
+static __thread size_t lmc_steps = 0;
+
+#ifdef _HOOKS
+
+/**
+ * @var lmc_hooks
+ * @since 0.1.0
+ * @brief The callbacks of the computers booted by the thread.
+ */
+static __thread LmcHooks lmc_hooks = { 0 };
+
+#endif // _HOOKS
+
+/**
+ * @var lmc_template
+ * @since 0.1.0
+ * @brief A template for #lmc_hal, including a default bootstrap.
+ */
+static const LmcComputer lmc_template = {
+    .bus = { .prompt = LMC_PROMPT, },
+    .cu  = { .sp = LMC_STACKBASE, },
+    .mem.top = LMC_MAXRAM,
+    .mem.ram = {
+        // The bootstrap
+        // operation    argument adress  instruction translation (base 16)
+        IN | VAR,       0x20, // 00      in @ 20
+        IN | VAR,       0x22, // 02      in @ 22
+        LOAD | VAR,     0x20, // 04      load @ 20
+        STORE | VAR,    0x21, // 06      store @ 21
+        IN | INDIR,     0x21, // 08      in *@ 21
+        LOAD | VAR,     0x22, // 0a      load @ 22
+        SUB,            0x01, // 0c      sub 01
+        BRZ,    LMC_MAXROM-1, // 0e      brz 1f
+        STORE | VAR,    0x22, // 10      store @ 22
+        LOAD | VAR,     0x21, // 12      load @ 21
+        ADD,            0x01, // 14      add 01
+        JUMP,           0x06, // 16      jump 06
+        // The last instruction is at the end of the ROM, the slots
+        // in-between are set to 0. This instruction does not have a
+        // preset argument, as the latter is the program start address
+        // given by the program header. This instruction is in ROM,
+        // while the address is in RAM.
+        [LMC_MAXROM-1] = JUMP,
+    },
+};
+
+
+/******************************************************************************
+ * @}
+ * @name The instructions cycle.
+ *
+ * The cycle is compiled twice, with and without the instrumentation,
+ * and each run chooses its copy once, when it starts.
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+#undef LMC_INSTRUMENTED
+#define LMC_INSTRUMENTED 0
+#include "cycle.h"
+#undef LMC_INSTRUMENTED
+#define LMC_INSTRUMENTED 1
+#include "cycle.h"
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * Implementation
+ ******************************************************************************/
+// clang-format on
+
+LmcRam lmc_shell(const char* restrict bootstrap, const char* restrict filepath)
+{ return lmc_exec(bootstrap, filepath, false, NULL); }
+
+LmcRam lmc_dbgShell(const char* restrict bootstrap, const char* restrict filepath)
+{ return lmc_exec(bootstrap, filepath, true, NULL); }
+
+LmcRam lmc_pipeline(const char* restrict bootstrap, size_t count, char* const* files)
+{
+    LmcStage* stages = NULL;
+    LmcRing* rings = NULL;
+    LmcRam status = 0;
+
+    if (!count) return lmc_shell(bootstrap, NULL);
+    // The rings indexes are aligned on the cache lines.
+    if (!(stages = calloc(count, sizeof(LmcStage)))
+        || (errno = posix_memalign((void**)&rings, LMC_CACHELINE, count * sizeof(LmcRing))))
+        lmc_err("could not allocate the pipeline");
+    memset(rings, 0, count * sizeof(LmcRing));
+
+    for (size_t i = 0; i < count; ++i) {
+        stages[i].bootstrap = bootstrap;
+        stages[i].file      = files[i];
+        stages[i].in        = i ? &rings[i - 1] : NULL;
+        stages[i].out       = i < count - 1 ? &rings[i] : NULL;
+#ifdef _HOOKS
+        stages[i].hooks     = lmc_hooks;
+#endif
+    }
+
+    // The last stage runs on the calling thread, as it is the one
+    // writing on the standard output.
+    for (size_t i = 0; i < count - 1; ++i)
+        if ((errno = pthread_create(&stages[i].thread, NULL, lmc_stage, &stages[i])))
+            lmc_err("could not start the pipeline");
+    lmc_stage(&stages[count - 1]);
+    for (size_t i = 0; i < count - 1; ++i) pthread_join(stages[i].thread, NULL);
+
+    status = stages[count - 1].status;
+    free(stages);
+    free(rings);
+    return status;
+}
+
+LmcRam lmc_execute(const char* restrict bootstrap, const LmcRam* program, size_t size, const LmcIo* io, size_t limit)
+{
+    // The input is read in the stream ring, as the data files. Only
+    // its header is reset, the ring being filled before it is read.
+    LmcStream* stream = &lmc_ioStream;
+    size_t steps = 0;
+
+    stream->fd     = -1;
+    stream->io     = io;
+    stream->binary = io->binary;
+    stream->prompt = false;
+    stream->head   = stream->tail = 0;
+
+    lmc_hal = lmc_template;
+    if (bootstrap) lmc_bootstrap(bootstrap);
+    lmc_hal.bus.data    = stream;
+    lmc_hal.bus.io      = io;
+    lmc_hal.bus.program = (LmcProgram){ .data = program, .size = size, .archived = true };
+#ifdef _HOOKS
+    lmc_hal.hooks = lmc_hooks;
+#endif
+    lmc_prepare("program");
+
+    lmc_hal.on = true;
+    lmc_statsStart(NULL);
+    lmc_traceStart(NULL);
+    lmc_probe(program__start, NULL);
+    steps = lmc_instrumented() ? lmc_runInstrumented(limit) : lmc_run(limit);
+    lmc_busFlush();
+    lmc_statsStop();
+    lmc_traceStop();
+    lmc_probe(program__stop, NULL, lmc_hal.mem.cache.wr);
+    lmc_hook(halt, lmc_hal.mem.cache.wr);
+    lmc_metricsDone(lmc_hal.mem.cache.wr || (limit && steps > limit));
+    lmc_hal.bus.program = (LmcProgram){ 0 };
+    return lmc_hal.mem.cache.wr;
+}
+
+void lmc_abort(void)
+{
+    lmc_statsStop();
+    lmc_traceStop();
+}
+
+void lmc_preload(const char* restrict bootstrap)
+{
+    // The loaded ROM is overwritten at the next boot.
+    lmc_bootstrap(bootstrap);
+}
+
+void lmc_setArchive(const LmcArchive* archive)
+{
+    lmc_archive = archive;
+}
+
+void lmc_setTrace(const char* restrict path)
+{
+    pthread_mutex_lock(&lmc_traces.lock);
+    lmc_traces.path  = path;
+    lmc_traces.count = 0;
+    pthread_mutex_unlock(&lmc_traces.lock);
+}
+
+#ifdef _STATS
+
+void lmc_setStats(LmcStatsFormat format)
+{
+    lmc_statsFormat = format;
+}
+
+void lmc_setProfile(const char* restrict path)
+{
+    lmc_profiles.path = path;
+}
+
+void lmc_getStats(LmcStats* dest)
+{
+    *dest = lmc_hal.stats;
+}
+
+#endif // _STATS
+
+#ifdef _HOOKS
+
+void lmc_setHooks(const LmcHooks* hooks)
+{
+    lmc_hooks = hooks ? *hooks : (LmcHooks){ 0 };
+}
+
+#endif // _HOOKS
+
+static void* lmc_stage(void* stage)
+{
+    LmcStage* self = stage;
+    self->status = lmc_exec(self->bootstrap, self->file, false, self);
+    // Wake up the neighbours waiting on the rings.
+    if (self->in) __atomic_store_n(&self->in->closed, true, __ATOMIC_RELEASE), lmc_ringWake(self->in);
+    if (self->out) __atomic_store_n(&self->out->closed, true, __ATOMIC_RELEASE), lmc_ringWake(self->out);
+    return NULL;
+}
+
+static LmcRam lmc_exec(const char* restrict bootstrap, const char* restrict filepath, bool debug, const LmcStage* stage)
+{
+    lmc_boot(bootstrap, filepath, debug, stage);
+    lmc_traceStart(filepath);
+    lmc_probe(program__start, filepath);
+    lmc_instrumented() ? lmc_runInstrumented(0) : lmc_run(0);
+    lmc_busFlush();
+    lmc_statsStop();
+    lmc_traceStop();
+    lmc_probe(program__stop, filepath, lmc_hal.mem.cache.wr);
+    lmc_hook(halt, lmc_hal.mem.cache.wr);
+    lmc_metricsDone(lmc_hal.mem.cache.wr);
+    return lmc_hal.mem.cache.wr;
+}
+
+static void lmc_boot(const char* restrict bootstrap, const char* restrict filepath, bool debug, const LmcStage* stage)
+{
+    // reset the computer to avoid mixing data between the programs.
+    lmc_hal = lmc_template;
+    if (bootstrap) lmc_bootstrap(bootstrap);
+
+    // FILE* stdin and stdout are not compile-time constants, thus
+    // only assignable at run-time.
+    lmc_hal.bus.input  = stdin;
+    lmc_hal.bus.output = stdout;
+    lmc_hal.bus.data   = lmc_stream.fd < 0 && !lmc_stream.io ? NULL : &lmc_stream;
+    if (stage) lmc_hal.bus.pipein = stage->in, lmc_hal.bus.pipeout = stage->out;
+#ifdef _HOOKS
+    lmc_hal.hooks = stage ? stage->hooks : lmc_hooks;
+#endif
+    lmc_setInput(filepath);
+
+    lmc_hal.on = true; // Hello Dave. You are looking well today.
+    lmc_statsStart(filepath);
+    lmc_hal.dbg.opcode = debug ? DEBUG : 0;
+}
+
+LmcSession* lmc_sessionOpen(const char* restrict bootstrap, const char* restrict filepath, int in, int out)
+{
+    LmcSession* session = NULL;
+    int error = 0;
+
+    // The errors may be caught, thus the session is only allocated
+    // once booted, and released before raising them.
+    lmc_boot(bootstrap, filepath, false, NULL);
+    if (!(session = calloc(1, sizeof(LmcSession)))) {
+        lmc_unload(&lmc_hal.bus.program);
+        lmc_err("could not allocate the session");
+    }
+    session->vm = lmc_hal;
+    session->vm.bus.session = session;
+    session->in  = in;
+    session->out = out;
+    if (fcntl(in, F_SETFL, fcntl(in, F_GETFL) | O_NONBLOCK) < 0
+        || fcntl(out, F_SETFL, fcntl(out, F_GETFL) | O_NONBLOCK) < 0) {
+        error = errno;
+        lmc_sessionClose(session);
+        errno = error;
+        lmc_err("could not open the session");
+    }
+    return session;
+}
+
+bool lmc_sessionResume(LmcSession* session)
+{
+    lmc_hal = session->vm;
+    session->events = 0;
+
+    if (session->header && !lmc_sessionHeader()) {
+        session->vm = lmc_hal;
+        return (session->events = POLLIN);
+    }
+    // The version 2 images skip the bootstrap, thus they are placed
+    // before its first instruction.
+    if (lmc_hal.on && session->image == LMC_MAXHEADER && !session->sized && !lmc_sessionBinary()) {
+        session->vm = lmc_hal;
+        return (session->events = POLLIN);
+    }
+
+    // The session instructions are not interruptible, but as the
+    // input and output happen before any memory write, rolling back
+    // the registers is enough to restart them.
+    if (!setjmp(lmc_yield)) {
+        lmc_restart = session->suspended;
+        session->suspended = false;
+        // A long computation waits for its output to be writable,
+        // thus is resumed as soon as the other sessions are.
+        if (lmc_instrumented() ? lmc_sliceInstrumented(session) : lmc_slice(session)) {
+            lmc_busFlush();
+            session->vm = lmc_hal;
+            return (session->events = POLLOUT);
+        }
+        // The status is written once, after the output (or "--" if
+        // the limit is reached), then the pending output is waited
+        // for before stopping.
+        if (session->report) {
+            char status[LMC_MAXDIGITS+2] = "\n--\n";
+            if (!session->limit || session->steps <= session->limit)
+                lmc_hex(&status[1], lmc_hal.mem.cache.wr);
+            lmc_busWrite(status, sizeof(status));
+            session->report = false;
+        }
+        lmc_busFlush();
+        // The stop is resumed while the output is pending, but only
+        // counted once.
+        if (!session->stopped) {
+            lmc_statsStop();
+            lmc_hook(halt, lmc_hal.mem.cache.wr);
+            lmc_metricsDone(lmc_hal.mem.cache.wr || (session->limit && session->steps > session->limit));
+            session->stopped = true;
+        }
+        if (lmc_hal.bus.outbuf.size) session->events = POLLOUT;
+    }
+    else {
+        --session->steps;
+        lmc_hal.mem.cache  = lmc_saved.cache;
+        lmc_hal.cu         = lmc_saved.cu;
+        lmc_hal.alu        = lmc_saved.alu;
+        lmc_hal.bus.prompt = lmc_saved.prompt;
+        // The instruction is counted once, when first started; its
+        // memory accesses are counted again when restarted.
+#ifdef _STATS
+        lmc_hal.stats.reads  = lmc_saved.reads;
+        lmc_hal.stats.faults = lmc_saved.faults;
+        lmc_hal.stats.ucodes = lmc_saved.ucodes;
+#endif
+        session->suspended = true;
+        lmc_restart = false;
+    }
 
-LmcRam lmc_dbgShell(const char* restrict bootstrap, const char* restrict filepath)
-{ return lmc_exec(bootstrap, filepath, true); }
+    session->vm = lmc_hal;
+    return session->events;
+}
 
-static LmcRam lmc_exec(const char* restrict bootstrap, const char* restrict filepath, bool debug)
+LmcRam lmc_sessionClose(LmcSession* session)
 {
-    // reset the computer to avoid mixing data between the programs.
-    lmc_hal = lmc_template;
-    lmc_bootstrap(bootstrap);
+    LmcRam status = session->vm.mem.cache.wr;
+    lmc_unload(&session->vm.bus.program);
+#ifdef _STATS
+    // The profile of an unfinished session is discarded.
+    free(session->vm.profile);
+#endif
+    free(session->binary);
+    free(session);
+    return status;
+}
 
-    // FILE* stdin and stdout are not compile-time constants, thus
-    // only assignable at run-time.
-    lmc_hal.bus.input  = stdin;
-    lmc_hal.bus.output = stdout;
-    lmc_setInput(filepath);
+void lmc_schedule(LmcSession* const* sessions, size_t count, size_t threads)
+{
+    LmcShard* shards = NULL;
+
+    if (!count) return;
+    threads = !threads ? 1 : threads > count ? count : threads;
+    if (!(shards = calloc(threads, sizeof(LmcShard))))
+        lmc_err("could not allocate the scheduler");
+
+    // The sessions are interleaved between the threads.
+    for (size_t i = 0; i < threads; ++i) {
+        shards[i].sessions = &sessions[i];
+        shards[i].count    = (count - i + threads - 1) / threads;
+        shards[i].step     = threads;
+    }
+    for (size_t i = 1; i < threads; ++i)
+        if ((errno = pthread_create(&shards[i].thread, NULL, lmc_scheduler, &shards[i])))
+            lmc_err("could not start the scheduler");
+    lmc_scheduler(&shards[0]);
+    for (size_t i = 1; i < threads; ++i) pthread_join(shards[i].thread, NULL);
+    free(shards);
+}
 
-    lmc_hal.on = true; // Hello Dave. You are looking well today.
-    lmc_hal.dbg.opcode = debug ? DEBUG : 0;
-    while (lmc_hal.on) {
-        while(lmc_debug());
-        lmc_phaseOne(), lmc_phaseTwo(false) ? lmc_phaseThree() : 0;
+static void* lmc_scheduler(void* shard)
+{
+    LmcShard* self = shard;
+    LmcSession* session = NULL;
+    struct pollfd* fds = calloc(2 * self->count, sizeof(struct pollfd));
+    size_t alive = 0;
+
+    if (!fds) lmc_err("could not allocate the scheduler");
+    for (size_t i = 0; i < self->count; ++i)
+        alive += lmc_sessionResume(self->sessions[i * self->step]);
+
+    while (alive) {
+        // The stopped sessions negative descriptors are ignored.
+        for (size_t i = 0; i < self->count; ++i) {
+            session = self->sessions[i * self->step];
+            fds[2*i]   = (struct pollfd){ .fd = session->events & POLLIN ? session->in : -1, .events = POLLIN };
+            fds[2*i+1] = (struct pollfd){ .fd = session->events & POLLOUT ? session->out : -1, .events = POLLOUT };
+        }
+        if (poll(fds, 2 * self->count, -1) < 0) {
+            if (errno == EINTR) continue;
+            lmc_err("could not wait for the sessions");
+        }
+        for (size_t i = 0; i < self->count; ++i)
+            if ((fds[2*i].revents || fds[2*i+1].revents)
+                && !lmc_sessionResume(self->sessions[i * self->step]))
+                --alive;
     }
-    return lmc_hal.mem.cache.wr;
+
+    free(fds);
+    return NULL;
 }
 
 static void lmc_bootstrap(const char* restrict path)
 {
-    FILE* file = fopen(path, "rb");
+    FILE* file = NULL;
     size_t size = LMC_MAXROM;
-    size_t final = 0;
-
-    // As the bootstrap is itself compiled using the LMC compiler, the
-    // first two values are the start position and the size. The first
-    // is ignored, and the second is checked before loading the
-    // bootstrap in memory (in case of discrepancy or if the given
+    size_t final = 0, offset = 0;
+    LmcRam image[LMC_MAXBINARY];
+    const LmcRam* contents = NULL;
+    LmcBinary binary = { 0 };
+    struct stat info = { 0 };
+    bool loaded = false, known = false;
+    int error = 0;
+    lmc_timing(LMC_TBOOTSTRAP);
+
+    // The bootstrap is read only once for all the programs, until its
+    // file is replaced or modified. The lock is not held while
+    // loading, as the errors may be caught.
+    known = !stat(path, &info);
+    pthread_mutex_lock(&lmc_rom.lock);
+    if (known && *lmc_rom.path && !strcmp(path, lmc_rom.path)
+        && lmc_rom.dev == info.st_dev && lmc_rom.ino == info.st_ino
+        && lmc_rom.mtime.tv_sec == info.st_mtim.tv_sec && lmc_rom.mtime.tv_nsec == info.st_mtim.tv_nsec) {
+        memcpy(lmc_hal.mem.ram, lmc_rom.rom, LMC_MAXROM);
+        pthread_mutex_unlock(&lmc_rom.lock);
+        return;
+    }
+    pthread_mutex_unlock(&lmc_rom.lock);
+    // The whole bootstrap is read at once, thus the file is closed
+    // before raising any error. The streams, such as a pipe, are not
+    // accepted as bootstraps.
+    if ((file = fopen(path, "rb")) && !fstat(fileno(file), &info)) {
+        if (!S_ISREG(info.st_mode)) errno = ESPIPE;
+        else {
+            final  = fread(image, sizeof(LmcRam), sizeof(image), file);
+            loaded = !ferror(file);
+        }
+    }
+    if (file) error = errno, fclose(file), errno = error;
+    if (!loaded) lmc_err("%s: could not load bootstrap", path);
+
+    // As the bootstrap is itself compiled using the LMC compiler, its
+    // start position is ignored: the version 2 segments are placed
+    // relatively to the entry point, at the start of the ROM.
+    if (lmc_binaryRead(path, image, final, &binary) < 0) lmc_exit();
+    else if (binary.size) {
+        contents = binary.contents;
+        for (size_t i = 0; i < binary.count; contents += binary.segments[i++].size) {
+            offset = (LmcRam)(binary.segments[i].address - binary.entry);
+            if (offset + binary.segments[i].size > LMC_MAXROM) {
+                errno = EFBIG;
+                lmc_err("%s: the bootstrap segment " LMC_HEXFMT " is out of the ROM (%i bytes)",
+                        path, LMC_MAXDIGITS, binary.segments[i].address, LMC_MAXROM);
+            }
+            memcpy(&lmc_hal.mem.ram[offset], contents, binary.segments[i].size);
+        }
+    }
+    // The version 1 size (the second value) is checked before loading
+    // the bootstrap in memory (in case of discrepancy or if the given
     // bootstrap is larger than the ROM).
-    if (!file || fseek(file, sizeof(LmcRam), SEEK_SET))
-        err(EXIT_FAILURE, "%s: could not load bootstrap", path);
-    else if (fread(&size, sizeof(LmcRam), 1, file) < 1) {
+    else if (final < LMC_MAXHEADER) {
         errno = ENOEXEC;
-        err(EXIT_FAILURE, "%s: missing size for bootstrap header", path);
+        lmc_err("%s: missing size for bootstrap header", path);
     }
-    else if (size > LMC_MAXROM) {
+    else if ((size = image[LMC_SIZE]) > LMC_MAXROM) {
         errno = EFBIG;
-        err(
-            EXIT_FAILURE,
+        lmc_err(
             "The bootstrap size (%lu bytes) is larger than the ROM (%i bytes)",
             size, LMC_MAXROM
         );
     }
     else if (size == 0) {
         errno = ECANCELED;
-        warn("%s: the bootstrap indicated size is null", path);
-        fprintf(stderr, "Fallback to default bootstrap\n");
+        lmc_warn("%s: the bootstrap indicated size is null", path);
+        lmc_notice("Fallback to default bootstrap");
     }
-    else if ((final = fread(lmc_hal.mem.ram, sizeof(LmcRam), LMC_MAXROM, file)) < size)
-        err(
-            EXIT_FAILURE,
+    else if ((final = final - LMC_MAXHEADER < LMC_MAXROM ? final - LMC_MAXHEADER : LMC_MAXROM) < size)
+        lmc_err(
             "%s: header size (%lu bytes) differs from total read (%lu bytes)",
             path, size, final
         );
-    fclose(file);
+    else memcpy(lmc_hal.mem.ram, &image[LMC_MAXHEADER], final);
+
+    // A file modified since its stat is loaded again by the next
+    // programs.
+    pthread_mutex_lock(&lmc_rom.lock);
+    if (known && strlen(path) < sizeof(lmc_rom.path)) {
+        strcpy(lmc_rom.path, path);
+        lmc_rom.dev   = info.st_dev;
+        lmc_rom.ino   = info.st_ino;
+        lmc_rom.mtime = info.st_mtim;
+        memcpy(lmc_rom.rom, lmc_hal.mem.ram, LMC_MAXROM);
+    }
+    pthread_mutex_unlock(&lmc_rom.lock);
 }
 
 // clang-format off
@@ -472,159 +1626,579 @@ static void lmc_bootstrap(const char* restrict path)
  ******************************************************************************/
 // clang-format on
 
-static bool lmc_debug(void)
+static void lmc_dump(LmcRam start, LmcRam end)
+{
+    // A row is at most "\nAA: " followed by LMC_MEMCOL+1 "VV ".
+    char row[(LMC_MEMCOL + 2) * (LMC_MAXDIGITS + 2)] = { 0 };
+    char* cur = NULL;
+
+    for (int addr = start, next = 0; addr <= end; addr = next)
+    {
+        // The next row start, or the dump end.
+        next = (addr | LMC_MEMCOL) + 1;
+        next = next > end ? end + 1 : next;
+
+        cur = row;
+        if (!(addr & LMC_MEMCOL) || start == end) {
+            *cur++ = '\n';
+            cur = lmc_hex(cur, addr);
+            *cur++ = ':', *cur++ = ' ';
+        }
+        for (int i = addr; i < next; ++i)
+            cur = lmc_hex(cur, lmc_hal.mem.ram[i]), *cur++ = ' ';
+        lmc_busWrite(row, cur - row);
+    }
+}
+
+// clang-format off
+
+/******************************************************************************
+ * IO handling
+ ******************************************************************************/
+// clang-format on
+
+static bool lmc_setInput(const char* restrict filepath)
 {
-    return
-        lmc_dbg_phaseOne()
-        ? (lmc_dbg_phaseTwo(), lmc_dbg_phaseThree())
-        : false;
+    LmcProgram* program = &lmc_hal.bus.program;
+
+    if (filepath) lmc_load(filepath);
+    else if (program->data) lmc_unload(program);
+    else if (feof(lmc_hal.bus.input))
+        return (lmc_hal.on = false);
+    return true;
 }
 
-static bool lmc_dbg_phaseOne(void)
+static void lmc_load(const char* restrict path)
 {
-    if (!(lmc_hal.on && lmc_hal.dbg.opcode))
-        return false;
+    LmcProgram* program = &lmc_hal.bus.program;
+    struct stat info = { 0 };
+    const LmcRam* entry = NULL;
+    LmcRam* data = NULL, * chunk = NULL;
+    ssize_t size = 0;
+    size_t length = 0;
+    int fd = -1, error = 0;
+
+    // The archive entries are executed in place.
+    if (lmc_archive && (entry = lmc_archiveFind(lmc_archive, path, &length))) {
+        *program = (LmcProgram){ .data = entry, .size = length, .archived = true };
+        return lmc_prepare(path);
+    }
+
+    if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &info)) goto failed;
+    *program = (LmcProgram){ .size = info.st_size, .mapped = true };
+    if (S_ISREG(info.st_mode) && info.st_size
+        && (data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+        data = NULL;
+
+    // The non-regular files (pipes, devices...) are slurped in
+    // chunks of the max program size.
+    if (!data) {
+        program->size = 0, program->mapped = false;
+        do {
+            if (!(chunk = realloc(data, program->size + LMC_MAXRAM))) goto failed;
+            data = chunk;
+            if ((size = read(fd, &data[program->size], LMC_MAXRAM)) < 0) goto failed;
+            program->size += size;
+        } while (size);
+    }
+    close(fd);
+    program->data = data;
+    return lmc_prepare(path);
+
+    // The errors may be caught, thus the file and the buffer are
+    // released before raising them.
+failed:
+    error = errno;
+    if (fd >= 0) close(fd);
+    free(data);
+    *program = (LmcProgram){ 0 };
+    errno = error;
+    lmc_err("%s", path);
+}
 
-    if (lmc_hal.dbg.prt // we don't want to print the value of address 0x00.
-        && lmc_hal.dbg.prt == lmc_hal.cu.pc)
-        lmc_dump(lmc_hal.cu.pc, lmc_hal.cu.pc);
+static void lmc_prepare(const char* restrict path)
+{
+    LmcProgram* program = &lmc_hal.bus.program;
+    LmcBinary binary = { 0 };
+
+    // The version 2 programs segments are placed at once, skipping
+    // the bootstrap, and their following bytes are the program input.
+    if (lmc_binaryRead(path, program->data, program->size, &binary) < 0
+        || (binary.size && !lmc_place(path, &binary)))
+        lmc_exit();
+    else if (binary.size) {
+        program->pos = binary.size;
+        if (program->pos == program->size) lmc_unload(program);
+    }
+    // The second header word of the version 1 programs is the program
+    // size. A truncated program is still executed, the user
+    // completing it.
+    else if (program->size < LMC_MAXHEADER || program->size < (size_t)LMC_MAXHEADER + program->data[LMC_SIZE]) {
+        errno = ENOEXEC;
+        lmc_warn("%s: truncated program (%zu bytes)", path, program->size);
+    }
+}
 
-    if (lmc_hal.dbg.opcode == CONT
-        && lmc_hal.dbg.brk // ibid, skip address 0x00
-        && lmc_hal.cu.pc != lmc_hal.dbg.brk)
-        return false;
+static bool lmc_place(const char* restrict path, const LmcBinary* binary)
+{
+    const LmcRam* contents = binary->contents;
 
+    for (size_t i = 0; i < binary->count; contents += binary->segments[i++].size) {
+        if (binary->segments[i].size && binary->segments[i].address < LMC_MAXROM) {
+            errno = EFAULT;
+            lmc_warn("%s: " LMC_HEXFMT ": read only", path, LMC_MAXDIGITS, binary->segments[i].address);
+            return false;
+        }
+        memcpy(&lmc_hal.mem.ram[binary->segments[i].address], contents, binary->segments[i].size);
+    }
+    lmc_hal.cu.pc = binary->entry;
     return true;
 }
 
-static void lmc_dbg_phaseTwo(void)
+static void lmc_unload(LmcProgram* program)
+{
+    if (program->data && !program->archived) {
+        if (program->mapped) munmap((void*)program->data, program->size);
+        else free((void*)program->data);
+    }
+    *program = (LmcProgram){ 0 };
+}
+
+static size_t lmc_programRead(LmcRam* dest, size_t size)
 {
-    // Set the special prompt for the debugger.
-    char prompt[BUFSIZ] = {0};
-    sprintf(prompt, LMC_DBGPROMPT);
-    lmc_hal.bus.prompt = prompt;
+    LmcProgram* program = &lmc_hal.bus.program;
+    size_t remains = program->size - program->pos;
 
-    // The opcode is overwritten without issue because the debug phase
-    // is upstream of the LMC phase 1, and the previous opcode is not
-    // used anymore.
-    lmc_busInput(), lmc_hal.alu.opcode   = lmc_hal.bus.buffer;
-    lmc_busInput(), lmc_hal.mem.cache.wr = lmc_hal.bus.buffer;
+    size = size < remains ? size : remains;
+    memcpy(dest, &program->data[program->pos], size);
+    program->pos += size;
+    return size;
+}
 
-    // Reset the prompt in case the debug instruction exits the
-    // debugger.
-    lmc_hal.bus.prompt = LMC_PROMPT;
+void lmc_setData(const char* restrict path, bool binary)
+{
+    if (lmc_stream.fd > STDERR_FILENO) close(lmc_stream.fd);
+    lmc_stream.fd   = -1;
+    lmc_stream.io   = NULL;
+    lmc_stream.head = lmc_stream.tail = 0;
+    free(lmc_replay.words);
+    lmc_replay.words = NULL;
+    if (!path) return;
+
+    if ((lmc_stream.fd = strcmp(path, "-") ? open(path, O_RDONLY) : STDIN_FILENO) < 0)
+        lmc_err("%s", path);
+    lmc_stream.binary = binary;
+    lmc_stream.prompt = isatty(lmc_stream.fd);
 }
 
-static bool lmc_dbg_phaseThree(void) { return lmc_phaseTwo(true); }
+void lmc_setReplay(const char* restrict trace, char* restrict program)
+{
+    LmcRam* words = lmc_traceInputs(trace, program, &lmc_replay.size);
+
+    // The words are read as a raw non-interactive stream.
+    lmc_setData(NULL, false);
+    lmc_replay.words  = words;
+    lmc_replay.pos    = 0;
+    lmc_stream.io     = &lmc_replay.io;
+    lmc_stream.binary = true;
+    lmc_stream.prompt = false;
+}
 
-static void lmc_dump(LmcRam start, LmcRam end)
+static void lmc_streamInput(void)
 {
-    for (int addr = start; addr <= end && addr < LMC_MAXRAM; ++addr)
-    {
-        lmc_rwMemory(addr, &lmc_hal.mem.cache.wr, 'r');
-        if (!(addr & LMC_MEMCOL) || start == end) {
-            lmc_busOutput("\n" LMC_HEXFMT ": ", LMC_MAXDIGITS, addr);
+    char digits[BUFSIZ+1] = { 0 };
+    size_t size = 0;
+    bool error = false;
+    int c = 0;
+
+    if (lmc_hal.bus.data->prompt) lmc_busPrompt();
+    if (lmc_hal.bus.data->binary) {
+        if (!lmc_streamRead(&lmc_hal.bus.buffer, 1)) lmc_hal.on = false;
+        return;
+    }
+
+    // The words are converted on the fly, and kept only for the
+    // error message. The invalid ones are skipped, under the same
+    // prompt.
+    do {
+        while ((c = lmc_streamGet()) != EOF && isspace(c));
+        if (c == EOF) { lmc_hal.on = false; return; }
+        for (lmc_hal.bus.buffer = 0, size = 0, error = false; c != EOF && !isspace(c); c = lmc_streamGet()) {
+            if (size < BUFSIZ) digits[size++] = c;
+            if (!isxdigit(c)) error = true;
+            else lmc_hal.bus.buffer = lmc_hal.bus.buffer << 4 | (isdigit(c) ? c - '0' : tolower(c) - 'a' + 10);
+        }
+        digits[size] = '\0';
+        if (error) {
+            errno = EINVAL;
+            lmc_warn("Not a valid hexadecimal value: '%s'", digits);
+        }
+    } while (error);
+}
+
+static void lmc_sessionInput(void)
+{
+    LmcSession* session = lmc_hal.bus.session;
+    LmcRam value = 0;
+    size_t start = 0, end = 0;
+    bool error = true;
+
+    // The binary program image is read before the user input, its
+    // size being the second word of its header.
+    if (session->image) {
+        if (!lmc_sessionRead(&lmc_hal.bus.buffer, 1)) { lmc_hal.on = false; return; }
+        if (!--session->image && !session->sized)
+            session->image = lmc_hal.bus.buffer, session->sized = true;
+        return;
+    }
+
+    if (!session->prompted) {
+        lmc_busWrite(lmc_hal.bus.prompt, strlen(lmc_hal.bus.prompt));
+        session->prompted = true;
+        lmc_busFlush();
+    }
+
+    // The invalid words are skipped, but the session is stopped after
+    // a few of them, each one being logged.
+    while (error) {
+        // The word is complete once followed by a whitespace, at the
+        // end of the input, or if it fills the pending input.
+        for (;;) {
+            for (start = 0; start < session->size && isspace(session->input[start]); ++start);
+            for (end = start; end < session->size && !isspace(session->input[end]); ++end);
+            if (end < session->size || session->eof || end - start == LMC_SESSIONBUF) break;
+            memmove(session->input, &session->input[start], end - start);
+            session->size = end - start;
+            if (!lmc_sessionFill()) lmc_suspend(POLLIN);
+        }
+        if (start == end) { lmc_hal.on = false; return; }
+
+        value = 0, error = false;
+        for (size_t i = start; i < end; ++i) {
+            if (!isxdigit(session->input[i])) error = true;
+            else value = value << 4 | (isdigit(session->input[i]) ? session->input[i] - '0' : tolower(session->input[i]) - 'a' + 10);
+        }
+        if (error) {
+            errno = EINVAL;
+            lmc_warn("Not a valid hexadecimal value: '%.*s'", (int)(end - start), (char*)&session->input[start]);
+        }
+        session->size -= end;
+        memmove(session->input, &session->input[end], session->size);
+
+        if (error && ++session->invalid == LMC_SESSIONINVALID) {
+            lmc_warnx("too many invalid values, stopping");
+            lmc_hal.on = false;
+            return;
         }
-        lmc_busOutput(LMC_HEXFMT " ", LMC_MAXDIGITS, lmc_hal.mem.cache.wr);
     }
+    session->prompted = false;
+    lmc_hal.bus.buffer = value;
 }
 
-// clang-format off
-
-/******************************************************************************
- * LMC cycle.
- ******************************************************************************/
-// clang-format on
+static size_t lmc_sessionRead(LmcRam* dest, size_t size)
+{
+    LmcSession* session = lmc_hal.bus.session;
+    size_t done = lmc_hal.bus.resume, chunk = 0;
+
+    while (done < size) {
+        if (!session->size) {
+            if (session->eof) break;
+            lmc_hal.bus.resume = done;
+            if (!lmc_sessionFill()) lmc_suspend(POLLIN);
+            continue;
+        }
+        chunk = session->size < size - done ? session->size : size - done;
+        memcpy(&dest[done], session->input, chunk);
+        session->size -= chunk;
+        memmove(session->input, &session->input[chunk], session->size);
+        done += chunk;
+    }
+    return done;
+}
 
-static void lmc_phaseOne(void) {
-#ifdef _UCODES
-    lmc_useries(PCTOSR, SVTOWR, WRTOOP, INCRPC, NULL);
-#else
-    lmc_rwMemory(lmc_hal.cu.pc++, &lmc_hal.alu.opcode, 'r');
-#endif
+static bool lmc_sessionBinary(void)
+{
+    LmcSession* session = lmc_hal.bus.session;
+    const size_t magic = sizeof(LMC_BINMAGIC) - 1;
+    LmcBinary binary = { 0 };
+    size_t needed = 0, chunk = 0;
+
+    // The magic number is only peeked, the version 1 images (which
+    // never start with its first byte) being read by the bootstrap.
+    while (!session->loaded && session->size < magic && !session->eof
+           && (!session->size || session->input[0] == (LmcRam)LMC_BINMAGIC[0]))
+        if (!lmc_sessionFill()) return false;
+    if (!session->loaded && (session->size < magic || memcmp(session->input, LMC_BINMAGIC, magic)))
+        return true;
+
+    // The image is larger than the pending input, thus it is gathered
+    // apart, as far as its header and segments table tell its size.
+    if (!session->binary && !(session->binary = malloc(LMC_MAXBINARY)))
+        lmc_err("could not allocate the session");
+    while ((needed = lmc_binarySize(session->binary, session->loaded)) > session->loaded
+           && session->loaded < LMC_MAXBINARY) {
+        if (!session->size) {
+            if (session->eof) break;
+            if (!lmc_sessionFill()) return false;
+            continue;
+        }
+        needed = needed < LMC_MAXBINARY ? needed : LMC_MAXBINARY;
+        chunk  = session->size < needed - session->loaded ? session->size : needed - session->loaded;
+        memcpy(&session->binary[session->loaded], session->input, chunk);
+        session->size -= chunk;
+        memmove(session->input, &session->input[chunk], session->size);
+        session->loaded += chunk;
+    }
+
+    // The output is still empty, thus the answer does not wait.
+    if (lmc_binaryRead("session", session->binary, session->loaded, &binary) < 0
+        || !lmc_place("session", &binary)) {
+        lmc_busWrite(LMC_REJECTED, sizeof(LMC_REJECTED) - 1);
+        lmc_hal.on = session->report = false;
+    }
+    free(session->binary);
+    session->binary = NULL;
+    session->image  = 0;
+    return true;
 }
 
-static bool lmc_phaseTwo(bool debug)
+static bool lmc_sessionHeader(void)
 {
-    // Split the indirection instruction from the operation bytecode.
-    LmcRam operation = lmc_hal.alu.opcode & ~(INDIR);
-    LmcRam value     = lmc_hal.alu.opcode & INDIR;
+    LmcSession* session = lmc_hal.bus.session;
+    LmcRam* end = NULL;
+    size_t limit = 0, size = 0;
 
-    lmc_opcalc(operation);
-    // If the caller is the debugger, fetching the operation argument
-    // as usual, i.e. from the current PC address, will overwrite the
-    // argument given to the debugger and stored in the word
-    // register. Hence the branching to avoid this.
-    if (debug) { lmc_hal.mem.cache.sr = lmc_hal.mem.cache.wr; }
-    else {
-#ifdef _UCODES
-    lmc_ucode(PCTOSR);
-#else
-    lmc_hal.mem.cache.sr = lmc_hal.cu.pc;
-#endif
+    while (!(end = memchr(session->input, '\n', session->size))) {
+        if (session->eof || session->size == LMC_SESSIONBUF) break;
+        if (!lmc_sessionFill()) return false;
+    }
+    for (LmcRam* c = session->input; end && c < end; ++c) {
+        if (!isdigit(*c) || limit > (SIZE_MAX - 9) / 10) end = NULL;
+        else limit = limit * 10 + *c - '0';
+    }
+    session->header = false;
+
+    // The invalid requests are not programs, thus are not counted.
+    if (!end) {
+        errno = EPROTO;
+        lmc_warn("invalid request header");
+        lmc_hal.on = session->report = false;
+        session->stopped = true;
+        return true;
     }
-    lmc_indirection(value);
-    return lmc_operation(operation);
+    if (limit && (!session->limit || limit < session->limit)) session->limit = limit;
+    size = end - session->input + 1;
+    session->size -= size;
+    memmove(session->input, &session->input[size], session->size);
+    return true;
 }
 
-static void lmc_phaseThree(void) {
-#ifdef _UCODES
-    lmc_ucode(INCRPC);
-#else
-    ++lmc_hal.cu.pc;
-#endif
+static bool lmc_sessionFill(void)
+{
+    LmcSession* session = lmc_hal.bus.session;
+    ssize_t size = read(session->in, &session->input[session->size], LMC_SESSIONBUF - session->size);
+
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+    else if (size < 0) lmc_warn(NULL);
+    if (size <= 0) session->eof = true;
+    else session->size += size;
+    return true;
 }
 
-// clang-format off
-
-/******************************************************************************
- * IO handling
- ******************************************************************************/
-// clang-format on
+static void lmc_sessionFlush(void)
+{
+    ssize_t size = write(lmc_hal.bus.session->out, lmc_hal.bus.outbuf.data, lmc_hal.bus.outbuf.size);
+
+    if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+    // The output is gone, thus the pending output is dropped.
+    else if (size < 0) {
+        lmc_warn(NULL);
+        lmc_hal.on = false;
+        size = lmc_hal.bus.outbuf.size;
+    }
+    else lmc_metricsAdd(LMC_MOUTPUT, size);
+    lmc_hal.bus.outbuf.size -= size;
+    memmove(lmc_hal.bus.outbuf.data, &lmc_hal.bus.outbuf.data[size], lmc_hal.bus.outbuf.size);
+}
 
-static bool lmc_setInput(const char* restrict filepath)
+static void lmc_suspend(short events)
+{
+    lmc_hal.bus.session->events = events | (lmc_hal.bus.outbuf.size ? POLLOUT : 0);
+    longjmp(lmc_yield, 1);
+}
+
+static int lmc_streamGet(void)
 {
-    if (filepath && !(lmc_hal.bus.input = fopen(filepath, "rb")))
-        err(EXIT_FAILURE, "%s", filepath);
-    else if (!filepath) {
-        if (lmc_hal.bus.input != stdin) {
-            fclose(lmc_hal.bus.input);
-            lmc_hal.bus.input = stdin;
+    LmcRam c = 0;
+    return lmc_streamRead(&c, 1) ? c : EOF;
+}
+
+static size_t lmc_streamRead(LmcRam* dest, size_t size)
+{
+    LmcStream* stream = lmc_hal.bus.data;
+    size_t done = 0, chunk = 0;
+    ssize_t filled = 0;
+
+    while (done < size) {
+        // Refill the ring only when it is empty, from its start, to
+        // read the largest possible chunk at once.
+        if (stream->head == stream->tail) {
+            stream->head = stream->tail = 0;
+            filled = !stream->io ? read(stream->fd, stream->ring, LMC_STREAMBUF)
+                : stream->io->read ? (ssize_t)stream->io->read(stream->io->context, stream->ring, LMC_STREAMBUF)
+                : 0;
+            if (filled <= 0) {
+                if (filled < 0) lmc_warn(NULL);
+                break;
+            }
+            stream->tail = filled;
         }
-        else if (feof(lmc_hal.bus.input))
-            return (lmc_hal.on = false);
+        chunk = stream->tail - stream->head;
+        chunk = chunk < size - done ? chunk : size - done;
+        memcpy(&dest[done], &stream->ring[stream->head], chunk);
+        stream->head += chunk, done += chunk;
     }
-    return true;
+    return done;
 }
 
-static void lmc_busInput(void)
+static void lmc_busWrite(const void* restrict data, size_t size)
 {
-    bool error = false, eof = false;
-    char digits[BUFSIZ+1] = { 0 };
+    if (lmc_hal.bus.pipeout) return lmc_busPipe(data, size);
+    if (lmc_hal.bus.outbuf.size + size > LMC_BUSBUF) lmc_busFlush();
+    // A session waits until its output has room for the data.
+    if (lmc_hal.bus.session && lmc_hal.bus.outbuf.size + size > LMC_BUSBUF) lmc_suspend(POLLOUT);
+    // Data larger than the buffer is directly written.
+    if (size > LMC_BUSBUF) return lmc_busOutput(data, size);
+    memcpy(&lmc_hal.bus.outbuf.data[lmc_hal.bus.outbuf.size], data, size);
+    lmc_hal.bus.outbuf.size += size;
+}
+
+static void lmc_busPrompt(void)
+{
+    const char* prompt = lmc_hal.bus.prompt;
+    if (!*prompt) return;
+    if (lmc_hal.bus.pipeout) return lmc_busOutput(prompt, strlen(prompt));
+    lmc_busWrite(prompt, strlen(prompt));
+    lmc_busFlush();
+}
 
-    if (lmc_hal.bus.input == stdin) fprintf(lmc_hal.bus.output, "%s", lmc_hal.bus.prompt);
+static void lmc_busPipe(const LmcRam* restrict data, size_t size)
+{
+    lmc_probe(bus__output, data, size);
+    lmc_metricsAdd(LMC_MOUTPUT, size);
+    if (lmc_ringWrite(lmc_hal.bus.pipeout, data, size) < size) lmc_hal.on = false;
+}
 
-    // Instead of directly using a "%2x" format string, first fetch
-    // a generic string, and then convert. This method is prefered as
-    // it handles cases where the first character is an hexadecimal
-    // digit but not the next one; for example if the string "foobar"
-    // is given, the "%2x" value would give 0x0f instead of an error.
-    eof = lmc_hal.bus.input == stdin
-        ? (fscanf(lmc_hal.bus.input, "%" TOSTR(BUFSIZ) "s", (char*)digits) < 1
-           || (error = lmc_convert(digits)))
-        : fread(&lmc_hal.bus.buffer, sizeof(LmcRam), 1, lmc_hal.bus.input) < 1;
+static size_t lmc_ringRead(LmcRing* ring, LmcRam* dest, size_t size)
+{
+    size_t done = 0, chunk = 0, start = 0;
+    bool closed = false;
+
+    while (done < size) {
+        // The closed flag is read before the tail, thus the words
+        // written before the producer shutdown are not lost.
+        closed = __atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE);
+        chunk  = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - ring->head;
+        if (!chunk) {
+            if (closed) break;
+            lmc_ringWait(ring, &ring->tail, ring->head);
+            continue;
+        }
 
-    if (eof) {
-        if (error) {
-            errno = errno ? errno : EINVAL;
-            warn("Not a valid hexadecimal value: '%s'", digits);
+        chunk = chunk < size - done ? chunk : size - done;
+        start = ring->head & (LMC_PIPEBUF - 1);
+        // Copy in two parts when the chunk wraps around the ring.
+        if (start + chunk > LMC_PIPEBUF) {
+            memcpy(&dest[done], &ring->words[start], LMC_PIPEBUF - start);
+            memcpy(&dest[done + LMC_PIPEBUF - start], ring->words, chunk - (LMC_PIPEBUF - start));
+        }
+        else memcpy(&dest[done], &ring->words[start], chunk);
+        __atomic_store_n(&ring->head, ring->head + chunk, __ATOMIC_RELEASE);
+        lmc_ringWake(ring);
+        done += chunk;
+    }
+    return done;
+}
+
+static size_t lmc_ringWrite(LmcRing* ring, const LmcRam* src, size_t size)
+{
+    size_t done = 0, chunk = 0, start = 0;
+
+    while (done < size) {
+        if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)) break;
+        chunk = LMC_PIPEBUF - (ring->tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE));
+        if (!chunk) {
+            lmc_ringWait(ring, &ring->head, ring->tail - LMC_PIPEBUF);
+            continue;
         }
-        else if (ferror(lmc_hal.bus.input)) warn(NULL);
 
-        // Fallback in interactive mode if EOF or an error occurs on a
-        // compiled program file. Shutdown at EOF in interactive.
-        return lmc_setInput(NULL) ? lmc_busInput() : NULL;
+        chunk = chunk < size - done ? chunk : size - done;
+        start = ring->tail & (LMC_PIPEBUF - 1);
+        if (start + chunk > LMC_PIPEBUF) {
+            memcpy(&ring->words[start], &src[done], LMC_PIPEBUF - start);
+            memcpy(ring->words, &src[done + LMC_PIPEBUF - start], chunk - (LMC_PIPEBUF - start));
+        }
+        else memcpy(&ring->words[start], &src[done], chunk);
+        __atomic_store_n(&ring->tail, ring->tail + chunk, __ATOMIC_RELEASE);
+        lmc_ringWake(ring);
+        done += chunk;
     }
+    return done;
+}
+
+static void lmc_ringWait(LmcRing* ring, const size_t* index, size_t seen)
+{
+    uint32_t event = 0;
+
+    for (size_t spin = 0; spin < LMC_RINGSPIN; ++spin, sched_yield())
+        if (__atomic_load_n(index, __ATOMIC_ACQUIRE) != seen
+            || __atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE))
+            return;
+
+    // The event is read before announcing the sleep: a wake up issued
+    // after the last check changes it, and the futex does not sleep.
+    event = __atomic_load_n(&ring->event, __ATOMIC_ACQUIRE);
+    __atomic_add_fetch(&ring->waiters, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(index, __ATOMIC_SEQ_CST) == seen
+        && !__atomic_load_n(&ring->closed, __ATOMIC_SEQ_CST))
+        syscall(SYS_futex, &ring->event, FUTEX_WAIT_PRIVATE, event, NULL, NULL, 0);
+    __atomic_sub_fetch(&ring->waiters, 1, __ATOMIC_RELEASE);
+}
+
+static void lmc_ringWake(LmcRing* ring)
+{
+    // Orders the index or closed flag store before the waiters load,
+    // against the opposite order in lmc_ringWait().
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&ring->waiters, __ATOMIC_RELAXED)) return;
+    __atomic_add_fetch(&ring->event, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &ring->event, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+static void lmc_busFlush(void)
+{
+    if (!lmc_hal.bus.outbuf.size) return;
+    if (lmc_hal.bus.session) return lmc_sessionFlush();
+    lmc_busOutput(lmc_hal.bus.outbuf.data, lmc_hal.bus.outbuf.size);
+    lmc_hal.bus.outbuf.size = 0;
+}
+
+static void lmc_busOutput(const void* restrict data, size_t size)
+{
+    const LmcIo* io = lmc_hal.bus.io;
+    lmc_timing(LMC_TBUSOUTPUT);
+
+    lmc_probe(bus__output, data, size);
+    lmc_metricsAdd(LMC_MOUTPUT, size);
+    if (!io) fwrite(data, sizeof(char), size, lmc_hal.bus.output);
+    else if (io->write && io->write(io->context, data, size) < size) lmc_hal.on = false;
+}
+
+static char* lmc_hex(char* restrict dest, LmcRam value)
+{
+    *dest++ = lmc_hexdigits[value >> 4];
+    *dest++ = lmc_hexdigits[value & 0x0f];
+    return dest;
 }
 
 static int lmc_convert(const char* restrict number)
@@ -648,184 +2222,314 @@ static int lmc_convert(const char* restrict number)
  ******************************************************************************/
 // clang-format on
 
-static void lmc_opcalc(LmcRam operation)
+static void lmc_calc(void)
 {
-    LmcRam opcode = 0;
-    switch (operation) {
-#ifdef _UCODES
-    case ADD:  opcode = ADDOPD; goto op_calc;
-    case SUB:  opcode = SUBOPD; goto op_calc;
-    case NAND: opcode = NANDOP; goto op_calc;
-    default:
-    op_calc:   lmc_ucode(opcode); break; // Opcode 0 does nothing
-#else
-    case ADD:  __attribute__((fallthrough));
-    case SUB:  __attribute__((fallthrough));
-    case NAND: opcode = operation;          goto op_calc;
-    default:   opcode = lmc_hal.alu.opcode; goto op_calc;
-    op_calc:   lmc_hal.alu.opcode = opcode; break;
-#endif
+    // The calculation is done on a wider integer to keep the carry,
+    // and the borrow is detected by the unsigned wrap-around.
+    unsigned int result = lmc_hal.alu.acc;
+    switch(lmc_hal.alu.opcode) {
+    case ADC:  result += lmc_hal.alu.carry; __attribute__((fallthrough));
+    case ADD:  result += lmc_hal.mem.cache.wr; break;
+    case SBC:  result -= lmc_hal.alu.carry; __attribute__((fallthrough));
+    case SUB:  result -= lmc_hal.mem.cache.wr; break;
+    case NAND: lmc_hal.alu.acc = !(lmc_hal.alu.acc && lmc_hal.mem.cache.wr); return;
+    default: return;
     }
+    lmc_hal.alu.carry = result >= LMC_MAXVAL;
+    lmc_hal.alu.acc   = (LmcRam)result;
 }
 
-static void lmc_indirection(LmcRam type)
+static void lmc_fault(LmcRam address, const char* restrict reason)
 {
-    // Fallthrough as the indirection operations are cumulative.
-    switch (type) {
-#ifdef _UCODES
-    case INDIR: lmc_useries(SVTOWR, WRTOAD, ADTOSR, NULL); __attribute__((fallthrough));
-    case VAR:   lmc_useries(SVTOWR, WRTOAD, ADTOSR, NULL); __attribute__((fallthrough));
-    default:    lmc_ucode(SVTOWR); break;
-#else
-    case INDIR: lmc_rwMemory(lmc_hal.mem.cache.sr, &lmc_hal.mem.cache.sr, 'r'); __attribute__((fallthrough));
-    case VAR:   lmc_rwMemory(lmc_hal.mem.cache.sr, &lmc_hal.mem.cache.sr, 'r'); __attribute__((fallthrough));
-    default:    lmc_rwMemory(lmc_hal.mem.cache.sr, &lmc_hal.mem.cache.wr, 'r'); break;
-#endif
+    lmc_hal.on = false;
+    errno      = EFAULT;
+    lmc_warn(LMC_HEXFMT ": %s", LMC_MAXDIGITS, address, reason);
+}
+
+static void lmc_romFault(LmcRam address)
+{
+    lmc_count(faults, 1);
+    lmc_probe(rom__fault, address);
+    lmc_fault(address, "read only");
+}
+
+static void lmc_setStack(LmcRam limit)
+{
+    // The stack cannot overlap the ROM.
+    if (limit && limit < LMC_MAXROM) return lmc_romFault(limit);
+    lmc_hal.cu.sl   = limit;
+    lmc_hal.cu.sp   = LMC_STACKBASE;
+    lmc_hal.mem.top = limit ? limit : LMC_MAXRAM;
+}
+
+#ifdef _STATS
+
+// clang-format off
+
+/******************************************************************************
+ * Statistics
+ ******************************************************************************/
+// clang-format on
+
+static void lmc_statsCycle(void)
+{
+    LmcRam pc = lmc_hal.cu.pc;
+
+    if (lmc_restart) return;
+    if (lmc_hal.profile) lmc_profileStep(lmc_hal.profile, pc);
+    ++lmc_hal.stats.cycles;
+    // The addresses wrap around as the PC.
+    lmc_hal.code[pc] = lmc_hal.code[(LmcRam)(pc + 1)] = true;
+}
+
+static void lmc_statsOpcode(LmcRam opcode)
+{
+    if (lmc_restart) return;
+    ++lmc_hal.stats.opcodes[opcode];
+    if (lmc_hal.profile) lmc_hal.profile->opcode = opcode;
+    switch (opcode & ~(INDIR)) {
+    case IN:    __attribute__((fallthrough));
+    case INS:   __attribute__((fallthrough));
+    case INSB:  ++lmc_hal.stats.inputs; break;
+    case OUT:   __attribute__((fallthrough));
+    case OUTS:  __attribute__((fallthrough));
+    case OUTSB: ++lmc_hal.stats.outputs; break;
+    default: break;
+    }
+}
+
+static void lmc_statsWrite(unsigned int address, LmcRam length)
+{
+    lmc_hal.stats.writes += length;
+    for (unsigned int i = address; i < address + length; ++i)
+        lmc_hal.stats.selfmod += lmc_hal.code[i];
+}
+
+static void lmc_statsStart(const char* restrict path)
+{
+    lmc_hal.path = path;
+    if (lmc_profiles.path && !(lmc_hal.profile = calloc(1, sizeof(LmcProfile))))
+        lmc_err("could not allocate the profile");
+    clock_gettime(CLOCK_MONOTONIC, &lmc_hal.start);
+}
+
+static void lmc_statsStop(void)
+{
+    LmcProfile* profile = lmc_hal.profile;
+    struct timespec stop = { 0 };
+
+    if (!lmc_hal.start.tv_sec && !lmc_hal.start.tv_nsec) return;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    lmc_hal.stats.seconds = (double)(stop.tv_sec - lmc_hal.start.tv_sec)
+        + (double)(stop.tv_nsec - lmc_hal.start.tv_nsec) / 1e9;
+    lmc_hal.start = (struct timespec){ 0 };
+    if (lmc_statsFormat != LMC_STATSOFF) lmc_statsReport();
+
+    if (!profile) return;
+    // The last instruction and the unfinished calls end here.
+    if (profile->started) profile->cycles[profile->address] += lmc_statsCost() - profile->mark;
+    while (profile->depth) lmc_profileReturn(profile);
+    lmc_profileWrite(profile);
+    free(profile);
+    lmc_hal.profile = NULL;
+}
+
+static void lmc_statsReport(void)
+{
+    LmcStats* stats = &lmc_hal.stats;
+    char name[16] = { 0 };
+    bool json = lmc_statsFormat == LMC_STATSJSON;
+    const char* separator = "";
+    double mips = stats->seconds > 0 ? (double)stats->cycles / stats->seconds / 1e6 : 0;
+
+    // The concurrent programs reports are not interleaved.
+    flockfile(stderr);
+    fprintf(stderr, json
+            ? "{\"cycles\":%zu,\"seconds\":%.9f,\"mips\":%.3f,\"reads\":%zu,"
+              "\"writes\":%zu,\"faults\":%zu,\"inputs\":%zu,\"outputs\":%zu,"
+              "\"taken\":%zu,\"untaken\":%zu,\"selfmod\":%zu,\"ucodes\":%zu,"
+              "\"opcodes\":{"
+            : "cycles: %zu\nseconds: %.9f\nmips: %.3f\nreads: %zu\n"
+              "writes: %zu\nfaults: %zu\ninputs: %zu\noutputs: %zu\n"
+              "taken: %zu\nuntaken: %zu\nselfmod: %zu\nucodes: %zu\n"
+              "opcodes:\n",
+            stats->cycles, stats->seconds, mips, stats->reads,
+            stats->writes, stats->faults, stats->inputs, stats->outputs,
+            stats->taken, stats->untaken, stats->selfmod, stats->ucodes);
+    for (size_t i = 0; i < LMC_MAXRAM; ++i) {
+        if (!stats->opcodes[i]) continue;
+        fprintf(stderr, json ? "%s\"%s\":%zu" : "%s  %s: %zu\n",
+                separator, lmc_opname(name, i), stats->opcodes[i]);
+        separator = json ? "," : "";
     }
+    fputs(json ? "}}\n" : "", stderr);
+    funlockfile(stderr);
 }
 
-static bool lmc_operation(LmcRam operation)
+static size_t lmc_statsCost(void)
 {
-    LmcRam* value = NULL;
-    switch (operation) {
-    case BRN:   if (!(lmc_hal.alu.acc & LMC_SIGN)) break; goto op_jump;
-    case BRZ:   if (lmc_hal.alu.acc != 0) break; goto op_jump;
-    case ADD:   __attribute__((fallthrough));
-    case SUB:   __attribute__((fallthrough));
 #ifdef _UCODES
-    case NAND:  lmc_ucode(DOCALC); break;
-    case LOAD:  lmc_ucode(WRTOAC); break;
-    case OUT:   lmc_useries(SVTOWR, WRTOOU, NULL); break;
-    case IN:    lmc_useries(WINPUT, INTOWR, WRTOSV, NULL); break;
-    case STORE: lmc_useries(ACTOWR, WRTOSV, NULL); break;
-    case JUMP:
-    op_jump:    lmc_ucode(WRTOPC); return false;
-    case HLT:   lmc_ucode(LMCHLT); return false;
+    return lmc_hal.stats.ucodes;
 #else
-    case NAND:  lmc_calc(); break;
-    case LOAD:  lmc_hal.alu.acc = lmc_hal.mem.cache.wr; break;
-    case OUT:
-        lmc_rwMemory(lmc_hal.mem.cache.sr, &lmc_hal.mem.cache.wr, 'r');
-        lmc_busOutput(LMC_WRDVAL);
-        break;
-    case IN:
-        lmc_busInput();
-        lmc_rwMemory(lmc_hal.mem.cache.sr, &lmc_hal.bus.buffer, 'w');
-        break;
-    case STORE:
-        lmc_rwMemory(lmc_hal.mem.cache.sr, &lmc_hal.alu.acc, 'w');
-        break;
-    case JUMP:
-    op_jump:    lmc_hal.cu.pc = lmc_hal.mem.cache.wr; return false;
-    case HLT:   return (lmc_hal.on = false);
+    return lmc_hal.stats.reads + lmc_hal.stats.writes;
 #endif
-    // Debugging instructions
-    case DEBUG: return (lmc_hal.dbg.opcode = lmc_hal.mem.cache.wr);
-    case CONT:  lmc_hal.dbg.opcode = lmc_hal.mem.cache.wr; return false;
-    case NEXT:  break;
-    case BREAK: lmc_hal.dbg.brk = lmc_hal.mem.cache.wr; break;
-    case FREE:  lmc_hal.dbg.brk = 0; break;
-    case PRINT: lmc_hal.dbg.prt = lmc_hal.mem.cache.wr; break;
-    case CLEAR: lmc_hal.dbg.prt = 0; break;
-    case DUMP:
-        lmc_busInput();
-        lmc_dump(lmc_hal.mem.cache.wr, lmc_hal.bus.buffer);
-        break;
-    default:
-        // In case the macro _UCODES is undefined.
-        (void) value;
-        break;
-    }
-    return true;
 }
 
-static void lmc_calc(void)
+static void lmc_profileStep(LmcProfile* profile, LmcRam address)
 {
-    switch(lmc_hal.alu.opcode) {
-    case ADD:  lmc_hal.alu.acc += lmc_hal.mem.cache.wr; break;
-    case SUB:  lmc_hal.alu.acc -= lmc_hal.mem.cache.wr; break;
-    case NAND: lmc_hal.alu.acc = !(lmc_hal.alu.acc && lmc_hal.mem.cache.wr); break;
-    default: break;
+    size_t cost = lmc_statsCost();
+    size_t i = 0;
+
+    if (!profile->started) profile->function = address, profile->started = true;
+    else {
+        profile->cycles[profile->address] += cost - profile->mark;
+        switch (profile->opcode & ~(INDIR)) {
+        case CALL:
+            // The calls beyond the max depth are only counted.
+            if (profile->depth++ >= LMC_MAXDEPTH) break;
+            for (i = 0; i < profile->ncalls; ++i)
+                if (profile->calls[i].caller == profile->function
+                    && profile->calls[i].site == profile->address
+                    && profile->calls[i].callee == address)
+                    break;
+            if (i == profile->ncalls && i < LMC_MAXCALLS)
+                profile->calls[profile->ncalls++] = (LmcCall){
+                    .caller = profile->function,
+                    .site   = profile->address,
+                    .callee = address,
+                };
+            if (i < LMC_MAXCALLS) ++profile->calls[i].count;
+            profile->stack[profile->depth - 1] = (LmcFrame){
+                .call   = i,
+                .caller = profile->function,
+                .hits   = lmc_hal.stats.cycles,
+                .cycles = cost,
+            };
+            profile->function = address;
+            break;
+        case RET: if (profile->depth) lmc_profileReturn(profile); break;
+        default: break;
+        }
     }
+
+    if (!profile->hits[address]++) profile->owner[address] = profile->function;
+    profile->address = address;
+    profile->opcode  = 0;
+    profile->mark    = cost;
 }
 
-static void lmc_rwMemory(LmcRam address, LmcRam* value, char mode)
+static void lmc_profileReturn(LmcProfile* profile)
 {
-    switch (mode) {
-    // LmcRam cannot have a value greater than the max size of RAM,
-    // thus it is not checked. This ensures to avoid a real SIGSEGV,
-    // but not a valid rw operation (due to overflow).
-    case 'r': *value = lmc_hal.mem.ram[address]; break;
-    case 'w':
-        // Emulate a invalid write error.
-        if (address < LMC_MAXROM) {
-            lmc_hal.on         = false;
-            errno              = EFAULT;
-            warn(LMC_HEXFMT ": read only", LMC_MAXDIGITS, address);
-            return;
-        }
-        lmc_hal.mem.ram[address] = *value;
-        break;
-    default: break;
+    LmcFrame* frame = NULL;
+
+    if (--profile->depth >= LMC_MAXDEPTH) return;
+    frame = &profile->stack[profile->depth];
+    profile->function = frame->caller;
+    if (frame->call >= LMC_MAXCALLS) return;
+    profile->calls[frame->call].hits   += lmc_hal.stats.cycles - frame->hits;
+    profile->calls[frame->call].cycles += lmc_statsCost() - frame->cycles;
+}
+
+static void lmc_profileWrite(const LmcProfile* profile)
+{
+    unsigned int lines[LMC_MAXRAM] = { 0 };
+    char source[PATH_MAX] = { 0 }, path[PATH_MAX] = { 0 };
+    bool mapped = false, functions[LMC_MAXRAM] = { false };
+    size_t hits = 0, cycles = 0;
+    FILE* output = NULL;
+
+    // The compiler is not thread-safe, thus it shares the lock.
+    pthread_mutex_lock(&lmc_profiles.lock);
+    if (lmc_hal.path
+        && snprintf(source, PATH_MAX, "%s" LMC_EXT, lmc_hal.path) < PATH_MAX
+        && !access(source, R_OK))
+        mapped = !lmc_sourceLines(source, lines);
+    if (lmc_profiles.count++) snprintf(path, PATH_MAX, "%s.%zu", lmc_profiles.path, lmc_profiles.count);
+    else snprintf(path, PATH_MAX, "%s", lmc_profiles.path);
+    pthread_mutex_unlock(&lmc_profiles.lock);
+
+    if (!(output = fopen(path, "w"))) return lmc_warn("%s", path);
+    for (size_t i = 0; i < LMC_MAXRAM; ++i) {
+        hits += profile->hits[i], cycles += profile->cycles[i];
+        if (profile->hits[i]) functions[profile->owner[i]] = true;
     }
+    fprintf(output,
+            "# callgrind format\nversion: 1\ncreator: lmc\ncmd: %s\n"
+            "positions: instr line\nevents: Ir Cycles\nsummary: %zu %zu\n\n"
+            "fl=%s\n",
+            lmc_hal.path ? lmc_hal.path : "program", hits, cycles,
+            mapped ? source : lmc_hal.path ? lmc_hal.path : "program");
+
+    // The addresses without source line are on the line 0.
+    for (size_t fn = 0; fn < LMC_MAXRAM; ++fn) {
+        if (!functions[fn]) continue;
+        fprintf(output, "\nfn=0x" LMC_HEXFMT "\n", LMC_MAXDIGITS, (unsigned int)fn);
+        for (size_t i = 0; i < LMC_MAXRAM; ++i)
+            if (profile->hits[i] && profile->owner[i] == fn)
+                fprintf(output, "0x" LMC_HEXFMT " %u %zu %zu\n", LMC_MAXDIGITS, (unsigned int)i,
+                        lines[i], profile->hits[i], profile->cycles[i]);
+        for (size_t i = 0; i < profile->ncalls; ++i)
+            if (profile->calls[i].caller == fn)
+                fprintf(output,
+                        "cfn=0x" LMC_HEXFMT "\ncalls=%zu 0x" LMC_HEXFMT " %u\n"
+                        "0x" LMC_HEXFMT " %u %zu %zu\n",
+                        LMC_MAXDIGITS, profile->calls[i].callee,
+                        profile->calls[i].count, LMC_MAXDIGITS, profile->calls[i].callee,
+                        lines[profile->calls[i].callee],
+                        LMC_MAXDIGITS, profile->calls[i].site, lines[profile->calls[i].site],
+                        profile->calls[i].hits, profile->calls[i].cycles);
+    }
+    fclose(output);
 }
 
-#ifdef _UCODES
+#endif // _STATS
 
 // clang-format off
-
+
 /******************************************************************************
- * Microcodes handling
+ * Metrics
  ******************************************************************************/
 // clang-format on
 
-static void lmc_useries(unsigned int ucode, ...)
-{
-    va_list ucodes;
-    va_start(ucodes, ucode);
-    do { lmc_ucode((LmcUcodes)ucode); }
-    while ((ucode = va_arg(ucodes, unsigned int)) > 0);
-    va_end(ucodes);
-}
-
-static void lmc_ucode(LmcUcodes ucode)
-{
-    // Functions are used for WRTOOU, DOCALC, SVTOWR, WRTOSV, and
-    // WINPUT in order to:
-    //
-    // - allow the two versions (with and without _UCODES) to work
-    // - allow WINPUT to agnostically handle multiple input sources
-    // - implement ROM protection
-    // - distinguish between real SIGSEGV errors from the LMC programs
-    //   errors; this is not strictly necessary in production versions
-    //   of the LMC software, but greatly help during development
-
-    switch (ucode) {
-    case PCTOSR: lmc_hal.mem.cache.sr = lmc_hal.cu.pc; break;
-    case WRTOPC: lmc_hal.cu.pc = lmc_hal.mem.cache.wr; break;
-    case WRTOAC: lmc_hal.alu.acc = lmc_hal.mem.cache.wr; break;
-    case ACTOWR: lmc_hal.mem.cache.wr = lmc_hal.alu.acc; break;
-    case WRTOOP: lmc_hal.alu.opcode = lmc_hal.mem.cache.wr; break;
-    case WRTOAD: lmc_hal.cu.ir.ad = lmc_hal.mem.cache.wr; break;
-    case ADTOSR: lmc_hal.mem.cache.sr = lmc_hal.cu.ir.ad; break;
-    case INTOWR: lmc_hal.mem.cache.wr = lmc_hal.bus.buffer; break;
-    case WRTOOU: lmc_busOutput(LMC_WRDVAL); break;
-    case ADDOPD: lmc_hal.alu.opcode = ADD; break;
-    case SUBOPD: lmc_hal.alu.opcode = SUB; break;
-    case DOCALC: lmc_calc(); break;
-    case SVTOWR: __attribute__((fallthrough));
-    case WRTOSV:
-        lmc_rwMemory(
-            lmc_hal.mem.cache.sr,
-            &lmc_hal.mem.cache.wr, ucode == SVTOWR ? 'r' : 'w'
-        );
-        break;
-    case INCRPC: ++lmc_hal.cu.pc; break;
-    case WINPUT: lmc_busInput(); break;
-    case NANDOP: lmc_hal.alu.opcode = NAND; break;
-    case LMCHLT: lmc_hal.on = false; break;
-    default: break;
-    }
+static void lmc_metricsDone(bool failed)
+{
+    lmc_metricsAdd(LMC_MINSTRUCTIONS, lmc_steps & (LMC_METRICSTEP - 1));
+    lmc_metricsAdd(failed ? LMC_MFAILED : LMC_MCOMPLETED, 1);
+    lmc_steps = 0;
 }
 
-#endif // _UCODES
+// clang-format off
+
+/******************************************************************************
+ * Tracing
+ ******************************************************************************/
+// clang-format on
+
+static void lmc_traceStart(const char* restrict path)
+{
+    char trace[PATH_MAX] = { 0 };
+
+    pthread_mutex_lock(&lmc_traces.lock);
+    if (lmc_traces.path && lmc_traces.count++)
+        snprintf(trace, PATH_MAX, "%s.%zu", lmc_traces.path, lmc_traces.count);
+    else if (lmc_traces.path) snprintf(trace, PATH_MAX, "%s", lmc_traces.path);
+    pthread_mutex_unlock(&lmc_traces.lock);
+    if (*trace) lmc_hal.trace = lmc_traceOpen(trace, path);
+}
+
+static void lmc_traceStop(void)
+{
+    if (!lmc_hal.trace) return;
+    lmc_traceClose(lmc_hal.trace, lmc_hal.mem.ram, lmc_hal.alu.acc);
+    lmc_hal.trace = NULL;
+}
+
+static size_t lmc_replayRead(void* context, LmcRam* dest, size_t size)
+{
+    __typeof__(lmc_replay)* replay = context;
+
+    size = size < replay->size - replay->pos ? size : replay->size - replay->pos;
+    if (size) memcpy(dest, &replay->words[replay->pos], size);
+    replay->pos += size;
+    return size;
+}
@@ -0,0 +1,945 @@
+/**
+ * @file       cycle.h
+ * @version    0.1.0
+ * @brief      The LMC instructions cycle.
+ * @author     Alexandre Martos
+ * @email      contact@amartos.fr
+ * @copyright  2023 Alexandre Martos <contact@amartos.fr>
+ * @license    GPLv3
+ *
+ * This file is not a header: it is included twice by computer.c, with
+ * #LMC_INSTRUMENTED set to @c 0, then to @c 1. The second copy of the
+ * cycle has its functions suffixed with @c Instrumented, and is the
+ * only one calling the instrumentation sites (traces and hooks). A
+ * run chooses its copy once, when it starts, thus the runs without
+ * instrumentation do not check for it on each instruction.
+ *
+ * @addtogroup ComputerInternals
+ * @{
+ */
+
+#if LMC_INSTRUMENTED
+#define lmc_run            lmc_runInstrumented
+#define lmc_slice          lmc_sliceInstrumented
+#define lmc_debug          lmc_debugInstrumented
+#define lmc_dbg_phaseOne   lmc_dbg_phaseOneInstrumented
+#define lmc_dbg_phaseTwo   lmc_dbg_phaseTwoInstrumented
+#define lmc_dbg_phaseThree lmc_dbg_phaseThreeInstrumented
+#define lmc_phaseOne       lmc_phaseOneInstrumented
+#define lmc_phaseTwo       lmc_phaseTwoInstrumented
+#define lmc_phaseThree     lmc_phaseThreeInstrumented
+#define lmc_busInput       lmc_busInputInstrumented
+#define lmc_busBlock       lmc_busBlockInstrumented
+#define lmc_busWord        lmc_busWordInstrumented
+#define lmc_opcalc         lmc_opcalcInstrumented
+#define lmc_indirection    lmc_indirectionInstrumented
+#define lmc_operation      lmc_operationInstrumented
+#define lmc_rwMemory       lmc_rwMemoryInstrumented
+#define lmc_block          lmc_blockInstrumented
+#define lmc_rwBlock        lmc_rwBlockInstrumented
+#define lmc_useries        lmc_useriesInstrumented
+#define lmc_ucode          lmc_ucodeInstrumented
+#endif
+
+// clang-format off
+
+/******************************************************************************
+ * @name Execution
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+/**
+ * @since 0.1.0
+ * @brief Execute the program until it halts.
+ * @param limit The instructions limit, or @c 0 for none.
+ * @return The number of instructions started, over @p limit if it is
+ * reached.
+ */
+static size_t lmc_run(size_t limit);
+
+/**
+ * @since 0.1.0
+ * @brief Execute a slice of #LMC_SESSIONSLICE instructions of a
+ * session.
+ *
+ * The registers are saved in #lmc_saved before each instruction, for
+ * its rollback if the session is suspended.
+ *
+ * @param session The session, whose instructions limit is checked.
+ * @return @c true if the slice is over before the program halts,
+ * otherwise @c false.
+ */
+static bool lmc_slice(LmcSession* session) __attribute__((nonnull));
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * @name Debugging
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+/**
+ * @since 0.1.0
+ * @brief Step in the debugger.
+ * @return @c true to execute the next program instruction, @c false
+ * to immediately re-step in the debugger.
+ */
+static bool lmc_debug(void);
+
+/**
+ * @since 0.1.0
+ * @brief Debugger phase 1.
+ *
+ * Print the current PC address value if it is stored in
+ * #lmc_hal::dbg::prt and indicate if the computer must go into the
+ * debugger second phase.
+ *
+ * @return @c false to skip the next debug phase, @c true to execute
+ * it.
+ */
+static bool lmc_dbg_phaseOne(void);
+
+/**
+ * @since 0.1.0
+ * @brief Debugger phase 2.
+ *
+ * Print #lmc_hal::cu::pc and #lmc_hal::alu:acc, then wait for
+ * instructions input.
+ */
+static void lmc_dbg_phaseTwo(void);
+
+/**
+ * @since 0.1.0
+ * @brief Debugger phase 3.
+ *
+ * Execute the instructions input at phase 2.
+ *
+ * @return @c true to immediately re-step in the debugger, @c false to
+ * continue the program execution.
+ */
+static bool lmc_dbg_phaseThree(void);
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * @name LMC phases.
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+/**
+ * @since 0.1.0
+ * @brief LMC Phase 1: seek for the next instruction.
+ */
+static void lmc_phaseOne(void);
+
+/**
+ * @since 0.1.0
+ * @brief LMC phase 2: decode the instruction, seek the operand, and
+ * apply the instruction.
+ * @param debug Indicate if the phase is executed from the debugger.
+ * @return @c true to execute phase 3, @c false to skip it.
+ */
+static bool lmc_phaseTwo(bool debug);
+
+/**
+ * @since 0.1.0
+ * @brief LMC phase 3: increment PC.
+ */
+static void lmc_phaseThree(void);
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * @name IO management.
+ *
+ * These functions and macros are used for interaction of the LMC with
+ * the external world through the bus.
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+/**
+ * @since 0.1.0
+ * @brief Wait for input from #lmc_hal::bus::input and store it in
+ * #lmc_hal::bus::buffer.
+ */
+static void lmc_busInput(void);
+
+/**
+ * @since 0.1.0
+ * @brief Transfer a length-prefixed memory block between
+ * #lmc_hal::mem::ram and the bus in one go.
+ *
+ * The block address is #lmc_hal::mem::cache::wr. The block is read
+ * as a whole in binary from a compiled program file, or for #INSB,
+ * otherwise word by word with a single prompt. #OUTS outputs the
+ * block in hexadecimal, #OUTSB in binary.
+ *
+ * @param operation The operation bytecode without indirection
+ * instructions.
+ */
+static void lmc_busBlock(LmcRam operation);
+
+/**
+ * @since 0.1.0
+ * @brief Append a value in hexadecimal to #lmc_hal::bus::outbuf,
+ * flushing it when full.
+ * @param value The value.
+ */
+static void lmc_busWord(LmcRam value);
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * @name Operations
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+/**
+ * since 0.1.0
+ * @brief Check if #lmc_hal::alu::opcode value must change.
+ * @param operation The operation bytecode without indirection
+ * instructions.
+ */
+static void lmc_opcalc(LmcRam operation);
+
+/**
+ * @since 0.1.0
+ * @brief Fetch the value of the current #lmc_hal::mem::cache::sr
+ * address, applying the indicated indirection level.
+ * @param type The indirection level (@c 0, #VAR, #IDX or #VAR|#PTR).
+ */
+static void lmc_indirection(LmcRam type);
+
+/**
+ * @since 0.1.0
+ * @brief Execute an operation.
+ * @param operation The operation bytecode without indirection
+ * instructions.
+ */
+static bool lmc_operation(LmcRam operation);
+
+/**
+ * @since 0.1.0
+ * @brief Read/Write in #lmc_hal::mem::ram.
+ *
+ * This function checks that the address and operation are valid,
+ * i.e. that ROM is read-only, the stack is only accessed through the
+ * stack instructions and RAM is read-write. The function raises an
+ * @c EFAULT error if not and cleanly shutdowns the computer.
+ *
+ * @param address The read memory address, or write destination address.
+ * @param value The storage destination for read modes, the source
+ * value for write modes.
+ * @param mode The mode, either 'r' for read, 'w' for write, 'o' for
+ * a stack pop or 'p' for a stack push.
+ */
+static void lmc_rwMemory(LmcRam address, LmcRam* value, char mode) __attribute__((nonnull (2)));
+
+/**
+ * @since 0.1.0
+ * @brief Execute a block instruction.
+ *
+ * The parameter block is read at the #lmc_hal::mem::cache::wr
+ * address. #CMP stores in #lmc_hal::alu::acc @c 0 if the blocks are
+ * equal, @c 1 if the first is greater and @c -1 otherwise.
+ *
+ * @param operation The operation bytecode without indirection
+ * instructions.
+ */
+static void lmc_block(LmcRam operation);
+
+/**
+ * @since 0.1.0
+ * @brief Check a whole #lmc_hal::mem::ram section at once.
+ *
+ * This is the block version of lmc_rwMemory(), with the same
+ * protections and faults.
+ *
+ * @param address The section start address.
+ * @param length The section length.
+ * @param mode The mode, either 'r' for read or 'w' for write.
+ * @return A pointer to the section start, or @c NULL in case of
+ * fault.
+ */
+static LmcRam* lmc_rwBlock(unsigned int address, LmcRam length, char mode);
+
+#ifdef _UCODES
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * @name Microcodes
+ *
+ * This section is optional, can optionally be loaded at compile-time
+ * for a deeper level of emulation, by defining the #_UCODES macro.
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+/**
+ * @since 0.1.0
+ * @brief Execute a series of microcodes operations.
+ * @attention Needs a @c NULL sentinel value.
+ * @param ucode A microcode.
+ * @param ... The remaining microcodes with a @c NULL as last
+ * argument.
+ */
+static void lmc_useries(unsigned int ucode, ...) __attribute__((sentinel));
+
+/**
+ * @since 0.1.0
+ * @brief Execute one microcode operation.
+ * @param ucode The microcode.
+ */
+static void lmc_ucode(LmcUcodes ucode);
+
+#endif // _UCODES
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * Implementation
+ ******************************************************************************/
+// clang-format on
+
+static size_t lmc_run(size_t limit)
+{
+    // Without limit, the count cannot go over the last step.
+    size_t steps = 0, last = limit ? limit : SIZE_MAX;
+
+    while (lmc_hal.on) {
+        while (lmc_debug());
+        if (++steps > last) {
+            errno = ETIME;
+            lmc_warn("the instructions limit (%zu) is reached", limit);
+            break;
+        }
+        lmc_phaseOne(), lmc_phaseTwo(false) ? lmc_phaseThree() : 0;
+        lmc_metricsStep();
+    }
+    return steps;
+}
+
+static bool lmc_slice(LmcSession* session)
+{
+    for (size_t slice = 0; lmc_hal.on; ++slice) {
+        // A long computation yields to the other sessions.
+        if (slice == LMC_SESSIONSLICE) return true;
+        if (++session->steps > session->limit && session->limit) {
+            errno = ETIME;
+            lmc_warn("the instructions limit (%zu) is reached", session->limit);
+            lmc_hal.on = false;
+            break;
+        }
+        lmc_saved.cache  = lmc_hal.mem.cache;
+        lmc_saved.cu     = lmc_hal.cu;
+        lmc_saved.alu    = lmc_hal.alu;
+        lmc_saved.prompt = lmc_hal.bus.prompt;
+#ifdef _STATS
+        lmc_saved.reads  = lmc_hal.stats.reads;
+        lmc_saved.faults = lmc_hal.stats.faults;
+        lmc_saved.ucodes = lmc_hal.stats.ucodes;
+#endif
+        lmc_phaseOne(), lmc_phaseTwo(false) ? lmc_phaseThree() : 0;
+        lmc_restart = false;
+        lmc_metricsStep();
+    }
+    return false;
+}
+
+// clang-format off
+
+/******************************************************************************
+ * Debugging
+ ******************************************************************************/
+// clang-format on
+
+static bool lmc_debug(void)
+{
+    return
+        lmc_dbg_phaseOne()
+        ? (lmc_dbg_phaseTwo(), lmc_dbg_phaseThree())
+        : false;
+}
+
+static bool lmc_dbg_phaseOne(void)
+{
+    if (!(lmc_hal.on && lmc_hal.dbg.opcode))
+        return false;
+
+    if (lmc_hal.dbg.prt // we don't want to print the value of address 0x00.
+        && lmc_hal.dbg.prt == lmc_hal.cu.pc)
+        lmc_dump(lmc_hal.cu.pc, lmc_hal.cu.pc);
+
+    if (lmc_hal.dbg.opcode == CONT
+        && lmc_hal.dbg.brk // ibid, skip address 0x00
+        && lmc_hal.cu.pc != lmc_hal.dbg.brk)
+        return false;
+
+    return true;
+}
+
+static void lmc_dbg_phaseTwo(void)
+{
+    // Set the special prompt for the debugger.
+    char prompt[BUFSIZ] = {0};
+    lmc_probe(debug__enter, lmc_hal.cu.pc);
+    sprintf(prompt, LMC_DBGPROMPT);
+    lmc_hal.bus.prompt = prompt;
+
+    // The opcode is overwritten without issue because the debug phase
+    // is upstream of the LMC phase 1, and the previous opcode is not
+    // used anymore.
+    lmc_busInput(), lmc_hal.alu.opcode   = lmc_hal.bus.buffer;
+    lmc_busInput(), lmc_hal.mem.cache.wr = lmc_hal.bus.buffer;
+
+    // Reset the prompt in case the debug instruction exits the
+    // debugger.
+    lmc_hal.bus.prompt = LMC_PROMPT;
+}
+
+static bool lmc_dbg_phaseThree(void) { return lmc_phaseTwo(true); }
+
+// clang-format off
+
+/******************************************************************************
+ * LMC cycle.
+ ******************************************************************************/
+// clang-format on
+
+static void lmc_phaseOne(void) {
+    lmc_timing(LMC_TPHASEONE);
+    lmc_statsCycle();
+    lmc_traced(lmc_traceFetch, lmc_hal.mem.ram, lmc_hal.cu.pc, lmc_hal.alu.acc);
+    lmc_probe(fetch, lmc_hal.cu.pc, lmc_hal.alu.acc);
+    if (!lmc_restart) lmc_hook(fetch, lmc_hal.cu.pc);
+#ifdef _UCODES
+    lmc_useries(PCTOSR, SVTOWR, WRTOOP, INCRPC, NULL);
+#else
+    lmc_rwMemory(lmc_hal.cu.pc++, &lmc_hal.alu.opcode, 'r');
+#endif
+}
+
+static bool lmc_phaseTwo(bool debug)
+{
+    // Split the indirection instruction from the operation bytecode.
+    LmcRam operation = lmc_hal.alu.opcode & ~(INDIR);
+    LmcRam value     = lmc_hal.alu.opcode & INDIR;
+    lmc_timing(LMC_TPHASETWO);
+
+    // The debugger commands are not counted.
+    if (!debug) lmc_statsOpcode(lmc_hal.alu.opcode);
+    lmc_opcalc(operation);
+    // If the caller is the debugger, fetching the operation argument
+    // as usual, i.e. from the current PC address, will overwrite the
+    // argument given to the debugger and stored in the word
+    // register. Hence the branching to avoid this.
+    if (debug) { lmc_hal.mem.cache.sr = lmc_hal.mem.cache.wr; }
+    else {
+#ifdef _UCODES
+    lmc_ucode(PCTOSR);
+#else
+    lmc_hal.mem.cache.sr = lmc_hal.cu.pc;
+#endif
+    }
+    lmc_indirection(value);
+    if (!debug && !lmc_restart) lmc_hook(operand, lmc_hal.alu.opcode, lmc_hal.mem.cache.sr, lmc_hal.mem.cache.wr);
+    return lmc_operation(operation);
+}
+
+static void lmc_phaseThree(void) {
+    lmc_timing(LMC_TPHASETHREE);
+#ifdef _UCODES
+    lmc_ucode(INCRPC);
+#else
+    ++lmc_hal.cu.pc;
+#endif
+}
+
+// clang-format off
+
+/******************************************************************************
+ * IO handling
+ ******************************************************************************/
+// clang-format on
+
+static void lmc_busInput(void)
+{
+    bool error = false;
+    char digits[BUFSIZ+1] = { 0 };
+    lmc_timing(LMC_TBUSINPUT);
+
+    // The compiled program is read from memory, then the user input
+    // takes over at its end.
+    if (lmc_hal.bus.program.data) {
+        if (lmc_programRead(&lmc_hal.bus.buffer, 1)) return;
+        lmc_setInput(NULL);
+    }
+
+    lmc_busFlush();
+    // The session, the previous pipeline stage or the data stream
+    // replace the user input.
+    if (lmc_hal.bus.session) lmc_sessionInput();
+    else if (lmc_hal.bus.pipein) {
+        if (!lmc_ringRead(lmc_hal.bus.pipein, &lmc_hal.bus.buffer, 1)) lmc_hal.on = false;
+    }
+    else if (lmc_hal.bus.data) lmc_streamInput();
+    else {
+        lmc_busPrompt();
+
+        // Instead of directly using a "%2x" format string, first fetch
+        // a generic string, and then convert. This method is prefered as
+        // it handles cases where the first character is an hexadecimal
+        // digit but not the next one; for example if the string "foobar"
+        // is given, the "%2x" value would give 0x0f instead of an error.
+        if (fscanf(lmc_hal.bus.input, "%" TOSTR(BUFSIZ) "s", (char*)digits) < 1
+            || (error = lmc_convert(digits))) {
+            if (error) {
+                errno = errno ? errno : EINVAL;
+                lmc_warn("Not a valid hexadecimal value: '%s'", digits);
+            }
+            else if (ferror(lmc_hal.bus.input)) lmc_warn(NULL);
+
+            // Shutdown at EOF in interactive.
+            return lmc_setInput(NULL) ? lmc_busInput() : NULL;
+        }
+    }
+    // Only the input read outside of the program is traced, the
+    // program being read again by the replays.
+    if (!lmc_hal.on) return;
+    lmc_traced(lmc_traceInput, &lmc_hal.bus.buffer, 1);
+    lmc_probe(bus__input, &lmc_hal.bus.buffer, 1);
+    lmc_metricsAdd(LMC_MINPUT, 1);
+    lmc_hook(input, &lmc_hal.bus.buffer, 1);
+}
+
+static void lmc_busBlock(LmcRam operation)
+{
+    const char* prompt = lmc_hal.bus.prompt;
+    LmcRam length = 0, *block = NULL;
+    size_t done = 0;
+
+    lmc_rwMemory(lmc_hal.mem.cache.wr, &length, 'r');
+    if (!(block = lmc_rwBlock(lmc_hal.mem.cache.wr + 1, length, operation & INV ? 'r' : 'w')))
+        return;
+
+    switch (operation) {
+    case INSB:
+        if (lmc_hal.bus.program.data) goto ins_program;
+        if (lmc_hal.bus.session) {
+            done = lmc_sessionRead(block, length);
+            goto ins_remains;
+        }
+        if (lmc_hal.bus.pipein || lmc_hal.bus.data) goto ins_stream;
+        done = fread(block, sizeof(LmcRam), length, lmc_hal.bus.input);
+        goto ins_remains;
+    case INS:
+        if (lmc_hal.bus.program.data)
+        ins_program:
+            done = lmc_programRead(block, length);
+        else if (lmc_hal.bus.pipein || (lmc_hal.bus.data && lmc_hal.bus.data->binary))
+        ins_stream:
+            done = lmc_hal.bus.pipein
+                ? lmc_ringRead(lmc_hal.bus.pipein, block, length)
+                : lmc_streamRead(block, length);
+    ins_remains:
+        if (!lmc_hal.bus.program.data) {
+            lmc_traced(lmc_traceInput, block, done);
+            lmc_probe(bus__input, block, done);
+            lmc_metricsAdd(LMC_MINPUT, done);
+            lmc_hook(input, block, done);
+        }
+        // The remaining words (after EOF of a compiled program file,
+        // or for hexadecimal input) are read one by one, with the
+        // usual fallbacks, but prompted only once. A resumed session
+        // continues the block where it was suspended.
+        if (done < lmc_hal.bus.resume) done = lmc_hal.bus.resume;
+        for (; done < length && lmc_hal.on; ++done) {
+            lmc_hal.bus.resume = done;
+            lmc_busInput();
+            block[done] = lmc_hal.bus.buffer;
+            lmc_hal.bus.prompt = "";
+        }
+        lmc_hal.bus.prompt = prompt;
+        break;
+    case OUTS:
+        for (done = lmc_hal.bus.resume; done < length; ++done) {
+            lmc_hal.bus.resume = done;
+            lmc_busWord(block[done]);
+        }
+        break;
+    case OUTSB: lmc_busWrite(block, length), lmc_hook(output, block, length); break;
+    default: break;
+    }
+    lmc_hal.bus.resume = 0;
+}
+
+static void lmc_busWord(LmcRam value)
+{
+    if (lmc_hal.bus.pipeout) return lmc_busPipe(&value, 1), lmc_hook(output, &value, 1);
+    if (lmc_hal.bus.outbuf.size + LMC_MAXDIGITS > LMC_BUSBUF) lmc_busFlush();
+    if (lmc_hal.bus.session && lmc_hal.bus.outbuf.size + LMC_MAXDIGITS > LMC_BUSBUF) lmc_suspend(POLLOUT);
+    lmc_hex(&lmc_hal.bus.outbuf.data[lmc_hal.bus.outbuf.size], value);
+    lmc_hal.bus.outbuf.size += LMC_MAXDIGITS;
+    lmc_hook(output, &value, 1);
+}
+
+// clang-format off
+
+/******************************************************************************
+ * Operations
+ ******************************************************************************/
+// clang-format on
+
+static void lmc_opcalc(LmcRam operation)
+{
+    LmcRam opcode = 0;
+    switch (operation) {
+#ifdef _UCODES
+    case ADD:  opcode = ADDOPD; goto op_calc;
+    case SUB:  opcode = SUBOPD; goto op_calc;
+    case NAND: opcode = NANDOP; goto op_calc;
+    case ADC:  opcode = ADCOPD; goto op_calc;
+    case SBC:  opcode = SBCOPD; goto op_calc;
+    default:
+    op_calc:   lmc_ucode(opcode); break; // Opcode 0 does nothing
+#else
+    case ADD:  __attribute__((fallthrough));
+    case SUB:  __attribute__((fallthrough));
+    case ADC:  __attribute__((fallthrough));
+    case SBC:  __attribute__((fallthrough));
+    case NAND: opcode = operation;          goto op_calc;
+    default:   opcode = lmc_hal.alu.opcode; goto op_calc;
+    op_calc:   lmc_hal.alu.opcode = opcode; break;
+#endif
+    }
+}
+
+static void lmc_indirection(LmcRam type)
+{
+    // Fallthrough as the indirection operations are cumulative.
+    // The indexed variable is a variable whose address is offset by X.
+    switch (type) {
+#ifdef _UCODES
+    case IDX:   lmc_useries(SVTOWR, WRTOAD, ADTOSR, ADDXSR, NULL); goto ind_value;
+    case INDIR: lmc_useries(SVTOWR, WRTOAD, ADTOSR, NULL); __attribute__((fallthrough));
+    case VAR:   lmc_useries(SVTOWR, WRTOAD, ADTOSR, NULL); __attribute__((fallthrough));
+    default:
+    ind_value:  lmc_ucode(SVTOWR); break;
+#else
+    case IDX:
+        lmc_rwMemory(lmc_hal.mem.cache.sr, &lmc_hal.mem.cache.sr, 'r');
+        lmc_hal.mem.cache.sr += lmc_hal.cu.ix;
+        goto ind_value;
+    case INDIR: lmc_rwMemory(lmc_hal.mem.cache.sr, &lmc_hal.mem.cache.sr, 'r'); __attribute__((fallthrough));
+    case VAR:   lmc_rwMemory(lmc_hal.mem.cache.sr, &lmc_hal.mem.cache.sr, 'r'); __attribute__((fallthrough));
+    default:
+    ind_value:  lmc_rwMemory(lmc_hal.mem.cache.sr, &lmc_hal.mem.cache.wr, 'r'); break;
+#endif
+    }
+}
+
+static bool lmc_operation(LmcRam operation)
+{
+    LmcRam* value = NULL;
+    LmcRam address = 0;
+    switch (operation) {
+    case BRN:   if (!(lmc_hal.alu.acc & LMC_SIGN)) goto op_next; goto op_taken;
+    case BRZ:   if (lmc_hal.alu.acc != 0) goto op_next; goto op_taken;
+    case BRC:   if (!lmc_hal.alu.carry) goto op_next; goto op_taken;
+    op_next:    lmc_count(untaken, 1); break;
+    op_taken:   lmc_count(taken, 1); goto op_jump;
+    case ADD:   __attribute__((fallthrough));
+    case SUB:   __attribute__((fallthrough));
+    case ADC:   __attribute__((fallthrough));
+    case SBC:   __attribute__((fallthrough));
+#ifdef _UCODES
+    case NAND:  lmc_ucode(DOCALC); break;
+    case LOAD:  lmc_ucode(WRTOAC); break;
+    case OUT:   lmc_useries(SVTOWR, WRTOOU, NULL); break;
+    case IN:    lmc_useries(WINPUT, INTOWR, WRTOSV, NULL); break;
+    case STORE: lmc_useries(ACTOWR, WRTOSV, NULL); break;
+    case PUSH:  lmc_useries(ACTOWR, SPTOSR, WRTOSK, DECRSP, NULL); break;
+    case POP:   lmc_useries(INCRSP, SPTOSR, SKTOWR, WRTOAC, NULL); break;
+    case STACK: lmc_ucode(WRTOSL); break;
+    case COPY:  lmc_ucode(BLKCPY); break;
+    case CMP:   lmc_ucode(BLKCMP); break;
+    case FILL:  lmc_ucode(BLKSET); break;
+    case INS:   __attribute__((fallthrough));
+    case OUTS:  __attribute__((fallthrough));
+    case INSB:  __attribute__((fallthrough));
+    case OUTSB: lmc_ucode(BLKBUS); break;
+    case LDX:   lmc_ucode(WRTOIX); break;
+    case INX:   lmc_ucode(INCRIX); break;
+    case DEX:   lmc_ucode(DECRIX); break;
+    case CALL:
+        // The return address is the one following the CALL argument.
+        lmc_useries(WRTOAD, INCRPC, PCTOWR, SPTOSR, WRTOSK, DECRSP, ADTOPC, NULL);
+        return false;
+    case RET:   lmc_useries(INCRSP, SPTOSR, SKTOWR, WRTOPC, NULL); return false;
+    case JUMP:
+    op_jump:    lmc_ucode(WRTOPC); return false;
+    case HLT:   lmc_ucode(LMCHLT); return false;
+#else
+    case NAND:  lmc_calc(); break;
+    case LOAD:  lmc_hal.alu.acc = lmc_hal.mem.cache.wr; break;
+    case OUT:
+        lmc_rwMemory(lmc_hal.mem.cache.sr, &lmc_hal.mem.cache.wr, 'r');
+        lmc_busWord(lmc_hal.mem.cache.wr);
+        break;
+    case IN:
+        lmc_busInput();
+        lmc_rwMemory(lmc_hal.mem.cache.sr, &lmc_hal.bus.buffer, 'w');
+        break;
+    case STORE:
+        lmc_rwMemory(lmc_hal.mem.cache.sr, &lmc_hal.alu.acc, 'w');
+        break;
+    case PUSH:  lmc_rwMemory(lmc_hal.cu.sp--, &lmc_hal.alu.acc, 'p'); break;
+    case POP:   lmc_rwMemory(++lmc_hal.cu.sp, &lmc_hal.alu.acc, 'o'); break;
+    case STACK: lmc_setStack(lmc_hal.mem.cache.wr); break;
+    case COPY:  __attribute__((fallthrough));
+    case CMP:   __attribute__((fallthrough));
+    case FILL:  lmc_block(operation); break;
+    case INS:   __attribute__((fallthrough));
+    case OUTS:  __attribute__((fallthrough));
+    case INSB:  __attribute__((fallthrough));
+    case OUTSB: lmc_busBlock(operation); break;
+    case LDX:   lmc_hal.cu.ix = lmc_hal.mem.cache.wr; break;
+    case INX:   ++lmc_hal.cu.ix; break;
+    case DEX:   --lmc_hal.cu.ix; break;
+    case CALL:
+        // The return address is the one following the CALL argument.
+        address = lmc_hal.cu.pc + 1;
+        lmc_rwMemory(lmc_hal.cu.sp--, &address, 'p');
+        goto op_jump;
+    case RET:   lmc_rwMemory(++lmc_hal.cu.sp, &lmc_hal.cu.pc, 'o'); return false;
+    case JUMP:
+    op_jump:    lmc_hal.cu.pc = lmc_hal.mem.cache.wr; return false;
+    case HLT:   return (lmc_hal.on = false);
+#endif
+    // Debugging instructions
+    case DEBUG: return (lmc_hal.dbg.opcode = lmc_hal.mem.cache.wr);
+    case CONT:  lmc_hal.dbg.opcode = lmc_hal.mem.cache.wr; return false;
+    case NEXT:  break;
+    case BREAK: lmc_hal.dbg.brk = lmc_hal.mem.cache.wr; break;
+    case FREE:  lmc_hal.dbg.brk = 0; break;
+    case PRINT: lmc_hal.dbg.prt = lmc_hal.mem.cache.wr; break;
+    case CLEAR: lmc_hal.dbg.prt = 0; break;
+    case DUMP:
+        lmc_busInput();
+        lmc_dump(lmc_hal.mem.cache.wr, lmc_hal.bus.buffer);
+        break;
+    default:
+        // In case the macro _UCODES is undefined.
+        (void) value;
+        (void) address;
+        break;
+    }
+    return true;
+}
+
+static void lmc_rwMemory(LmcRam address, LmcRam* value, char mode)
+{
+    switch (mode) {
+    // LmcRam cannot have a value greater than the max size of RAM,
+    // thus it is not checked. This ensures to avoid a real SIGSEGV,
+    // but not a valid rw operation (due to overflow).
+    case 'r':
+        lmc_count(reads, 1), lmc_hook(read, address, 1);
+        *value = lmc_hal.mem.ram[address];
+        break;
+    // The stack pop ('o') and push ('p') modes are only valid inside
+    // the stack section, which is reserved for them.
+    case 'o':
+        if (!lmc_isStack(address)) return lmc_fault(address, "stack underflow");
+        lmc_count(reads, 1), lmc_hook(read, address, 1);
+        *value = lmc_hal.mem.ram[address];
+        break;
+    case 'p':
+        if (!lmc_isStack(address)) return lmc_fault(address, "stack overflow");
+        lmc_statsWrite(address, 1), lmc_traced(lmc_traceWrite, address, 1);
+        lmc_probe(mem__write, address, 1);
+        lmc_hook(write, address, 1);
+        lmc_hal.mem.ram[address] = *value;
+        break;
+    case 'w':
+        // Emulate a invalid write error. The ROM and the stack are
+        // outside of the writable section, thus checked at once.
+        if (__builtin_expect(address < LMC_MAXROM || address >= lmc_hal.mem.top, 0))
+            return address < LMC_MAXROM ? lmc_romFault(address) : lmc_fault(address, "stack only");
+        lmc_statsWrite(address, 1), lmc_traced(lmc_traceWrite, address, 1);
+        lmc_probe(mem__write, address, 1);
+        lmc_hook(write, address, 1);
+        lmc_hal.mem.ram[address] = *value;
+        break;
+    default: break;
+    }
+}
+
+static void lmc_block(LmcRam operation)
+{
+    LmcRam params[LMC_BLKMAX] = {0};
+    LmcRam *dst = NULL, *src = NULL;
+    int cmp = 0;
+
+    for (LmcRam i = 0; i < LMC_BLKMAX; ++i)
+        lmc_rwMemory(lmc_hal.mem.cache.wr + i, &params[i], 'r');
+
+    switch (operation) {
+    case COPY:
+        if ((dst = lmc_rwBlock(params[LMC_BLKDST], params[LMC_BLKLEN], 'w'))
+            && (src = lmc_rwBlock(params[LMC_BLKSRC], params[LMC_BLKLEN], 'r')))
+            memmove(dst, src, params[LMC_BLKLEN]);
+        break;
+    case CMP:
+        if ((dst = lmc_rwBlock(params[LMC_BLKDST], params[LMC_BLKLEN], 'r'))
+            && (src = lmc_rwBlock(params[LMC_BLKSRC], params[LMC_BLKLEN], 'r'))) {
+            cmp = memcmp(dst, src, params[LMC_BLKLEN]);
+            lmc_hal.alu.acc = (LmcRam)((cmp > 0) - (cmp < 0));
+        }
+        break;
+    case FILL:
+        if ((dst = lmc_rwBlock(params[LMC_BLKDST], params[LMC_BLKLEN], 'w')))
+            memset(dst, params[LMC_BLKSRC], params[LMC_BLKLEN]);
+        break;
+    default: break;
+    }
+}
+
+static LmcRam* lmc_rwBlock(unsigned int address, LmcRam length, char mode)
+{
+    // The checks are the same as lmc_rwMemory() ones, but done once
+    // for the whole section.
+    if (address + length > LMC_MAXRAM)
+        return lmc_fault(address, "out of bounds"), NULL;
+    else if (mode == 'w' && length && address < LMC_MAXROM)
+        return lmc_romFault(address), NULL;
+    else if (mode == 'w' && length && address + length > lmc_hal.mem.top)
+        return lmc_fault(address > lmc_hal.mem.top ? address : lmc_hal.mem.top, "stack only"), NULL;
+
+    if (mode == 'w') {
+        lmc_statsWrite(address, length), lmc_traced(lmc_traceWrite, address, length);
+        lmc_probe(mem__write, address, length);
+        lmc_hook(write, address, length);
+    }
+    else lmc_count(reads, length), lmc_hook(read, address, length);
+    return &lmc_hal.mem.ram[address];
+}
+
+#ifdef _UCODES
+
+// clang-format off
+
+/******************************************************************************
+ * Microcodes handling
+ ******************************************************************************/
+// clang-format on
+
+static void lmc_useries(unsigned int ucode, ...)
+{
+    va_list ucodes;
+    va_start(ucodes, ucode);
+    do { lmc_ucode((LmcUcodes)ucode); }
+    while ((ucode = va_arg(ucodes, unsigned int)) > 0);
+    va_end(ucodes);
+}
+
+static void lmc_ucode(LmcUcodes ucode)
+{
+    // Functions are used for WRTOOU, DOCALC, SVTOWR, WRTOSV, and
+    // WINPUT in order to:
+    //
+    // - allow the two versions (with and without _UCODES) to work
+    // - allow WINPUT to agnostically handle multiple input sources
+    // - implement ROM protection
+    // - distinguish between real SIGSEGV errors from the LMC programs
+    //   errors; this is not strictly necessary in production versions
+    //   of the LMC software, but greatly help during development
+
+    lmc_count(ucodes, 1);
+    switch (ucode) {
+    case PCTOSR: lmc_hal.mem.cache.sr = lmc_hal.cu.pc; break;
+    case WRTOPC: lmc_hal.cu.pc = lmc_hal.mem.cache.wr; break;
+    case WRTOAC: lmc_hal.alu.acc = lmc_hal.mem.cache.wr; break;
+    case ACTOWR: lmc_hal.mem.cache.wr = lmc_hal.alu.acc; break;
+    case WRTOOP: lmc_hal.alu.opcode = lmc_hal.mem.cache.wr; break;
+    case WRTOAD: lmc_hal.cu.ir.ad = lmc_hal.mem.cache.wr; break;
+    case ADTOSR: lmc_hal.mem.cache.sr = lmc_hal.cu.ir.ad; break;
+    case INTOWR: lmc_hal.mem.cache.wr = lmc_hal.bus.buffer; break;
+    case WRTOOU: lmc_busWord(lmc_hal.mem.cache.wr); break;
+    case ADDOPD: lmc_hal.alu.opcode = ADD; break;
+    case SUBOPD: lmc_hal.alu.opcode = SUB; break;
+    case DOCALC: lmc_calc(); break;
+    case SVTOWR: __attribute__((fallthrough));
+    case WRTOSV:
+        lmc_rwMemory(
+            lmc_hal.mem.cache.sr,
+            &lmc_hal.mem.cache.wr, ucode == SVTOWR ? 'r' : 'w'
+        );
+        break;
+    case INCRPC: ++lmc_hal.cu.pc; break;
+    case WINPUT: lmc_busInput(); break;
+    case NANDOP: lmc_hal.alu.opcode = NAND; break;
+    case ADCOPD: lmc_hal.alu.opcode = ADC; break;
+    case SBCOPD: lmc_hal.alu.opcode = SBC; break;
+    case LMCHLT: lmc_hal.on = false; break;
+    case SPTOSR: lmc_hal.mem.cache.sr = lmc_hal.cu.sp; break;
+    case INCRSP: ++lmc_hal.cu.sp; break;
+    case DECRSP: --lmc_hal.cu.sp; break;
+    case PCTOWR: lmc_hal.mem.cache.wr = lmc_hal.cu.pc; break;
+    case ADTOPC: lmc_hal.cu.pc = lmc_hal.cu.ir.ad; break;
+    case WRTOSK: __attribute__((fallthrough));
+    case SKTOWR:
+        lmc_rwMemory(
+            lmc_hal.mem.cache.sr,
+            &lmc_hal.mem.cache.wr, ucode == SKTOWR ? 'o' : 'p'
+        );
+        break;
+    case WRTOSL: lmc_setStack(lmc_hal.mem.cache.wr); break;
+    case BLKCPY: lmc_block(COPY); break;
+    case BLKCMP: lmc_block(CMP); break;
+    case BLKSET: lmc_block(FILL); break;
+    case BLKBUS: lmc_busBlock(lmc_hal.alu.opcode & ~(INDIR)); break;
+    case ADDXSR: lmc_hal.mem.cache.sr += lmc_hal.cu.ix; break;
+    case WRTOIX: lmc_hal.cu.ix = lmc_hal.mem.cache.wr; break;
+    case INCRIX: ++lmc_hal.cu.ix; break;
+    case DECRIX: --lmc_hal.cu.ix; break;
+    default: break;
+    }
+}
+
+#endif // _UCODES
+
+#undef lmc_run
+#undef lmc_slice
+#undef lmc_debug
+#undef lmc_dbg_phaseOne
+#undef lmc_dbg_phaseTwo
+#undef lmc_dbg_phaseThree
+#undef lmc_phaseOne
+#undef lmc_phaseTwo
+#undef lmc_phaseThree
+#undef lmc_busInput
+#undef lmc_busBlock
+#undef lmc_busWord
+#undef lmc_opcalc
+#undef lmc_indirection
+#undef lmc_operation
+#undef lmc_rwMemory
+#undef lmc_block
+#undef lmc_rwBlock
+#undef lmc_useries
+#undef lmc_ucode
+
+/** @} */
@@ -0,0 +1,283 @@
+/**
+ * @file      daemon.c
+ * @version   0.1.0
+ * @brief     LMC execution daemon module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup DaemonInternals
+ * @{
+ */
+
+#include "lmc/daemon.h"
+
+/**
+ * @enum LmcDaemonCaracs
+ * @since 0.1.0
+ * @brief The daemon characteristics.
+ */
+typedef enum LmcDaemonCaracs {
+    LMC_MAXEVENTS = 64,         /**< Max events handled per epoll_wait(2) call. */
+    LMC_DAEMONLIMIT = 1 << 24,  /**< Default max number of instructions
+                                 * of each program. */
+    LMC_ACCEPTDELAY = 100000000, /**< Delay before accepting again when
+                                  * out of resources (ns). */
+} LmcDaemonCaracs;
+
+/**
+ * @struct LmcWorker
+ * @since 0.1.0
+ * @brief A daemon worker.
+ */
+typedef struct LmcWorker {
+    int epoll;        /**< The worker epoll(7) instance. */
+    pthread_t thread; /**< The worker thread. */
+} LmcWorker;
+
+/**
+ * @struct LmcChild
+ * @since 0.1.0
+ * @brief A daemon worker process.
+ */
+typedef struct LmcChild {
+    pid_t pid;    /**< The process identifier. */
+    time_t start; /**< The process start time. */
+} LmcChild;
+
+/**
+ * @since 0.1.0
+ * @brief Accept the connections and run their sessions.
+ * @param listener The listening socket.
+ * @param path The socket path, for the error messages.
+ * @param bootstrap The compiled bootstrap file path.
+ * @param workers The number of worker threads, @c 0 for one per
+ * online processor.
+ * @param limit The max number of instructions of each program.
+ * @return non-null in case of errors.
+ */
+static int lmc_serve(int listener, const char* restrict path, const char* restrict bootstrap, size_t workers, size_t limit);
+
+/**
+ * @since 0.1.0
+ * @brief Run worker processes sharing the listening socket, and
+ * restart them when they stop.
+ * @param listener The listening socket.
+ * @param path The socket path, for the error messages.
+ * @param bootstrap The compiled bootstrap file path.
+ * @param processes The number of worker processes.
+ * @param workers The number of worker threads per process.
+ * @param limit The max number of instructions of each program.
+ * @return non-null in case of errors.
+ */
+static int lmc_supervise(int listener, const char* restrict path, const char* restrict bootstrap, size_t processes, size_t workers, size_t limit);
+
+/**
+ * @since 0.1.0
+ * @brief Fork a worker process running lmc_serve().
+ *
+ * This function may raise a fatal error if the process cannot be
+ * started.
+ *
+ * @param child The worker process destination.
+ * @param listener,path,bootstrap,workers,limit See lmc_serve().
+ */
+static void lmc_fork(LmcChild* child, int listener, const char* restrict path, const char* restrict bootstrap, size_t workers, size_t limit)
+    __attribute__((nonnull (1)));
+
+/**
+ * @since 0.1.0
+ * @brief Resume the sessions of a worker when their connection is
+ * ready, and close them once stopped.
+ * @param worker The worker (a #LmcWorker).
+ * @return @c NULL.
+ */
+static void* lmc_worker(void* worker) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Wait for the next events of a session in an epoll(7)
+ * instance.
+ * @param epoll The epoll(7) instance.
+ * @param session The session.
+ * @param operation The epoll_ctl(2) operation.
+ * @return non-null in case of errors, otherwise @c 0.
+ */
+static int lmc_watch(int epoll, LmcSession* session, int operation) __attribute__((nonnull));
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * Implementation
+ ******************************************************************************/
+// clang-format on
+
+int lmc_daemon(const char* restrict path, const char* restrict bootstrap, size_t processes, size_t workers, size_t limit)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX, };
+    int listener = -1;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        err(EXIT_FAILURE, "%s", path);
+    }
+    strcpy(address.sun_path, path);
+    // A program looping forever would otherwise hold its connection,
+    // and its share of a worker, until the client leaves.
+    limit = limit ? limit : LMC_DAEMONLIMIT;
+    unlink(path);
+    if ((listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0
+        || bind(listener, (struct sockaddr*)&address, sizeof(address))
+        || listen(listener, SOMAXCONN))
+        err(EXIT_FAILURE, "%s", path);
+
+    // The clients leaving early must not kill the daemon.
+    signal(SIGPIPE, SIG_IGN);
+    // The bootstrap errors are raised once, here, and the forked
+    // workers share the loaded bootstrap.
+    if (bootstrap) lmc_preload(bootstrap);
+
+    return processes
+        ? lmc_supervise(listener, path, bootstrap, processes, workers, limit)
+        : lmc_serve(listener, path, bootstrap, workers, limit);
+}
+
+static int lmc_supervise(int listener, const char* restrict path, const char* restrict bootstrap, size_t processes, size_t workers, size_t limit)
+{
+    LmcChild* children = calloc(processes, sizeof(LmcChild));
+    pid_t pid = 0;
+    int status = 0;
+
+    if (!children) err(EXIT_FAILURE, "could not allocate the workers");
+    for (size_t i = 0; i < processes; ++i)
+        lmc_fork(&children[i], listener, path, bootstrap, workers, limit);
+
+    for (;;) {
+        if ((pid = wait(&status)) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (size_t i = 0; i < processes; ++i) {
+            if (children[i].pid != pid) continue;
+            warnx(
+                "worker %i stopped (%s %i), restarting", pid,
+                WIFSIGNALED(status) ? "signal" : "status",
+                WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status)
+            );
+            // A worker stopping right away would otherwise be
+            // restarted in a loop.
+            if (time(NULL) - children[i].start < 1) sleep(1);
+            lmc_fork(&children[i], listener, path, bootstrap, workers, limit);
+        }
+    }
+
+    warn("could not wait for the workers");
+    free(children);
+    close(listener);
+    return EXIT_FAILURE;
+}
+
+static void lmc_fork(LmcChild* child, int listener, const char* restrict path, const char* restrict bootstrap, size_t workers, size_t limit)
+{
+    pid_t supervisor = getpid();
+
+    if ((child->pid = fork()) < 0) err(EXIT_FAILURE, "could not start a worker");
+    if (!child->pid) {
+        // The workers are stopped with their supervisor.
+        if (prctl(PR_SET_PDEATHSIG, SIGTERM) || getppid() != supervisor)
+            exit(EXIT_FAILURE);
+        exit(lmc_serve(listener, path, bootstrap, workers, limit));
+    }
+    child->start = time(NULL);
+}
+
+static int lmc_serve(int listener, const char* restrict path, const char* restrict bootstrap, size_t workers, size_t limit)
+{
+    LmcSession* session = NULL;
+    LmcWorker* pool = NULL;
+    struct timespec delay = { .tv_nsec = LMC_ACCEPTDELAY, };
+    int client = -1;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    workers = workers ? workers : cpus > 0 ? (size_t)cpus : 1;
+    if (!(pool = calloc(workers, sizeof(LmcWorker))))
+        err(EXIT_FAILURE, "could not allocate the workers");
+    for (size_t i = 0; i < workers; ++i)
+        if ((pool[i].epoll = epoll_create1(EPOLL_CLOEXEC)) < 0
+            || (errno = pthread_create(&pool[i].thread, NULL, lmc_worker, &pool[i])))
+            err(EXIT_FAILURE, "could not start the workers");
+
+    // The connections are distributed between the workers in turn,
+    // and each one is then only handled by its worker.
+    for (size_t next = 0;; next = (next + 1) % workers) {
+        if ((client = accept(listener, NULL, NULL)) < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            // The pending connections are accepted once the
+            // resources of the closed ones are released.
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                warn("could not accept a connection, retrying");
+                nanosleep(&delay, NULL);
+                continue;
+            }
+            break;
+        }
+        session = lmc_sessionOpen(bootstrap, NULL, client, client);
+        session->vm.bus.prompt = "";
+        session->header = true;
+        session->image  = 2;
+        session->limit  = limit;
+        session->report = true;
+        // A new connection is writable, thus the session starts
+        // right away.
+        session->events = POLLOUT;
+        if (lmc_watch(pool[next].epoll, session, EPOLL_CTL_ADD)) {
+            warn("could not watch the connection");
+            close(client);
+            lmc_sessionClose(session);
+        }
+    }
+
+    warn("%s", path);
+    close(listener);
+    return EXIT_FAILURE;
+}
+
+static void* lmc_worker(void* worker)
+{
+    LmcWorker* self = worker;
+    struct epoll_event events[LMC_MAXEVENTS];
+    LmcSession* session = NULL;
+    int count = 0;
+
+    for (;;) {
+        if ((count = epoll_wait(self->epoll, events, LMC_MAXEVENTS, -1)) < 0) {
+            if (errno == EINTR) continue;
+            err(EXIT_FAILURE, "could not wait for the sessions");
+        }
+        for (int i = 0; i < count; ++i) {
+            session = events[i].data.ptr;
+            if (lmc_sessionResume(session) && !lmc_watch(self->epoll, session, EPOLL_CTL_MOD))
+                continue;
+            // Closing the connection also removes it from the epoll
+            // instance.
+            close(session->in);
+            lmc_sessionClose(session);
+        }
+    }
+    return NULL;
+}
+
+static int lmc_watch(int epoll, LmcSession* session, int operation)
+{
+    // The one-shot events are re-armed after each resume, as the
+    // awaited events change.
+    struct epoll_event event = {
+        .events = EPOLLONESHOT
+                | (session->events & POLLIN ? EPOLLIN : 0)
+                | (session->events & POLLOUT ? EPOLLOUT : 0),
+        .data.ptr = session,
+    };
+    return epoll_ctl(epoll, operation, session->in, &event);
+}
@@ -0,0 +1,128 @@
+/**
+ * @file      error.c
+ * @version   0.1.0
+ * @brief     LMC errors reporting module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup ErrorInternals
+ * @{
+ */
+
+#include "lmc/error.h"
+
+/**
+ * @var lmc_catcher
+ * @since 0.1.0
+ * @brief The catching function of the thread, set by lmc_catch().
+ */
+static __thread struct {
+    jmp_buf* handler; /**< Its jump buffer, or @c NULL if none. */
+    LmcError* error;  /**< Its messages destination. */
+} lmc_catcher;
+
+/**
+ * @since 0.1.0
+ * @brief Record a message for the catching function.
+ * @param code The errno(3) value of the message.
+ * @param describe Append the description of @p code.
+ * @param format The message printf(3) format, or @c NULL.
+ * @param args The format arguments.
+ */
+static void lmc_record(int code, bool describe, const char* restrict format, va_list args);
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * Implementation
+ ******************************************************************************/
+// clang-format on
+
+void lmc_catch(jmp_buf* handler, LmcError* error)
+{
+    lmc_catcher.handler = handler;
+    lmc_catcher.error   = handler ? error : NULL;
+    if (lmc_catcher.error) *lmc_catcher.error = (LmcError){ 0 };
+}
+
+void lmc_warn(const char* restrict format, ...)
+{
+    int code = errno;
+    va_list args;
+
+    va_start(args, format);
+    if (lmc_catcher.handler) lmc_record(code, true, format, args);
+    else vwarn(format, args);
+    va_end(args);
+}
+
+void lmc_warnx(const char* restrict format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    if (lmc_catcher.handler) lmc_record(0, false, format, args);
+    else vwarnx(format, args);
+    va_end(args);
+}
+
+void lmc_notice(const char* restrict format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    if (lmc_catcher.handler) lmc_record(0, false, format, args);
+    else vfprintf(stderr, format, args), fputc('\n', stderr);
+    va_end(args);
+}
+
+void lmc_err(const char* restrict format, ...)
+{
+    int code = errno;
+    va_list args;
+
+    va_start(args, format);
+    if (!lmc_catcher.handler) verr(EXIT_FAILURE, format, args);
+    lmc_record(code, true, format, args);
+    va_end(args);
+    lmc_exit();
+}
+
+void lmc_errx(const char* restrict format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    if (!lmc_catcher.handler) verrx(EXIT_FAILURE, format, args);
+    lmc_record(0, false, format, args);
+    va_end(args);
+    lmc_exit();
+}
+
+void lmc_exit(void)
+{
+    jmp_buf* handler = lmc_catcher.handler;
+
+    if (!handler) exit(EXIT_FAILURE);
+    // The catching function is done with the errors once back.
+    lmc_catcher.handler = NULL, lmc_catcher.error = NULL;
+    longjmp(*handler, 1);
+}
+
+static void lmc_record(int code, bool describe, const char* restrict format, va_list args)
+{
+    LmcError* error = lmc_catcher.error;
+    int size = 0;
+
+    if (!error) return;
+    error->code = code;
+    *error->message = '\0';
+    if (format && (size = vsnprintf(error->message, LMC_MAXERROR, format, args)) < 0) size = 0;
+    if (describe && size < LMC_MAXERROR)
+        snprintf(&error->message[size], LMC_MAXERROR - size, "%s%s", format ? ": " : "", strerror(code));
+}
+
+/** @} */
@@ -69,6 +69,17 @@ const char* lmc_keyword(LmcOpCodes opcode)
     }
 }
 
+char* lmc_opname(char* restrict dest, LmcRam opcode)
+{
+    const char* operation = lmc_keyword(opcode & ~(INDIR));
+    LmcRam value = opcode & INDIR;
+
+    if (*operation) sprintf(dest, "%s", operation);
+    else sprintf(dest, LMC_HEXFMT, LMC_MAXDIGITS, opcode & ~(INDIR));
+    if (value) sprintf(&dest[strlen(dest)], " %s", lmc_keyword(value));
+    return dest;
+}
+
 static void lmc_hcreate(void)
 {
     int status      = 0;
@@ -76,7 +87,7 @@ static void lmc_hcreate(void)
 
     // The whole program does not need more than one hash table.
     if (!(status = hcreate(LMC_MAXRAM)) && errno)
-        err(EXIT_FAILURE, "could not create hash table");
+        lmc_err("could not create hash table");
     else if (!status && !errno) return;
 
     for (size_t i = 0; i < LMC_MAXRAM; ++i)
@@ -85,7 +96,7 @@ static void lmc_hcreate(void)
             // as an example in the hsearch manual.
             entry.data = (void*)i;
             if (!hsearch(entry, ENTER))
-                err(EXIT_FAILURE, "could not add '%s' item in hash table", entry.key);
+                lmc_err("could not add '%s' item in hash table", entry.key);
         }
 }
 
@@ -95,7 +106,7 @@ LmcOpCodes lmc_opcode(char* keyword)
     ENTRY* retval = NULL;
     LmcOpCodes value = 0;
     if (*keyword && !(retval = hsearch(entry, FIND)))
-        err(EXIT_FAILURE, "unknown item '%s'", keyword);
+        lmc_err("unknown item '%s'", keyword);
     else if (retval)
         // use size_t for void* size compatibility. The implicit cast
         // handles the truncation. No sign issue is expected as the
@@ -120,7 +131,7 @@ void lmc_append(LmcRamArray* array, LmcRam code, LmcRam value)
 {
     if (array->current >= array->max-1) {
         errno = ENOMEM;
-        err(EXIT_FAILURE,
+        lmc_err(
             "memory array size insufficient at (" LMC_HEXFMT "," LMC_HEXFMT ")",
             LMC_MAXDIGITS, code,
             LMC_MAXDIGITS, value);
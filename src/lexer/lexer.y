@@ -75,6 +75,6 @@ arg:
 
 int yyerror(LmcLexer* lexer, const char* restrict msg)
 {
-    fprintf(stderr, "%s: %s at line %i: '%s'\n", lexer->desc, msg, yylineno, yytext);
+    lmc_notice("%s: %s at line %i: '%s'", lexer->desc, msg, yylineno, yytext);
     return EXIT_FAILURE;
 }
@@ -0,0 +1,54 @@
+/**
+ * @file      library.c
+ * @version   0.1.0
+ * @brief     LMC embedding module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup LibraryInternals
+ * @{
+ */
+
+#include "lmc/library.h"
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * Implementation
+ ******************************************************************************/
+// clang-format on
+
+int lmc_libRun(const LmcRun* run, LmcRam* status, LmcError* error)
+{
+    jmp_buf handler;
+
+    // The error may be raised during the execution, thus after its
+    // statistics and trace are started.
+    if (setjmp(handler)) return lmc_abort(), -1;
+    lmc_catch(&handler, error);
+    *status = lmc_execute(run->bootstrap, run->program, run->size, &run->io, run->limit);
+    lmc_catch(NULL, NULL);
+    return 0;
+}
+
+int lmc_libCompile(const char* restrict source, const char* restrict dest, LmcError* error)
+{
+    jmp_buf handler;
+    int status = 0;
+
+    // The compiler leaves its source open on fatal errors.
+    if (setjmp(handler)) {
+        if (yyin) fclose(yyin), yyin = NULL;
+        return -1;
+    }
+    lmc_catch(&handler, error);
+    // The default destination is given to avoid the compiler notice.
+    status = lmc_compile(source, dest ? dest : LMC_BIN);
+    lmc_catch(NULL, NULL);
+    return status ? -1 : 0;
+}
+
+/** @} */
@@ -34,6 +34,34 @@ typedef struct LmcArguments {
     const char* bootstrap; /**< Compiled bootstrap file path. */
     bool debug;   /**< Option flag to use the debugger (@c true) or
                    * not (@c false). */
+    const char* input; /**< Programs data file path, @c "-" for the
+                        * standard input. */
+    bool raw;     /**< Option flag to read LmcArguments::input as raw
+                   * bytes (@c true) or hexadecimal words (@c false). */
+    bool pipe;    /**< Option flag to execute the programs as a
+                   * pipeline (@c true) or sequentially (@c false). */
+    const char* socket; /**< The daemon socket path. */
+    size_t jobs;  /**< The daemon number of workers. */
+    size_t limit; /**< The daemon and batch max number of instructions
+                   * per program. */
+    bool batch;   /**< Option flag to execute the programs in parallel
+                   * (@c true) or sequentially (@c false). */
+    const char* manifest; /**< The batch manifest file path. */
+    bool pinned;  /**< Option flag to pin the batch workers. */
+    size_t processes; /**< The daemon and batch number of worker
+                       * processes, @c 0 to run the workers in this
+                       * process. */
+    size_t shard; /**< The batch number of jobs per shard. */
+    bool worker;  /**< Option flag to run the shards read on the
+                   * standard input. */
+    LmcArchive* archive; /**< The archive searched for the programs. */
+    const char* pack;    /**< The archive to create from the
+                          * programs. */
+    const char* unpack;  /**< The archive to extract. */
+    const char* replay;  /**< The trace to replay. */
+    char replayed[PATH_MAX]; /**< The program of LmcArguments::replay. */
+    const char* print;   /**< The trace to print. */
+    const char* trace;   /**< The traces path. */
 } LmcArguments;
 
 /**
@@ -54,6 +82,27 @@ typedef enum LmcOptions {
     COMPILEOPT = 'c', /**< Compile a source file instead of running the LMC. */
     DEBUGONOPT = 'd', /**< Turn on the debugger. */
     BOOTSTPOPT = 'b', /**< Use a custom bootstrap. */
+    DATAINOPT  = 'i', /**< Read the programs data from a file. */
+    RAWDATOPT  = 'r', /**< Read the programs data as raw bytes. */
+    PIPELNOPT  = 'p', /**< Execute the programs as a pipeline. */
+    DAEMONOPT  = 'D', /**< Execute the programs sent on a socket. */
+    WORKEROPT  = 'j', /**< Number of daemon workers. */
+    LIMITSOPT  = 'l', /**< Max number of instructions per daemon or batch program. */
+    BATCHSOPT  = 'B', /**< Execute the programs in parallel. */
+    MANIFSOPT  = 'm', /**< Execute the programs of a manifest in parallel. */
+    PINNEDOPT  = 'P', /**< Pin the batch workers. */
+    PROCESSOPT = 'n', /**< Number of daemon or batch worker processes. */
+    SHARDSOPT  = 's', /**< Number of jobs per batch shard. */
+    WORKERSOPT = 'W', /**< Run the shards read on the standard input. */
+    ARCHIVEOPT = 'a', /**< Search the programs in an archive. */
+    PACKAGOPT  = 'k', /**< Store the programs in an archive. */
+    UNPACKOPT  = 'u', /**< Extract the programs of an archive. */
+    STATISOPT  = 'S', /**< Report the programs execution statistics. */
+    PROFILOPT  = 'f', /**< Write the programs execution profiles. */
+    TRACESOPT  = 't', /**< Write the programs execution traces. */
+    REPLAYOPT  = 'R', /**< Replay the input of a trace. */
+    PRINTTOPT  = 'T', /**< Print a trace as text. */
+    METRICSOPT = 'M', /**< Export the live metrics. */
     MAXOPT = 0xff,    /**< Max value of options. */
 } LmcOptions;
 
@@ -103,6 +152,29 @@ static LmcDoc lmc_doc = {
         { .name = "compile", .group = 1, .arg = "SOURCE", .key = COMPILEOPT, .doc = "Compile SOURCE to FILE" },
         { .name = "debug",   .group = 1, .arg = NULL,     .key = DEBUGONOPT, .doc = "Use the debugger" },
         { .name = "bootstrap", .group = 1, .arg = "BOOTFILE", .key = BOOTSTPOPT, .doc = "Use a custom compiled bootstrap stored in BOOTFILE" },
+        { .name = "trace",   .group = 1, .arg = "FILE",   .key = TRACESOPT, .doc = "Write the programs execution traces in FILE (then FILE.2, FILE.3...)" },
+        { .name = "metrics", .group = 1, .arg = "FILE",   .key = METRICSOPT, .doc = "Write the live metrics in FILE, in the Prometheus text format, every 10 seconds and on SIGUSR1" },
+        { .name = "print-trace", .group = 1, .arg = "TRACE", .key = PRINTTOPT, .doc = "Print TRACE as text" },
+#ifdef _STATS
+        { .name = "stats",   .group = 1, .arg = "FORMAT", .key = STATISOPT, .flags = OPTION_ARG_OPTIONAL, .doc = "Report the programs execution statistics on stderr as FORMAT (text, the default, or json)" },
+        { .name = "profile", .group = 1, .arg = "FILE",   .key = PROFILOPT, .doc = "Write the programs execution profiles in FILE (then FILE.2, FILE.3...) in the callgrind format" },
+#endif
+        { .name = "input",   .group = 2, .arg = "DATAFILE", .key = DATAINOPT, .doc = "Read the programs data from DATAFILE ('-' for stdin) instead of prompting" },
+        { .name = "replay",  .group = 2, .arg = "TRACE",  .key = REPLAYOPT, .doc = "Read the programs data from TRACE, and run its program if no FILE is given" },
+        { .name = "raw",     .group = 2, .arg = NULL,     .key = RAWDATOPT, .doc = "Read DATAFILE as raw bytes instead of hexadecimal words" },
+        { .name = "pipe",    .group = 2, .arg = NULL,     .key = PIPELNOPT, .doc = "Run the programs concurrently, each one reading the output of the previous one" },
+        { .name = "daemon",  .group = 3, .arg = "SOCKET", .key = DAEMONOPT, .doc = "Run the programs sent on the SOCKET Unix domain socket" },
+        { .name = "batch",   .group = 3, .arg = NULL,     .key = BATCHSOPT, .doc = "Run the programs in parallel and print their results as JSON lines" },
+        { .name = "manifest", .group = 3, .arg = "MANIFEST", .key = MANIFSOPT, .doc = "Run the programs listed in MANIFEST ('-' for stdin) in batch" },
+        { .name = "pin",     .group = 3, .arg = NULL,     .key = PINNEDOPT, .doc = "Pin each batch worker to a processor" },
+        { .name = "processes", .group = 3, .arg = "N",    .key = PROCESSOPT, .doc = "Run the daemon or the batch shards in N worker processes" },
+        { .name = "shard",   .group = 3, .arg = "SIZE",   .key = SHARDSOPT, .doc = "Send SIZE jobs per shard (defaults to 64)" },
+        { .name = "worker",  .group = 3, .arg = NULL,     .key = WORKERSOPT, .doc = "Run the batch shards read on stdin" },
+        { .name = "jobs",    .group = 3, .arg = "N",      .key = WORKEROPT, .doc = "Use N daemon or batch workers (defaults to the number of processors)" },
+        { .name = "limit",   .group = 3, .arg = "STEPS",  .key = LIMITSOPT, .doc = "Stop the daemon or batch programs after STEPS instructions (16777216 by default for the daemon)" },
+        { .name = "archive", .group = 4, .arg = "ARCHIVE", .key = ARCHIVEOPT, .doc = "Look the programs up in ARCHIVE first (a batch without FILE runs all of them)" },
+        { .name = "pack",    .group = 4, .arg = "ARCHIVE", .key = PACKAGOPT, .doc = "Store the compiled FILEs in ARCHIVE" },
+        { .name = "unpack",  .group = 4, .arg = "ARCHIVE", .key = UNPACKOPT, .doc = "Extract the programs of ARCHIVE in the FILE directory (defaults to the current one)" },
         { .name = NULL, .group = 0, .arg = NULL, .key = 0, .doc = NULL },
     },
     .help =
@@ -140,6 +212,26 @@ static error_t lmc_parseOpts(int key, char* arg, struct argp_state* state);
  */
 static void lmc_increaseFilesList(void);
 
+/**
+ * @since 0.1.0
+ * @brief Execute the LmcArguments::manifest jobs, then the
+ * LmcArguments::files programs, in batch.
+ * @return The lmc_batch() or lmc_coordinate() status.
+ */
+static int lmc_runBatch(void);
+
+/**
+ * @since 0.1.0
+ * @brief Copy the standard input in a temporary file, which each
+ * batch job opens on its own.
+ *
+ * This function exits with an error if the copy fails.
+ *
+ * @param path The temporary file path destination, of #PATH_MAX
+ * bytes, to unlink once the jobs are done.
+ */
+static void lmc_spool(char* restrict path) __attribute__((nonnull));
+
 // clang-format off
 
 /******************************************************************************
@@ -179,9 +271,41 @@ int main(int argc, char** argv)
     if (cmdargs.source)
         return lmc_compile(cmdargs.source, *cmdargs.files);
 
+    if (cmdargs.pack)
+        return lmc_pack(cmdargs.pack, cmdargs.cur + 1, cmdargs.files);
+    if (cmdargs.unpack)
+        return lmc_unpack(cmdargs.unpack, cmdargs.files ? *cmdargs.files : ".");
+    if (cmdargs.print)
+        return lmc_tracePrint(cmdargs.print, stdout);
+    lmc_setArchive(cmdargs.archive);
+
+    if (cmdargs.socket)
+        return lmc_daemon(cmdargs.socket, cmdargs.bootstrap, cmdargs.processes, cmdargs.jobs, cmdargs.limit);
+
+    if (cmdargs.worker)
+        return lmc_shardWorker(cmdargs.bootstrap, cmdargs.jobs, cmdargs.limit, cmdargs.pinned);
+    if (cmdargs.batch || cmdargs.manifest || cmdargs.processes)
+        return lmc_runBatch();
+
+    lmc_setData(cmdargs.input, cmdargs.raw);
+    if (cmdargs.replay) {
+        lmc_setReplay(cmdargs.replay, cmdargs.replayed);
+        // The traced program is replayed by default.
+        if (cmdargs.cur + 1 == 0 && *cmdargs.replayed) {
+            lmc_increaseFilesList();
+            cmdargs.files[++cmdargs.cur] = cmdargs.replayed;
+        }
+    }
+    if (cmdargs.pipe)
+        return lmc_pipeline(cmdargs.bootstrap, cmdargs.cur + 1, cmdargs.files);
+
     LmcExec execfunc = cmdargs.debug ? lmc_shell : lmc_dbgShell;
-    for (size_t i = 0; i < cmdargs.max && i <= cmdargs.cur && !status; ++i)
-        status = execfunc(cmdargs.bootstrap, cmdargs.files[i]);
+    size_t i = 0;
+    lmc_metricsQueue(cmdargs.cur + 1);
+    for (; i < cmdargs.max && i <= cmdargs.cur && !status; ++i)
+        lmc_metricsQueue(-1), status = execfunc(cmdargs.bootstrap, cmdargs.files[i]);
+    // The programs following a failure are not run.
+    lmc_metricsQueue((long)i - (long)(cmdargs.cur + 1));
 
     // The status code is the last returned value of the programs,
     // thus the status of the last executed program. The
@@ -197,13 +321,47 @@ static error_t lmc_parseOpts(int key, char* arg, struct argp_state* state)
     case VERSIONOPT: puts(LMC_VERSION); exit(EXIT_SUCCESS);
     case LICENSEOPT: puts(LMC_LICENSE); exit(EXIT_SUCCESS);
     case ARGP_KEY_ARG:
-        if (cmdargs.cur >= cmdargs.max) lmc_increaseFilesList();
+        if (cmdargs.cur + 1 >= cmdargs.max) lmc_increaseFilesList();
         cmdargs.files[++cmdargs.cur] = arg;
         break;
     case COMPILEOPT: cmdargs.source = arg; break;
     case DEBUGONOPT: cmdargs.debug = true; break;
     case BOOTSTPOPT: cmdargs.bootstrap = arg; break;
-    case ARGP_KEY_END: break;
+    case DATAINOPT: cmdargs.input = arg; break;
+    case RAWDATOPT: cmdargs.raw = true; break;
+    case PIPELNOPT: cmdargs.pipe = true; break;
+    case DAEMONOPT: cmdargs.socket = arg; break;
+    case WORKEROPT: cmdargs.jobs = strtoul(arg, NULL, 0); break;
+    case LIMITSOPT: cmdargs.limit = strtoul(arg, NULL, 0); break;
+    case BATCHSOPT: cmdargs.batch = true; break;
+    case MANIFSOPT: cmdargs.manifest = arg; break;
+    case PINNEDOPT: cmdargs.pinned = true; break;
+    case PROCESSOPT: cmdargs.processes = strtoul(arg, NULL, 0); break;
+    case SHARDSOPT: cmdargs.shard = strtoul(arg, NULL, 0); break;
+    case WORKERSOPT: cmdargs.worker = true; break;
+    case ARCHIVEOPT:
+        lmc_archiveClose(cmdargs.archive);
+        cmdargs.archive = lmc_archiveOpen(arg);
+        break;
+    case PACKAGOPT: cmdargs.pack = arg; break;
+    case UNPACKOPT: cmdargs.unpack = arg; break;
+    case TRACESOPT: lmc_setTrace(cmdargs.trace = arg); break;
+    case REPLAYOPT: cmdargs.replay = arg; break;
+    case PRINTTOPT: cmdargs.print = arg; break;
+    case METRICSOPT: lmc_metricsStart(arg, LMC_METRICSDELAY); break;
+#ifdef _STATS
+    case STATISOPT:
+        if (arg && strcmp(arg, "text") && strcmp(arg, "json"))
+            argp_error(state, "invalid statistics format '%s'", arg);
+        lmc_setStats(arg && !strcmp(arg, "json") ? LMC_STATSJSON : LMC_STATSTEXT);
+        break;
+    case PROFILOPT: lmc_setProfile(arg); break;
+#endif
+    case ARGP_KEY_END:
+        // The sessions are not traced.
+        if (cmdargs.trace && (cmdargs.socket || cmdargs.worker || cmdargs.batch || cmdargs.manifest || cmdargs.processes))
+            argp_error(state, "the batch and daemon programs cannot be traced");
+        break;
     default: return ARGP_ERR_UNKNOWN;
     }
     return 0;
@@ -220,4 +378,61 @@ static void lmc_increaseFilesList(void)
     cmdargs.max = newsize;
 }
 
-static void lmc_cleanup(void) { free(cmdargs.files); }
+static int lmc_runBatch(void)
+{
+    size_t listed = 0, count = 0;
+    LmcJob* jobs = cmdargs.manifest ? lmc_manifest(cmdargs.manifest, &listed) : NULL;
+    // Each job opens its own input, thus the standard input is read
+    // once in a file, which the jobs read from its start.
+    char spooled[PATH_MAX] = { 0 };
+    const char* input = cmdargs.input;
+    // Without programs, all the archive entries are run.
+    bool archived = cmdargs.archive && !cmdargs.manifest && cmdargs.cur + 1 == 0;
+    int status = EXIT_SUCCESS;
+
+    if (input && !strcmp(input, "-")) lmc_spool(spooled), input = spooled;
+    count = archived ? cmdargs.archive->count : listed + cmdargs.cur + 1;
+    if (!(jobs = reallocarray(jobs, count ? count : 1, sizeof(LmcJob))))
+        err(EXIT_FAILURE, "could not allocate for the jobs");
+    for (size_t i = listed; i < count; ++i)
+        jobs[i] = (LmcJob){
+            .program = archived ? lmc_archiveName(cmdargs.archive, i) : cmdargs.files[i - listed],
+            .input = input,
+        };
+
+    status = cmdargs.processes
+        ? lmc_coordinate(cmdargs.bootstrap, jobs, count, cmdargs.processes, cmdargs.shard, cmdargs.jobs, cmdargs.limit)
+        : lmc_batch(cmdargs.bootstrap, jobs, count, cmdargs.jobs, cmdargs.limit, cmdargs.pinned);
+    // Only the manifest jobs paths are allocated.
+    lmc_manifestFree(jobs, listed);
+    if (*spooled) unlink(spooled);
+    return status;
+}
+
+static void lmc_spool(char* restrict path)
+{
+    const char* tmpdir = getenv("TMPDIR");
+    char buffer[BUFSIZ];
+    ssize_t size = 0;
+    int fd = -1, error = 0;
+
+    snprintf(path, PATH_MAX, "%s/lmc-input.XXXXXX", tmpdir && *tmpdir ? tmpdir : P_tmpdir);
+    if ((fd = mkstemp(path)) < 0) err(EXIT_FAILURE, "could not copy the standard input");
+    while ((size = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0)
+        if (write(fd, buffer, size) != size) { size = -1; break; }
+    if (size < 0 || close(fd)) {
+        error = errno ? errno : EIO;
+        unlink(path);
+        errno = error;
+        err(EXIT_FAILURE, "could not copy the standard input");
+    }
+}
+
+static void lmc_cleanup(void)
+{
+    free(cmdargs.files);
+    lmc_setData(NULL, false);
+    lmc_setArchive(NULL);
+    lmc_archiveClose(cmdargs.archive);
+    lmc_metricsStop();
+}
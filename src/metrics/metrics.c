@@ -0,0 +1,272 @@
+/**
+ * @file      metrics.c
+ * @version   0.1.0
+ * @brief     LMC live metrics module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup MetricsInternals
+ * @{
+ */
+
+#include "lmc/metrics.h"
+
+/**
+ * @struct LmcMetricsSlot
+ * @since 0.1.0
+ * @brief The counters of a thread, alone on their cache line.
+ */
+typedef struct LmcMetricsSlot {
+    size_t counts[LMC_METRICS]; /**< The counters. */
+} __attribute__((aligned(64))) LmcMetricsSlot;
+
+/**
+ * @var lmc_metrics
+ * @since 0.1.0
+ * @brief The metrics of the process.
+ */
+static struct {
+    LmcMetricsSlot slots[LMC_METRICSLOTS]; /**< The threads counters. */
+    bool taken[LMC_METRICSLOTS]; /**< The slots of the running threads. */
+    size_t used;              /**< Number of slots given at least once. */
+    pthread_mutex_t lock;     /**< The slots allocation lock. */
+    pthread_key_t key;        /**< Releases the slot of a stopped
+                               * thread. */
+    pthread_once_t once;      /**< Creates the key. */
+    long queue;               /**< Programs waiting to be executed. */
+    uint64_t start;           /**< The first count time (ns). */
+    uint64_t last;            /**< The previous export time (ns). */
+    size_t instructions;      /**< The instructions at the previous
+                               * export. */
+    const char* path;         /**< The exported file path, or @c NULL
+                               * if not started. */
+    unsigned int delay;       /**< The delay between two exports. */
+    pthread_t thread;         /**< The exporter thread. */
+    pid_t pid;                /**< The exporter process. */
+    bool stopped;             /**< The exporter must stop. */
+} lmc_metrics = { .lock = PTHREAD_MUTEX_INITIALIZER, .once = PTHREAD_ONCE_INIT, };
+
+/**
+ * @var lmc_slot
+ * @since 0.1.0
+ * @brief The slot of the thread, given at its first count.
+ */
+static __thread LmcMetricsSlot* lmc_slot = NULL;
+
+/**
+ * @var lmc_metricsNames
+ * @since 0.1.0
+ * @brief The counters names and descriptions.
+ */
+static const char* lmc_metricsNames[LMC_METRICS][2] = {
+    [LMC_MCOMPLETED]    = { "lmc_programs_completed_total", "Programs stopped with a null status." },
+    [LMC_MFAILED]       = { "lmc_programs_failed_total", "Programs stopped with another status or by the instructions limit." },
+    [LMC_MINSTRUCTIONS] = { "lmc_instructions_total", "Instructions executed." },
+    [LMC_MINPUT]        = { "lmc_input_bytes_total", "Bytes read from the bus, the compiled programs excluded." },
+    [LMC_MOUTPUT]       = { "lmc_output_bytes_total", "Bytes written on the bus." },
+};
+
+/**
+ * @since 0.1.0
+ * @brief Give a slot to the calling thread, released at its exit.
+ */
+static void lmc_metricsSlot(void);
+
+/**
+ * @since 0.1.0
+ * @brief Release the slot of a stopped thread, its counts being kept
+ * for the next thread using it.
+ * @param slot The slot.
+ */
+static void lmc_metricsRelease(void* slot);
+
+/**
+ * @since 0.1.0
+ * @brief Create the key releasing the slots.
+ */
+static void lmc_metricsKey(void);
+
+/**
+ * @since 0.1.0
+ * @brief Export the metrics on each signal or delay, until stopped.
+ * @param unused Unused.
+ * @return @c NULL.
+ */
+static void* lmc_metricsExport(void* unused);
+
+/**
+ * @since 0.1.0
+ * @brief Replace the metrics file.
+ */
+static void lmc_metricsFile(void);
+
+/**
+ * @since 0.1.0
+ * @brief Get the monotonic clock time.
+ * @return The time (ns).
+ */
+static uint64_t lmc_metricsNow(void);
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * Implementation
+ ******************************************************************************/
+// clang-format on
+
+void lmc_metricsAdd(LmcMetric metric, size_t n)
+{
+    if (!lmc_slot) lmc_metricsSlot();
+    __atomic_fetch_add(&lmc_slot->counts[metric], n, __ATOMIC_RELAXED);
+}
+
+void lmc_metricsQueue(long delta)
+{
+    __atomic_fetch_add(&lmc_metrics.queue, delta, __ATOMIC_RELAXED);
+}
+
+size_t lmc_metricsCount(LmcMetric metric)
+{
+    size_t used = __atomic_load_n(&lmc_metrics.used, __ATOMIC_RELAXED), count = 0;
+
+    for (size_t i = 0; i < used; ++i)
+        count += __atomic_load_n(&lmc_metrics.slots[i].counts[metric], __ATOMIC_RELAXED);
+    return count;
+}
+
+void lmc_metricsWrite(FILE* output)
+{
+    size_t counts[LMC_METRICS] = { 0 };
+    uint64_t now = lmc_metricsNow(), start = __atomic_load_n(&lmc_metrics.start, __ATOMIC_ACQUIRE);
+    double mips = 0;
+
+    for (LmcMetric metric = 0; metric < LMC_METRICS; ++metric)
+        counts[metric] = lmc_metricsCount(metric);
+
+    for (LmcMetric metric = 0; metric < LMC_METRICS; ++metric)
+        fprintf(
+            output, "# HELP %s %s\n# TYPE %s counter\n%s %zu\n",
+            lmc_metricsNames[metric][0], lmc_metricsNames[metric][1],
+            lmc_metricsNames[metric][0], lmc_metricsNames[metric][0], counts[metric]
+        );
+
+    // The rate is measured since the previous export, in instructions
+    // per microsecond.
+    if (!lmc_metrics.last) lmc_metrics.last = start;
+    if (start && now > lmc_metrics.last)
+        mips = (double)(counts[LMC_MINSTRUCTIONS] - lmc_metrics.instructions) * 1e3 / (now - lmc_metrics.last);
+    lmc_metrics.last = now;
+    lmc_metrics.instructions = counts[LMC_MINSTRUCTIONS];
+
+    fprintf(
+        output,
+        "# HELP lmc_mips Millions of instructions executed per second since the previous export.\n"
+        "# TYPE lmc_mips gauge\nlmc_mips %.6f\n"
+        "# HELP lmc_queue_depth Programs waiting to be executed.\n"
+        "# TYPE lmc_queue_depth gauge\nlmc_queue_depth %ld\n"
+        "# HELP lmc_uptime_seconds Seconds since the first counted event.\n"
+        "# TYPE lmc_uptime_seconds gauge\nlmc_uptime_seconds %.3f\n",
+        mips,
+        __atomic_load_n(&lmc_metrics.queue, __ATOMIC_RELAXED),
+        start ? (now - start) / 1e9 : 0
+    );
+}
+
+void lmc_metricsStart(const char* restrict path, unsigned int delay)
+{
+    sigset_t signals;
+
+    lmc_metrics.path  = path;
+    lmc_metrics.delay = delay;
+    lmc_metrics.pid   = getpid();
+    // The signal is only received by the exporter, which waits for
+    // it, thus it needs no handler.
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    if ((errno = pthread_sigmask(SIG_BLOCK, &signals, NULL))
+        || (errno = pthread_create(&lmc_metrics.thread, NULL, lmc_metricsExport, NULL)))
+        err(EXIT_FAILURE, "could not start the metrics export");
+}
+
+void lmc_metricsStop(void)
+{
+    // The forked worker processes do not inherit the exporter.
+    if (!lmc_metrics.path || lmc_metrics.pid != getpid()) return;
+    __atomic_store_n(&lmc_metrics.stopped, true, __ATOMIC_RELEASE);
+    pthread_kill(lmc_metrics.thread, SIGUSR1);
+    pthread_join(lmc_metrics.thread, NULL);
+    lmc_metricsFile();
+    lmc_metrics.path = NULL;
+}
+
+static void lmc_metricsSlot(void)
+{
+    size_t slot = 0;
+
+    pthread_once(&lmc_metrics.once, lmc_metricsKey);
+    pthread_mutex_lock(&lmc_metrics.lock);
+    // The slots released by the stopped threads are given first. The
+    // extra threads share the last slot, which is why the counters
+    // are increased atomically.
+    while (slot < LMC_METRICSLOTS - 1 && lmc_metrics.taken[slot]) ++slot;
+    lmc_metrics.taken[slot] = true;
+    if (!lmc_metrics.used) __atomic_store_n(&lmc_metrics.start, lmc_metricsNow(), __ATOMIC_RELEASE);
+    if (slot >= lmc_metrics.used) __atomic_store_n(&lmc_metrics.used, slot + 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&lmc_metrics.lock);
+
+    lmc_slot = &lmc_metrics.slots[slot];
+    pthread_setspecific(lmc_metrics.key, lmc_slot);
+}
+
+static void lmc_metricsRelease(void* slot)
+{
+    pthread_mutex_lock(&lmc_metrics.lock);
+    lmc_metrics.taken[(LmcMetricsSlot*)slot - lmc_metrics.slots] = false;
+    pthread_mutex_unlock(&lmc_metrics.lock);
+}
+
+static void lmc_metricsKey(void)
+{
+    if ((errno = pthread_key_create(&lmc_metrics.key, lmc_metricsRelease)))
+        err(EXIT_FAILURE, "could not start the metrics");
+}
+
+static void* lmc_metricsExport(void* unused)
+{
+    struct timespec delay = { .tv_sec = lmc_metrics.delay, };
+    sigset_t signals;
+
+    (void) unused;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    for (;;) {
+        if (lmc_metrics.delay) sigtimedwait(&signals, NULL, &delay);
+        else sigwaitinfo(&signals, NULL);
+        // The last export is written by lmc_metricsStop().
+        if (__atomic_load_n(&lmc_metrics.stopped, __ATOMIC_ACQUIRE)) return NULL;
+        lmc_metricsFile();
+    }
+}
+
+static void lmc_metricsFile(void)
+{
+    char temporary[PATH_MAX] = { 0 };
+    FILE* file = NULL;
+
+    snprintf(temporary, sizeof(temporary), "%s.tmp", lmc_metrics.path);
+    if (!(file = fopen(temporary, "w"))) return warn("%s", temporary);
+    lmc_metricsWrite(file);
+    if (fclose(file) || rename(temporary, lmc_metrics.path)) warn("%s", lmc_metrics.path);
+}
+
+static uint64_t lmc_metricsNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+/** @} */
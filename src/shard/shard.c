@@ -0,0 +1,399 @@
+/**
+ * @file      shard.c
+ * @version   0.1.0
+ * @brief     LMC multi-process batch coordinator module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup ShardInternals
+ * @{
+ */
+
+#include "lmc/shard.h"
+
+/**
+ * @struct LmcChunk
+ * @since 0.1.0
+ * @brief A shard of the jobs.
+ */
+typedef struct LmcChunk {
+    size_t first;    /**< The first job index. */
+    size_t count;    /**< The number of jobs. */
+    size_t received; /**< The number of results received. */
+    size_t sent;     /**< The number of jobs sent to its worker, from
+                      * the first one without result. */
+    size_t tries;    /**< The number of workers which stopped in a row
+                      * while running it. */
+    char* results;   /**< The received results. */
+    size_t size;     /**< The received results size. */
+    int status;      /**< The workers batch status. */
+    bool done;       /**< The results are complete. */
+} LmcChunk;
+
+/**
+ * @struct LmcProcess
+ * @since 0.1.0
+ * @brief A worker process.
+ */
+typedef struct LmcProcess {
+    pid_t pid;       /**< The worker process identifier. */
+    int fd;          /**< The worker connection. */
+    LmcChunk* chunk; /**< The running shard, or @c NULL if idle. */
+    char* line;      /**< The pending partial line. */
+    size_t size;     /**< The pending partial line size. */
+} LmcProcess;
+
+/**
+ * @struct LmcCoordinator
+ * @since 0.1.0
+ * @brief The coordinator state.
+ */
+typedef struct LmcCoordinator {
+    const char* bootstrap;  /**< The compiled bootstrap file path. */
+    const LmcJob* jobs;     /**< The jobs. */
+    LmcChunk* chunks;       /**< The shards. */
+    size_t* waiting;        /**< The stack of the shards to send. */
+    size_t pending;         /**< The number of shards to send. */
+    LmcProcess* processes;  /**< The workers. */
+    size_t workers;         /**< The number of workers. */
+    size_t threads;         /**< The number of threads per worker. */
+    size_t limit;           /**< The max number of instructions per
+                             * program. */
+} LmcCoordinator;
+
+/**
+ * @since 0.1.0
+ * @brief Fork a worker.
+ *
+ * This function may raise a fatal error if the worker cannot be
+ * started.
+ *
+ * @param self The coordinator.
+ * @param process The worker destination.
+ */
+static void lmc_spawn(LmcCoordinator* self, LmcProcess* process) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Send the next waiting shard to an idle worker.
+ *
+ * A failed write is detected when reading the worker answer.
+ *
+ * @param self The coordinator.
+ * @param process The worker.
+ */
+static void lmc_send(LmcCoordinator* self, LmcProcess* process) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Read the available results of a worker.
+ *
+ * A shard partially sent is put back in the waiting ones once its
+ * worker is done.
+ *
+ * @param self The coordinator.
+ * @param process The worker.
+ * @return @c false if the worker is stopped, otherwise @c true.
+ */
+static bool lmc_receive(LmcCoordinator* self, LmcProcess* process) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Replace a stopped worker, and send the jobs of its shard
+ * without result again, or give up the first one.
+ * @param self The coordinator.
+ * @param process The worker.
+ */
+static void lmc_replace(LmcCoordinator* self, LmcProcess* process) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Append a result line to a shard.
+ * @param chunk The shard.
+ * @param line The line, new line included.
+ * @param length The line length.
+ */
+static void lmc_store(LmcChunk* chunk, const char* line, size_t length) __attribute__((nonnull));
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * Implementation
+ ******************************************************************************/
+// clang-format on
+
+int lmc_coordinate(const char* restrict bootstrap, const LmcJob* jobs, size_t count, size_t processes, size_t size, size_t threads, size_t limit)
+{
+    LmcCoordinator self = {
+        .bootstrap = bootstrap,
+        .jobs      = jobs,
+        .limit     = limit,
+    };
+    struct pollfd* events = NULL;
+    LmcChunk* chunk = NULL;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t chunks = 0, watched = 0;
+    int status = EXIT_SUCCESS;
+
+    if (!count) return status;
+    size = size ? size : LMC_SHARDJOBS;
+    chunks = (count + size - 1) / size;
+    processes = processes ? processes : 1;
+    self.workers = processes = processes < chunks ? processes : chunks;
+    self.threads = threads ? threads : cpus > (long)processes ? cpus / processes : 1;
+    if (!(self.chunks = calloc(chunks, sizeof(LmcChunk)))
+        || !(self.waiting = calloc(chunks, sizeof(size_t)))
+        || !(self.processes = calloc(processes, sizeof(LmcProcess)))
+        || !(events = calloc(processes, sizeof(struct pollfd))))
+        err(EXIT_FAILURE, "could not allocate the shards");
+
+    // The waiting shards are a stack, thus the first ones are on
+    // top, to be reported first.
+    for (size_t i = 0; i < chunks; ++i) {
+        self.chunks[i].first = i * size;
+        self.chunks[i].count = i + 1 < chunks ? size : count - i * size;
+        self.waiting[chunks - 1 - i] = i;
+    }
+    self.pending = chunks;
+    lmc_metricsQueue(count);
+
+    // The stopped workers must not kill the coordinator, and the
+    // bootstrap is shared by the workers and their replacements.
+    signal(SIGPIPE, SIG_IGN);
+    if (bootstrap) lmc_preload(bootstrap);
+    for (size_t i = 0; i < processes; ++i) self.processes[i].fd = -1;
+    for (size_t i = 0; i < processes; ++i) lmc_spawn(&self, &self.processes[i]);
+
+    for (size_t next = 0; next < chunks;) {
+        watched = 0;
+        for (size_t i = 0; i < processes; ++i) {
+            if (!self.processes[i].chunk && self.pending) lmc_send(&self, &self.processes[i]);
+            if (self.processes[i].chunk)
+                events[watched++] = (struct pollfd){ .fd = self.processes[i].fd, .events = POLLIN, };
+        }
+
+        if (watched && poll(events, watched, -1) < 0) {
+            if (errno == EINTR) continue;
+            err(EXIT_FAILURE, "could not wait for the workers");
+        }
+        for (size_t i = 0, j = 0; i < processes && j < watched; ++i) {
+            if (self.processes[i].fd != events[j].fd) continue;
+            if (events[j++].revents && !lmc_receive(&self, &self.processes[i]))
+                lmc_replace(&self, &self.processes[i]);
+        }
+
+        // The shards are merged in order, as soon as possible.
+        for (; next < chunks && (chunk = &self.chunks[next])->done; ++next) {
+            fwrite(chunk->results, sizeof(char), chunk->size, stdout);
+            fflush(stdout);
+            if (chunk->status) status = EXIT_FAILURE;
+            lmc_metricsQueue(-(long)chunk->count);
+            free(chunk->results);
+        }
+    }
+
+    // The workers stop at the end of their input.
+    for (size_t i = 0; i < processes; ++i) {
+        close(self.processes[i].fd);
+        waitpid(self.processes[i].pid, NULL, 0);
+        free(self.processes[i].line);
+    }
+    free(events);
+    free(self.processes);
+    free(self.waiting);
+    free(self.chunks);
+    return status;
+}
+
+int lmc_shardWorker(const char* restrict bootstrap, size_t threads, size_t limit, bool pinned)
+{
+    LmcJob* jobs = NULL;
+    size_t count = 0, read = 0, counts[LMC_METRICS] = { 0 }, current = 0;
+    int status = EXIT_SUCCESS;
+
+    // The counters inherited from a coordinator are not sent back.
+    for (LmcMetric metric = 0; metric < LMC_METRICS; ++metric)
+        counts[metric] = lmc_metricsCount(metric);
+
+    while (scanf(" shard %zu", &count) == 1) {
+        jobs = lmc_manifestRead(stdin, "shard", count, &read);
+        if (read < count) {
+            errno = EINVAL;
+            err(EXIT_FAILURE, "shard: %zu jobs are missing", count - read);
+        }
+        status = lmc_batch(bootstrap, jobs, count, threads, limit, pinned);
+        printf("end %i", status);
+        for (LmcMetric metric = 0; metric < LMC_METRICS; ++metric) {
+            current = lmc_metricsCount(metric);
+            printf(" %zu", current - counts[metric]);
+            counts[metric] = current;
+        }
+        printf("\n");
+        fflush(stdout);
+        lmc_manifestFree(jobs, read);
+    }
+
+    if (!feof(stdin)) {
+        errno = EINVAL;
+        err(EXIT_FAILURE, "malformed shard header");
+    }
+    return EXIT_SUCCESS;
+}
+
+static void lmc_spawn(LmcCoordinator* self, LmcProcess* process)
+{
+    int pair[2] = { -1, -1 };
+
+    // The pending results must not be written twice.
+    fflush(stdout);
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair)
+        || (process->pid = fork()) < 0)
+        err(EXIT_FAILURE, "could not start a worker");
+
+    if (!process->pid) {
+        // The other workers connections are closed, otherwise they
+        // would never see the end of their input.
+        for (size_t i = 0; i < self->workers; ++i)
+            if (self->processes[i].fd >= 0) close(self->processes[i].fd);
+        if (dup2(pair[1], STDIN_FILENO) < 0 || dup2(pair[1], STDOUT_FILENO) < 0)
+            err(EXIT_FAILURE, "could not start a worker");
+        close(pair[0]);
+        close(pair[1]);
+        clearerr(stdin);
+        exit(lmc_shardWorker(self->bootstrap, self->threads, self->limit, false));
+    }
+
+    close(pair[1]);
+    process->fd = pair[0];
+    process->chunk = NULL;
+    process->size = 0;
+}
+
+static void lmc_send(LmcCoordinator* self, LmcProcess* process)
+{
+    LmcChunk* chunk = &self->chunks[self->waiting[--self->pending]];
+    const LmcJob* job = NULL;
+    char* shard = NULL;
+    size_t size = 0;
+    ssize_t done = 0;
+    FILE* stream = open_memstream(&shard, &size);
+
+    if (!stream) err(EXIT_FAILURE, "could not allocate the shard");
+    // After a worker stopped, the next job is sent alone, thus a job
+    // stopping the workers is isolated.
+    chunk->sent = chunk->tries ? 1 : chunk->count - chunk->received;
+    fprintf(stream, "shard %zu\n", chunk->sent);
+    for (size_t i = 0; i < chunk->sent; ++i) {
+        job = &self->jobs[chunk->first + chunk->received + i];
+        fprintf(
+            stream, "%s %s %s\n",
+            job->program,
+            job->input ? job->input : "-",
+            job->expected ? job->expected : "-"
+        );
+    }
+    fclose(stream);
+
+    for (size_t sent = 0; sent < size; sent += done)
+        if ((done = write(process->fd, &shard[sent], size - sent)) < 0) {
+            if (errno == EINTR) done = 0;
+            else break;
+        }
+    free(shard);
+    process->chunk = chunk;
+}
+
+static bool lmc_receive(LmcCoordinator* self, LmcProcess* process)
+{
+    LmcChunk* chunk = process->chunk;
+    char buffer[BUFSIZ];
+    char* end = NULL;
+    char* field = NULL;
+    size_t length = 0;
+    ssize_t done = read(process->fd, buffer, sizeof(buffer));
+
+    if (done < 0 && errno == EINTR) return true;
+    if (done <= 0) return false;
+
+    if (!(process->line = realloc(process->line, process->size + done)))
+        err(EXIT_FAILURE, "could not allocate the results");
+    memcpy(&process->line[process->size], buffer, done);
+    process->size += done;
+
+    // The results are stored line by line, up to the end line.
+    while (chunk && (end = memchr(process->line, '\n', process->size))) {
+        length = end - process->line + 1;
+        if (!strncmp(process->line, "end ", 4)) {
+            // The worker counters of the shard follow its status.
+            *end = '\0';
+            if (strtol(&process->line[4], &field, 10)) chunk->status = EXIT_FAILURE;
+            for (LmcMetric metric = 0; metric < LMC_METRICS; ++metric)
+                lmc_metricsAdd(metric, strtoull(field, &field, 10));
+            if (chunk->received < chunk->count) self->waiting[self->pending++] = chunk - self->chunks;
+            else chunk->done = true;
+            process->chunk = chunk = NULL;
+        }
+        else {
+            lmc_store(chunk, process->line, length);
+            ++chunk->received;
+            chunk->tries = 0;
+        }
+        memmove(process->line, end + 1, process->size - length);
+        process->size -= length;
+    }
+    return true;
+}
+
+static void lmc_replace(LmcCoordinator* self, LmcProcess* process)
+{
+    LmcChunk* chunk = process->chunk;
+    const char* program = NULL;
+    FILE* stream = NULL;
+    char* line = NULL;
+    size_t length = 0;
+    int status = 0;
+
+    close(process->fd);
+    process->fd = -1;
+    waitpid(process->pid, &status, 0);
+    warnx(
+        "worker %i stopped (%s %i)", process->pid,
+        WIFSIGNALED(status) ? "signal" : "status",
+        WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status)
+    );
+
+    // The received results are kept, and only the next job is given
+    // up once it stopped its workers alone too many times.
+    chunk->tries = chunk->sent > 1 ? 1 : chunk->tries + 1;
+    if (chunk->received < chunk->count && chunk->sent == 1 && chunk->tries >= LMC_SHARDTRIES) {
+        program = self->jobs[chunk->first + chunk->received].program;
+        if (!(stream = open_memstream(&line, &length)))
+            err(EXIT_FAILURE, "could not allocate the results");
+        fprintf(stream, "{\"program\":");
+        lmc_json(stream, program, strlen(program));
+        fprintf(stream, ",\"status\":null,\"error\":\"the worker stopped\"}\n");
+        fclose(stream);
+        lmc_store(chunk, line, length);
+        free(line);
+        ++chunk->received;
+        chunk->tries  = 0;
+        chunk->status = EXIT_FAILURE;
+    }
+    if (chunk->received < chunk->count) self->waiting[self->pending++] = chunk - self->chunks;
+    else chunk->done = true;
+
+    lmc_spawn(self, process);
+}
+
+static void lmc_store(LmcChunk* chunk, const char* line, size_t length)
+{
+    if (!(chunk->results = realloc(chunk->results, chunk->size + length)))
+        err(EXIT_FAILURE, "could not allocate the results");
+    memcpy(&chunk->results[chunk->size], line, length);
+    chunk->size += length;
+}
+
+/** @} */
@@ -0,0 +1,199 @@
+/**
+ * @file      timings.c
+ * @version   0.1.0
+ * @brief     LMC host timings module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup TimingsInternals
+ * @{
+ */
+
+#include "lmc/timings.h"
+
+#ifdef _TIMINGS
+
+// clang-format off
+
+/******************************************************************************
+ * @name Histograms
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+/**
+ * @struct LmcTimings
+ * @since 0.1.0
+ * @brief The histograms of a thread.
+ */
+typedef struct LmcTimings {
+    size_t counts[LMC_TIMERS][LMC_TIMINGBUCKETS]; /**< The latencies
+                                                   * per bucket. */
+    uint64_t max[LMC_TIMERS];                     /**< The max
+                                                   * latencies. */
+    struct LmcTimings* next;                      /**< The histograms of
+                                                   * the previous
+                                                   * thread. */
+} LmcTimings;
+
+/**
+ * @var lmc_timings
+ * @since 0.1.0
+ * @brief The histograms of all the threads, kept until the exit, the
+ * last thread first.
+ */
+static struct {
+    LmcTimings* first;    /**< The last thread histograms. */
+    pthread_mutex_t lock; /**< The list lock. */
+} lmc_timings = { .lock = PTHREAD_MUTEX_INITIALIZER, };
+
+/**
+ * @var lmc_threadTimings
+ * @since 0.1.0
+ * @brief The histograms of the thread, allocated at its first timing.
+ */
+static __thread LmcTimings* lmc_threadTimings = NULL;
+
+/**
+ * @var lmc_timersNames
+ * @since 0.1.0
+ * @brief The timers names, as reported.
+ */
+static const char* lmc_timersNames[LMC_TIMERS] = {
+    [LMC_TPHASEONE]   = "phaseOne",
+    [LMC_TPHASETWO]   = "phaseTwo",
+    [LMC_TPHASETHREE] = "phaseThree",
+    [LMC_TBUSINPUT]   = "busInput",
+    [LMC_TBUSOUTPUT]  = "busOutput",
+    [LMC_TBOOTSTRAP]  = "bootstrap",
+    [LMC_TPARSE]      = "yyparse",
+    [LMC_TCOMPWRITE]  = "compilerWrite",
+};
+
+/**
+ * @var lmc_percentiles
+ * @since 0.1.0
+ * @brief The reported percentiles.
+ */
+static const double lmc_percentiles[] = { 50, 90, 99, 99.9, 99.99, };
+
+/**
+ * @since 0.1.0
+ * @brief Get the bucket of a latency.
+ * @param latency The latency (ns).
+ * @return The bucket index.
+ */
+static size_t lmc_timingBucket(uint64_t latency);
+
+/**
+ * @since 0.1.0
+ * @brief Get the highest latency of a bucket.
+ * @param bucket The bucket index.
+ * @return The latency (ns).
+ */
+static uint64_t lmc_timingValue(size_t bucket);
+
+/**
+ * @since 0.1.0
+ * @brief Report the timings on the standard error at exit, if any.
+ */
+static void lmc_timingsExit(void) __attribute__((destructor));
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * Implementation
+ ******************************************************************************/
+// clang-format on
+
+uint64_t lmc_timingNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+void lmc_timingStop(const LmcTiming* timing)
+{
+    uint64_t latency = lmc_timingNow() - timing->start;
+    LmcTimings* timings = lmc_threadTimings;
+
+    if (!timings) {
+        // The timings are lost if they cannot be recorded, but the
+        // execution goes on.
+        if (!(timings = calloc(1, sizeof(LmcTimings)))) return;
+        pthread_mutex_lock(&lmc_timings.lock);
+        timings->next = lmc_timings.first;
+        lmc_timings.first = lmc_threadTimings = timings;
+        pthread_mutex_unlock(&lmc_timings.lock);
+    }
+    ++timings->counts[timing->timer][lmc_timingBucket(latency)];
+    if (latency > timings->max[timing->timer]) timings->max[timing->timer] = latency;
+}
+
+void lmc_timingsReport(FILE* output)
+{
+    size_t counts[LMC_TIMINGBUCKETS], total = 0, seen = 0, bucket = 0;
+    uint64_t max = 0;
+
+    fprintf(output, "%-14s %12s", "timer (ns)", "count");
+    for (size_t i = 0; i < sizeof(lmc_percentiles) / sizeof(double); ++i)
+        fprintf(output, "  p%-8g", lmc_percentiles[i]);
+    fprintf(output, "  %s\n", "max");
+
+    pthread_mutex_lock(&lmc_timings.lock);
+    for (LmcTimer timer = 0; timer < LMC_TIMERS; ++timer) {
+        memset(counts, 0, sizeof(counts));
+        total = max = 0;
+        for (LmcTimings* timings = lmc_timings.first; timings; timings = timings->next) {
+            for (size_t i = 0; i < LMC_TIMINGBUCKETS; ++i)
+                counts[i] += timings->counts[timer][i], total += timings->counts[timer][i];
+            if (timings->max[timer] > max) max = timings->max[timer];
+        }
+        if (!total) continue;
+
+        fprintf(output, "%-14s %12zu", lmc_timersNames[timer], total);
+        seen = bucket = 0;
+        for (size_t i = 0; i < sizeof(lmc_percentiles) / sizeof(double); ++i) {
+            // The percentile is the first bucket reaching its rank.
+            while (seen + counts[bucket] < lmc_percentiles[i] * total / 100) seen += counts[bucket++];
+            uint64_t value = lmc_timingValue(bucket);
+            fprintf(output, "  %-9lu", (unsigned long)(value < max ? value : max));
+        }
+        fprintf(output, "  %lu\n", (unsigned long)max);
+    }
+    pthread_mutex_unlock(&lmc_timings.lock);
+}
+
+static size_t lmc_timingBucket(uint64_t latency)
+{
+    size_t exponent = 0;
+
+    if (latency < LMC_TIMINGSUB) return latency;
+    exponent = 63 - __builtin_clzll(latency);
+    return (exponent - LMC_TIMINGSHIFT + 1) * LMC_TIMINGSUB
+        + ((latency >> (exponent - LMC_TIMINGSHIFT)) & (LMC_TIMINGSUB - 1));
+}
+
+static uint64_t lmc_timingValue(size_t bucket)
+{
+    size_t exponent = bucket / LMC_TIMINGSUB + LMC_TIMINGSHIFT - 1;
+    uint64_t sub = bucket % LMC_TIMINGSUB;
+
+    if (bucket < LMC_TIMINGSUB) return bucket;
+    return ((LMC_TIMINGSUB + sub + 1) << (exponent - LMC_TIMINGSHIFT)) - 1;
+}
+
+static void lmc_timingsExit(void)
+{
+    if (!lmc_timings.first) return;
+    fprintf(stderr, "LMC: host timings of process %d\n", getpid());
+    lmc_timingsReport(stderr);
+}
+
+#endif // _TIMINGS
+
+/** @} */
@@ -0,0 +1,476 @@
+/**
+ * @file      trace.c
+ * @version   0.1.0
+ * @brief     LMC execution traces module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * @addtogroup TraceInternals
+ * @{
+ */
+
+#include "lmc/trace.h"
+
+// clang-format off
+
+/******************************************************************************
+ * @name Writing
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+/**
+ * @since 0.1.0
+ * @brief Write the filled blocks of a trace ring on its file, until
+ * the trace is closed.
+ * @param trace The trace (a #LmcTrace).
+ * @return @c NULL.
+ */
+static void* lmc_traceFlush(void* trace) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Hand the block being filled to the flushing thread, waiting
+ * for the next one to be flushed if the ring is full.
+ * @param trace The trace.
+ */
+static void lmc_tracePublish(LmcTrace* trace) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Append bytes to a trace ring.
+ * @param trace The trace.
+ * @param data The bytes.
+ * @param size The number of bytes.
+ */
+static void lmc_tracePut(LmcTrace* trace, const LmcRam* data, size_t size) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Record the pending instruction of a trace.
+ * @param trace The trace.
+ * @param ram The computer memory, holding the sections written.
+ * @param acc The accumulator after the instruction.
+ */
+static void lmc_traceStep(LmcTrace* trace, const LmcRam* ram, LmcRam acc) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Encode a number as a LEB128 variable-length integer.
+ * @param dest The destination, of at least 10 bytes.
+ * @param value The number.
+ * @return The number of bytes written.
+ */
+static size_t lmc_traceNumber(LmcRam* dest, size_t value) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Zigzag-encode the difference of two bytes.
+ * @param to,from The bytes.
+ * @return The encoded difference, lesser than #LMC_MAXRAM.
+ */
+static size_t lmc_zigzag(LmcRam to, LmcRam from);
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * @name Reading
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+/**
+ * @struct LmcTraceEvent
+ * @since 0.1.0
+ * @brief A trace event, as read.
+ */
+typedef struct LmcTraceEvent {
+    bool input;        /**< An input (@c true) or an instruction. */
+    LmcRam pc;         /**< The instruction address. */
+    LmcRam opcode;     /**< The instruction operation. */
+    LmcRam argument;   /**< The instruction argument. */
+    LmcRam acc;        /**< The accumulator after the instruction. */
+    LmcRam next;       /**< The address following the instruction. */
+    size_t count;      /**< Number of sections written. */
+    struct {
+        LmcRam address; /**< The section address. */
+        size_t length;  /**< The section length. */
+    } runs[LMC_TRACERUNS]; /**< The sections written. */
+    size_t size;       /**< Number of LmcTraceEvent::words. */
+    LmcRam words[LMC_TRACERUNS * LMC_MAXRAM]; /**< The input words,
+                                               * or the sections
+                                               * contents. */
+} LmcTraceEvent;
+
+/**
+ * @since 0.1.0
+ * @brief Open a trace and read its header.
+ *
+ * This function may raise a fatal error if the trace cannot be read,
+ * or if its header is malformed.
+ *
+ * @param path The trace file path.
+ * @param program The traced program file path destination, of
+ * @c PATH_MAX bytes.
+ * @return The trace file, positioned on its first event.
+ */
+static FILE* lmc_traceRead(const char* restrict path, char* restrict program) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Read the next event of a trace.
+ * @param file The trace file.
+ * @param event The event destination, holding the previous event.
+ * @return @c 1 if an event is read, @c 0 at the end of the trace,
+ * @c -1 if the event is malformed.
+ */
+static int lmc_traceNext(FILE* file, LmcTraceEvent* event) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Read a LEB128 variable-length integer.
+ * @param file The trace file.
+ * @param value The number destination.
+ * @return @c false if the number is truncated or too large,
+ * otherwise @c true.
+ */
+static bool lmc_traceGet(FILE* file, size_t* value) __attribute__((nonnull));
+
+/**
+ * @since 0.1.0
+ * @brief Raise a fatal error for a malformed trace.
+ * @param path The trace file path.
+ */
+static void lmc_malformed(const char* restrict path) __attribute__((noreturn, nonnull));
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * Implementation
+ ******************************************************************************/
+// clang-format on
+
+LmcTrace* lmc_traceOpen(const char* restrict path, const char* restrict program)
+{
+    LmcTrace* trace = calloc(1, sizeof(LmcTrace));
+    LmcRam header[sizeof(LMC_TRACEMAGIC) + 10] = LMC_TRACEMAGIC;
+    size_t size = sizeof(LMC_TRACEMAGIC) - 1, length = program ? strlen(program) : 0;
+
+    if (!trace) lmc_err("could not allocate the trace");
+    if (!(trace->file = fopen(path, "wb"))) {
+        free(trace);
+        return lmc_warn("%s", path), NULL;
+    }
+
+    // The header is written before the flushing thread starts.
+    header[size++] = LMC_TRACEVERSION;
+    size += lmc_traceNumber(&header[size], length);
+    if (fwrite(header, sizeof(LmcRam), size, trace->file) < size
+        || fwrite(program ? program : "", sizeof(char), length, trace->file) < length)
+        trace->failed = true;
+
+    pthread_mutex_init(&trace->lock, NULL);
+    pthread_cond_init(&trace->filled, NULL);
+    pthread_cond_init(&trace->flushed, NULL);
+    if ((errno = pthread_create(&trace->thread, NULL, lmc_traceFlush, trace)))
+        lmc_err("could not start the trace");
+    return trace;
+}
+
+void lmc_traceFetch(LmcTrace* trace, const LmcRam* ram, LmcRam pc, LmcRam acc)
+{
+    if (trace->pending.started) lmc_traceStep(trace, ram, acc);
+    trace->pending.started  = true;
+    trace->pending.pc       = pc;
+    trace->pending.opcode   = ram[pc];
+    // The addresses wrap around as the PC.
+    trace->pending.argument = ram[(LmcRam)(pc + 1)];
+    trace->pending.count    = 0;
+}
+
+void lmc_traceWrite(LmcTrace* trace, unsigned int address, size_t length)
+{
+    // No instruction writes more sections; the failed writes are
+    // recorded with the unchanged content.
+    if (!length || trace->pending.count >= LMC_TRACERUNS) return;
+    trace->pending.runs[trace->pending.count].address  = address;
+    trace->pending.runs[trace->pending.count++].length = length;
+}
+
+void lmc_traceInput(LmcTrace* trace, const LmcRam* words, size_t size)
+{
+    LmcRam tag[10] = { 0 };
+    size_t chunk = 0;
+
+    // The inputs are split to be read back in one go.
+    for (; size; words += chunk, size -= chunk) {
+        chunk = size < LMC_MAXRAM ? size : LMC_MAXRAM;
+        lmc_tracePut(trace, tag, lmc_traceNumber(tag, chunk << 1 | 1));
+        lmc_tracePut(trace, words, chunk);
+    }
+}
+
+void lmc_traceClose(LmcTrace* trace, const LmcRam* ram, LmcRam acc)
+{
+    if (trace->pending.started) lmc_traceStep(trace, ram, acc);
+    if (trace->size) lmc_tracePublish(trace);
+
+    pthread_mutex_lock(&trace->lock);
+    trace->closed = true;
+    pthread_cond_signal(&trace->filled);
+    pthread_mutex_unlock(&trace->lock);
+    pthread_join(trace->thread, NULL);
+
+    if (fclose(trace->file) || trace->failed) lmc_warn("could not write the trace");
+    pthread_cond_destroy(&trace->flushed);
+    pthread_cond_destroy(&trace->filled);
+    pthread_mutex_destroy(&trace->lock);
+    free(trace);
+}
+
+int lmc_tracePrint(const char* restrict path, FILE* output)
+{
+    char program[PATH_MAX] = { 0 }, name[16] = { 0 };
+    FILE* file = lmc_traceRead(path, program);
+    LmcTraceEvent* event = calloc(1, sizeof(LmcTraceEvent));
+    const LmcRam* content = NULL;
+    int status = 0;
+
+    if (!event) lmc_err("could not allocate the trace");
+    fprintf(output, "program: %s\n", *program ? program : "-");
+    while ((status = lmc_traceNext(file, event)) > 0) {
+        if (event->input) {
+            fputs("input:", output);
+            for (size_t i = 0; i < event->size; ++i)
+                fprintf(output, " " LMC_HEXFMT, LMC_MAXDIGITS, event->words[i]);
+            fputc('\n', output);
+            continue;
+        }
+
+        fprintf(output, LMC_HEXFMT ": " LMC_HEXFMT " " LMC_HEXFMT "  %-10s acc " LMC_HEXFMT,
+                LMC_MAXDIGITS, event->pc, LMC_MAXDIGITS, event->opcode,
+                LMC_MAXDIGITS, event->argument, lmc_opname(name, event->opcode),
+                LMC_MAXDIGITS, event->acc);
+        content = event->words;
+        for (size_t i = 0; i < event->count; content += event->runs[i++].length) {
+            fprintf(output, "  [" LMC_HEXFMT "]", LMC_MAXDIGITS, event->runs[i].address);
+            for (size_t j = 0; j < event->runs[i].length; ++j)
+                fprintf(output, " " LMC_HEXFMT, LMC_MAXDIGITS, content[j]);
+        }
+        fputc('\n', output);
+    }
+    fclose(file);
+    free(event);
+
+    if (status < 0) {
+        errno = EBADMSG;
+        lmc_warn("%s: malformed trace", path);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+LmcRam* lmc_traceInputs(const char* restrict path, char* restrict program, size_t* restrict size)
+{
+    FILE* file = lmc_traceRead(path, program);
+    LmcTraceEvent* event = calloc(1, sizeof(LmcTraceEvent));
+    LmcRam* words = NULL;
+    size_t max = 0;
+    int status = 0;
+
+    if (!event) lmc_err("could not allocate the trace");
+    *size = 0;
+    while ((status = lmc_traceNext(file, event)) > 0) {
+        if (!event->input) continue;
+        // exponential growth to reduce the realloc calls.
+        if (*size + event->size > max) {
+            max = max ? max * 2 : LMC_MAXRAM;
+            if (!(words = realloc(words, max))) lmc_err("could not allocate the trace");
+        }
+        memcpy(&words[*size], event->words, event->size);
+        *size += event->size;
+    }
+    fclose(file);
+    free(event);
+    if (status < 0) lmc_malformed(path);
+    return words;
+}
+
+static void* lmc_traceFlush(void* trace)
+{
+    LmcTrace* self = trace;
+    size_t block = 0;
+
+    pthread_mutex_lock(&self->lock);
+    for (;;) {
+        while (self->head == self->tail && !self->closed)
+            pthread_cond_wait(&self->filled, &self->lock);
+        if (self->head == self->tail) break;
+
+        // The block is not touched by the computer until released.
+        block = self->head % LMC_TRACEBLOCKS;
+        pthread_mutex_unlock(&self->lock);
+        if (fwrite(self->blocks[block], sizeof(LmcRam), self->sizes[block], self->file) < self->sizes[block])
+            self->failed = true;
+        pthread_mutex_lock(&self->lock);
+        ++self->head;
+        pthread_cond_signal(&self->flushed);
+    }
+    pthread_mutex_unlock(&self->lock);
+    return NULL;
+}
+
+static void lmc_tracePublish(LmcTrace* trace)
+{
+    pthread_mutex_lock(&trace->lock);
+    trace->sizes[trace->tail++ % LMC_TRACEBLOCKS] = trace->size;
+    pthread_cond_signal(&trace->filled);
+    // The computer only waits if the whole ring is not flushed yet.
+    while (trace->tail - trace->head == LMC_TRACEBLOCKS)
+        pthread_cond_wait(&trace->flushed, &trace->lock);
+    pthread_mutex_unlock(&trace->lock);
+    trace->size = 0;
+}
+
+static void lmc_tracePut(LmcTrace* trace, const LmcRam* data, size_t size)
+{
+    LmcRam* block = NULL;
+    size_t chunk = 0;
+
+    // Only the computer changes the tail, thus it is read unlocked.
+    for (; size; data += chunk, size -= chunk) {
+        block = trace->blocks[trace->tail % LMC_TRACEBLOCKS];
+        chunk = LMC_TRACEBUF - trace->size;
+        chunk = chunk < size ? chunk : size;
+        memcpy(&block[trace->size], data, chunk);
+        trace->size += chunk;
+        if (trace->size == LMC_TRACEBUF) lmc_tracePublish(trace);
+    }
+}
+
+static void lmc_traceStep(LmcTrace* trace, const LmcRam* ram, LmcRam acc)
+{
+    LmcRam* record = NULL;
+    size_t size = 0;
+
+    // The record is encoded in place, thus it never straddles two
+    // blocks; only the sections contents may.
+    if (LMC_TRACEBUF - trace->size < LMC_TRACERECORD) lmc_tracePublish(trace);
+    record = &trace->blocks[trace->tail % LMC_TRACEBLOCKS][trace->size];
+    size += lmc_traceNumber(&record[size], lmc_zigzag(trace->pending.pc, trace->next) << 1);
+    record[size++] = trace->pending.opcode;
+    record[size++] = trace->pending.argument;
+    size += lmc_traceNumber(&record[size], lmc_zigzag(acc, trace->acc));
+    size += lmc_traceNumber(&record[size], trace->pending.count);
+    for (size_t i = 0; i < trace->pending.count; ++i) {
+        record[size++] = trace->pending.runs[i].address;
+        size += lmc_traceNumber(&record[size], trace->pending.runs[i].length);
+    }
+
+    // The sections contents follow their addresses and lengths.
+    trace->size += size;
+    for (size_t i = 0; i < trace->pending.count; ++i)
+        lmc_tracePut(trace, &ram[trace->pending.runs[i].address], trace->pending.runs[i].length);
+    trace->next = trace->pending.pc + 2;
+    trace->acc  = acc;
+    trace->pending.started = false;
+}
+
+static size_t lmc_traceNumber(LmcRam* dest, size_t value)
+{
+    size_t size = 0;
+
+    // Most of the numbers take one byte.
+    if (value < 0x80) return (*dest = value), 1;
+    do {
+        dest[size++] = (value & 0x7f) | (value > 0x7f ? 0x80 : 0);
+        value >>= 7;
+    } while (value);
+    return size;
+}
+
+static size_t lmc_zigzag(LmcRam to, LmcRam from)
+{
+    LmcRam delta = to - from;
+    return delta < LMC_SIGN ? 2 * (size_t)delta : 2 * (size_t)(LMC_MAXRAM - delta) - 1;
+}
+
+static FILE* lmc_traceRead(const char* restrict path, char* restrict program)
+{
+    char magic[sizeof(LMC_TRACEMAGIC) - 1] = { 0 };
+    FILE* file = fopen(path, "rb");
+    size_t length = 0;
+
+    if (!file) lmc_err("%s", path);
+    if (fread(magic, sizeof(char), sizeof(magic), file) < sizeof(magic)
+        || memcmp(magic, LMC_TRACEMAGIC, sizeof(magic))
+        || getc(file) != LMC_TRACEVERSION
+        || !lmc_traceGet(file, &length) || length >= PATH_MAX
+        || fread(program, sizeof(char), length, file) < length)
+        lmc_malformed(path);
+    program[length] = '\0';
+    return file;
+}
+
+static int lmc_traceNext(FILE* file, LmcTraceEvent* event)
+{
+    size_t tag = 0, delta = 0;
+    int opcode = 0, argument = 0, address = 0;
+
+    if ((opcode = getc(file)) == EOF) return 0;
+    ungetc(opcode, file);
+    if (!lmc_traceGet(file, &tag)) return -1;
+
+    if ((event->input = tag & 1)) {
+        event->size = tag >> 1;
+        return event->size <= LMC_MAXRAM
+            && fread(event->words, sizeof(LmcRam), event->size, file) == event->size
+            ? 1 : -1;
+    }
+
+    // The differences are decoded as they are encoded by lmc_zigzag().
+    if ((tag >>= 1) >= LMC_MAXRAM
+        || (opcode = getc(file)) == EOF || (argument = getc(file)) == EOF
+        || !lmc_traceGet(file, &delta) || delta >= LMC_MAXRAM
+        || !lmc_traceGet(file, &event->count) || event->count > LMC_TRACERUNS)
+        return -1;
+    event->pc       = event->next + (tag & 1 ? LMC_MAXRAM - (tag + 1) / 2 : tag / 2);
+    event->opcode   = opcode;
+    event->argument = argument;
+    event->acc     += delta & 1 ? LMC_MAXRAM - (delta + 1) / 2 : delta / 2;
+    event->next     = event->pc + 2;
+
+    event->size = 0;
+    for (size_t i = 0; i < event->count; ++i) {
+        if ((address = getc(file)) == EOF || !lmc_traceGet(file, &event->runs[i].length)
+            || address + event->runs[i].length > LMC_MAXRAM)
+            return -1;
+        event->runs[i].address = address;
+        event->size += event->runs[i].length;
+    }
+    return fread(event->words, sizeof(LmcRam), event->size, file) == event->size ? 1 : -1;
+}
+
+static bool lmc_traceGet(FILE* file, size_t* value)
+{
+    int c = 0;
+
+    *value = 0;
+    for (unsigned int shift = 0; shift < sizeof(size_t) * CHAR_BIT && (c = getc(file)) != EOF; shift += 7) {
+        *value |= (size_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+static void lmc_malformed(const char* restrict path)
+{
+    errno = EBADMSG;
+    lmc_err("%s: malformed trace", path);
+}
+
+/** @} */
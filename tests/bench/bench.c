@@ -0,0 +1,671 @@
+/**
+ * @file      bench.c
+ * @version   0.1.0
+ * @brief     LMC benchmarks.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * The benchmarks measure the interpreter per opcode and addressing
+ * mode, the example programs, the bootstrap, the compiler and the
+ * batch mode. Each one is calibrated to last at least the minimum
+ * sample time, then sampled several times; its median, minimum and
+ * median absolute deviation are printed as JSON lines, and compared
+ * with a baseline of the same format.
+ *
+ * Usage: bench [-r SAMPLES] [-t MS] [-b BASELINE] [-s SAVE] [-T PERCENT] [FILTER...]
+ *
+ * The benchmarks are run from the project root, the assets paths being
+ * relative to it. The exit status is @c 1 if a regression is found.
+ */
+
+#include "lmc/library.h"
+#include "lmc/batch.h"
+#include "lmc/metrics.h"
+
+#include <getopt.h>
+
+// clang-format off
+
+/******************************************************************************
+ * @name Benchmarks
+ * @{
+ ******************************************************************************/
+// clang-format on
+
+#define PROGS "tests/assets/programs/"
+
+/**
+ * @enum BenchCaracs
+ * @since 0.1.0
+ * @brief The benchmarks characteristics.
+ */
+typedef enum BenchCaracs {
+    BENCH_SAMPLES   = 10,  /**< Default number of samples. */
+    BENCH_MINTIME   = 20,  /**< Default minimum sample time (ms). */
+    BENCH_TOLERANCE = 10,  /**< Default regression tolerance (%). */
+    BENCH_BODY      = 32,  /**< Instructions per micro-benchmark loop. */
+    BENCH_JOBS      = 256, /**< Programs per batch. */
+    BENCH_MAX       = 64,  /**< Max number of benchmarks. */
+} BenchCaracs;
+
+/**
+ * @struct Bench
+ * @since 0.1.0
+ * @brief A benchmark.
+ */
+typedef struct Bench {
+    const char* name;  /**< The benchmark name. */
+    const char* group; /**< The benchmarks group. */
+    const char* unit;  /**< What is timed: an instruction, a program or
+                        * a source. */
+    void (*run)(const struct Bench* bench, size_t runs); /**< Run the
+                        * benchmark @c runs times. */
+    const char* body;  /**< The micro-benchmark loop body, or the
+                        * program path. */
+    const char* input; /**< The program input. */
+    LmcRam image[LMC_MAXRAM * 2]; /**< The compiled program. */
+    size_t size;       /**< The compiled program size. */
+    size_t bytes;      /**< Bytes processed per run. */
+} Bench;
+
+/**
+ * @struct BenchResult
+ * @since 0.1.0
+ * @brief The counts of a sample.
+ */
+typedef struct BenchResult {
+    double ns;           /**< The sample time (ns). */
+    size_t instructions; /**< The instructions executed. */
+    size_t units;        /**< The units timed. */
+} BenchResult;
+
+/**
+ * @var bench_options
+ * @since 0.1.0
+ * @brief The command-line options.
+ */
+static struct {
+    size_t samples;        /**< Number of samples. */
+    double mintime;        /**< Minimum sample time (ns). */
+    double tolerance;      /**< Regression tolerance (%). */
+    const char* baseline;  /**< The compared results, or @c NULL. */
+    FILE* save;            /**< The results copy, or @c NULL. */
+} bench_options = {
+    .samples   = BENCH_SAMPLES,
+    .mintime   = BENCH_MINTIME * 1e6,
+    .tolerance = BENCH_TOLERANCE,
+};
+
+/**
+ * @var bench_loop
+ * @since 0.1.0
+ * @brief The time and instructions of one run of the empty
+ * micro-benchmark loop (the boot and the loop control), subtracted
+ * from the micro-benchmarks runs.
+ */
+static BenchResult bench_loop = { 0 };
+
+/**
+ * @var bench_files
+ * @since 0.1.0
+ * @brief The generated files, in a private temporary directory
+ * removed at exit by bench_clean().
+ */
+static struct {
+    char dir[PATH_MAX - 16]; /**< The temporary directory, leaving
+                              * room for the files names. */
+    char source[PATH_MAX];   /**< The generated source. */
+    char compiled[PATH_MAX]; /**< The compiled source. */
+    char input[PATH_MAX];    /**< The batch programs input. */
+} bench_files;
+
+/**
+ * @since 0.1.0
+ * @brief Read the benchmark input, for LmcIo::read.
+ * @param context The input left, as a pointer to a string, or @c NULL
+ * for an endless input of zeros.
+ * @param dest The destination.
+ * @param size Max number of bytes to read.
+ * @return The number of bytes read.
+ */
+static size_t bench_read(void* context, LmcRam* dest, size_t size);
+
+/**
+ * @since 0.1.0
+ * @brief Run a compiled program, timed per instruction.
+ * @param bench The benchmark.
+ * @param runs The number of runs.
+ */
+static void bench_program(const Bench* bench, size_t runs);
+
+/**
+ * @since 0.1.0
+ * @brief Compile a source, timed per source.
+ * @param bench The benchmark.
+ * @param runs The number of runs.
+ */
+static void bench_compile(const Bench* bench, size_t runs);
+
+/**
+ * @since 0.1.0
+ * @brief Run a batch of programs, timed per program.
+ * @param bench The benchmark.
+ * @param runs The number of batches.
+ */
+static void bench_batch(const Bench* bench, size_t runs);
+
+/**
+ * @since 0.1.0
+ * @brief Prepare a benchmark program.
+ * @param bench The benchmark, its Bench::body being a loop body
+ * (of #BENCH_BODY instructions at most) or a compiled program path.
+ */
+static void bench_prepare(Bench* bench);
+
+/**
+ * @since 0.1.0
+ * @brief Write a micro-benchmark source, looping 256 times over its
+ * body.
+ * @param path The source path.
+ * @param body The loop body instructions, separated by @c ;, repeated
+ * up to #BENCH_BODY instructions, empty for an empty loop, or @c NULL
+ * for a lone @c stop.
+ * @return The source size.
+ */
+static size_t bench_source(const char* restrict path, const char* restrict body);
+
+/**
+ * @since 0.1.0
+ * @brief Write a large source, filling the memory with commented
+ * instructions.
+ * @param path The source path.
+ * @return The source size.
+ */
+static size_t bench_large(const char* restrict path);
+
+/**
+ * @since 0.1.0
+ * @brief Time a benchmark.
+ * @param bench The benchmark.
+ * @param runs The number of runs.
+ * @return The sample counts.
+ */
+static BenchResult bench_sample(const Bench* bench, size_t runs);
+
+/**
+ * @since 0.1.0
+ * @brief Create the #bench_files directory.
+ */
+static void bench_init(void);
+
+/**
+ * @since 0.1.0
+ * @brief Remove the #bench_files and their directory, for atexit().
+ */
+static void bench_clean(void);
+
+/**
+ * @since 0.1.0
+ * @brief Measure #bench_loop.
+ */
+static void bench_overhead(void);
+
+/**
+ * @since 0.1.0
+ * @brief Calibrate, sample and report a benchmark.
+ * @param bench The benchmark.
+ * @return @c true if the benchmark regressed, otherwise @c false.
+ */
+static bool bench_measure(const Bench* bench);
+
+/**
+ * @since 0.1.0
+ * @brief Find a benchmark in the baseline.
+ * @param name The benchmark name.
+ * @param median The baseline median destination.
+ * @return @c true if found, otherwise @c false.
+ */
+static bool bench_baseline(const char* restrict name, double* median);
+
+/**
+ * @since 0.1.0
+ * @brief Get the median of values.
+ * @param values The values, sorted by the function.
+ * @param count The number of values.
+ * @return The median.
+ */
+static double bench_median(double* values, size_t count);
+
+/**
+ * @since 0.1.0
+ * @brief Compare two doubles, for qsort().
+ * @param a,b The doubles.
+ * @return The comparison.
+ */
+static int bench_cmp(const void* a, const void* b);
+
+/**
+ * @since 0.1.0
+ * @brief Get the monotonic clock time.
+ * @return The time (ns).
+ */
+static double bench_now(void);
+
+/**
+ * @var bench_micros
+ * @since 0.1.0
+ * @brief The micro-benchmarks loop bodies, per opcode and addressing
+ * mode.
+ *
+ * The data is placed at @c 0x20: a value, a pointer to it, the copy,
+ * fill and compare parameters, and a block for @c outs. The X register
+ * is null and the stack is reserved from @c 0xf0. The @c jump and
+ * branches targets are the next instruction, written @c next.
+ */
+static const char* bench_micros[][2] = {
+    { "load/raw", "load x05" },     { "load/var", "load @ x20" },
+    { "load/idx", "load +@ x20" },  { "load/ptr", "load *@ x22" },
+    { "add/raw", "add x05" },       { "add/var", "add @ x20" },
+    { "add/idx", "add +@ x20" },    { "add/ptr", "add *@ x22" },
+    { "sub/raw", "sub x05" },       { "sub/var", "sub @ x20" },
+    { "sub/idx", "sub +@ x20" },    { "sub/ptr", "sub *@ x22" },
+    { "nand/raw", "nand x05" },     { "nand/var", "nand @ x20" },
+    { "nand/idx", "nand +@ x20" },  { "nand/ptr", "nand *@ x22" },
+    { "adc/raw", "adc x05" },       { "adc/var", "adc @ x20" },
+    { "adc/idx", "adc +@ x20" },    { "adc/ptr", "adc *@ x22" },
+    { "sbc/raw", "sbc x05" },       { "sbc/var", "sbc @ x20" },
+    { "sbc/idx", "sbc +@ x20" },    { "sbc/ptr", "sbc *@ x22" },
+    { "store/var", "store @ x20" }, { "store/idx", "store +@ x20" },
+    { "store/ptr", "store *@ x22" },
+    { "jump/raw", "jump next" },    { "brz/raw", "brz next" },
+    { "brn/raw", "brn next" },      { "brc/raw", "brc next" },
+    { "ldx/raw", "ldx x00" },       { "inx-dex", "inx;dex" },
+    { "push-pop", "push;pop" },     { "call-ret", "call sub" },
+    { "copy/raw", "copy x24" },     { "fill/raw", "fill x27" },
+    { "compare/raw", "compare x2a" },
+    { "in/var", "in @ x20" },       { "out/var", "out @ x20" },
+    { "outs/raw", "outs x2d" },     { "outsb/raw", "outsb x2d" },
+};
+
+/**
+ * @var bench_macros
+ * @since 0.1.0
+ * @brief The programs benchmarks: path, input and name.
+ */
+static const char* bench_macros[][3] = {
+    { PROGS "product", "ff ff", "product/ff_ff" },
+    { PROGS "quotient", "7f 01", "quotient/7f_01" },
+    { PROGS "v1_product", "01 01", "bootstrap/v1_product" },
+    { NULL, "", "bootstrap/v1_stop" },
+    { NULL, "", "tiny/v2_stop" },
+};
+
+// clang-format off
+
+/******************************************************************************
+ * @}
+ * Implementation
+ ******************************************************************************/
+// clang-format on
+
+int main(int argc, char** argv)
+{
+    static Bench benches[BENCH_MAX];
+    size_t count = 0;
+    bool regressed = false, selected = false;
+    int option = 0;
+
+    while ((option = getopt(argc, argv, "r:t:b:s:T:")) != -1) {
+        switch (option) {
+        case 'r': bench_options.samples = strtoul(optarg, NULL, 0); break;
+        case 't': bench_options.mintime = strtod(optarg, NULL) * 1e6; break;
+        case 'b': bench_options.baseline = optarg; break;
+        case 's':
+            if (!(bench_options.save = fopen(optarg, "w"))) err(EXIT_FAILURE, "%s", optarg);
+            break;
+        case 'T': bench_options.tolerance = strtod(optarg, NULL); break;
+        default:
+            fprintf(stderr, "Usage: %s [-r SAMPLES] [-t MS] [-b BASELINE] [-s SAVE] [-T PERCENT] [FILTER...]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    bench_options.samples = bench_options.samples ? bench_options.samples : 1;
+    if (bench_options.baseline && access(bench_options.baseline, R_OK)) {
+        warn("%s: no comparison", bench_options.baseline);
+        bench_options.baseline = NULL;
+    }
+
+    bench_init();
+    for (size_t i = 0; i < sizeof(bench_micros) / sizeof(bench_micros[0]); ++i)
+        benches[count++] = (Bench){
+            .name = bench_micros[i][0], .group = "opcodes", .unit = "instruction",
+            .run = bench_program, .body = bench_micros[i][1],
+        };
+    for (size_t i = 0; i < sizeof(bench_macros) / sizeof(bench_macros[0]); ++i)
+        benches[count++] = (Bench){
+            .name = bench_macros[i][2], .group = "programs", .unit = "program",
+            .run = bench_program, .body = bench_macros[i][0], .input = bench_macros[i][1],
+        };
+    benches[count++] = (Bench){ .name = "compile/large", .group = "compiler", .unit = "source", .run = bench_compile, };
+    benches[count++] = (Bench){ .name = "batch/product", .group = "batch", .unit = "program", .run = bench_batch, };
+
+    for (size_t i = 0; i < count; ++i) {
+        // The arguments select the benchmarks by name or group prefix.
+        selected = optind == argc;
+        for (int j = optind; j < argc && !selected; ++j)
+            selected = !strncmp(benches[i].name, argv[j], strlen(argv[j]))
+                || !strcmp(benches[i].group, argv[j]);
+        if (!selected) continue;
+        if (!strcmp(benches[i].unit, "instruction") && !bench_loop.units) bench_overhead();
+        bench_prepare(&benches[i]);
+        regressed |= bench_measure(&benches[i]);
+    }
+
+    if (bench_options.save) fclose(bench_options.save);
+    return regressed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void bench_init(void)
+{
+    const char* tmpdir = getenv("TMPDIR");
+
+    // The files are removed at exit, even when a benchmark fails.
+    snprintf(bench_files.dir, sizeof(bench_files.dir), "%s/lmc-bench.XXXXXX", tmpdir && *tmpdir ? tmpdir : P_tmpdir);
+    if (!mkdtemp(bench_files.dir)) err(EXIT_FAILURE, "could not create the benchmarks directory");
+    snprintf(bench_files.source, sizeof(bench_files.source), "%s/bench.lmc", bench_files.dir);
+    snprintf(bench_files.compiled, sizeof(bench_files.compiled), "%s/bench.bin", bench_files.dir);
+    snprintf(bench_files.input, sizeof(bench_files.input), "%s/bench.in", bench_files.dir);
+    atexit(bench_clean);
+}
+
+static void bench_clean(void)
+{
+    unlink(bench_files.source), unlink(bench_files.compiled), unlink(bench_files.input);
+    rmdir(bench_files.dir);
+}
+
+static size_t bench_read(void* context, LmcRam* dest, size_t size)
+{
+    const char** input = context;
+    size_t length = 0;
+
+    if (!input) return memset(dest, 0, size), size;
+    length = strlen(*input);
+    size = size < length ? size : length;
+    memcpy(dest, *input, size);
+    *input += size;
+    return size;
+}
+
+static void bench_program(const Bench* bench, size_t runs)
+{
+    LmcRun run = { .program = bench->image, .size = bench->size, };
+    LmcError error = { 0 };
+    LmcRam status = 0;
+    const char* input = NULL;
+
+    run.io = (LmcIo){ .read = bench_read, .binary = !bench->input, };
+    for (size_t i = 0; i < runs; ++i) {
+        input = bench->input;
+        run.io.context = bench->input ? &input : NULL;
+        if (lmc_libRun(&run, &status, &error) || status)
+            errx(EXIT_FAILURE, "%s: %s (status %u)", bench->name, error.message, status);
+    }
+}
+
+static void bench_compile(const Bench* bench, size_t runs)
+{
+    LmcError error = { 0 };
+
+    for (size_t i = 0; i < runs; ++i)
+        if (lmc_libCompile(bench_files.source, bench_files.compiled, &error))
+            errx(EXIT_FAILURE, "%s: %s", bench->name, error.message);
+}
+
+static void bench_batch(const Bench* bench, size_t runs)
+{
+    LmcJob jobs[BENCH_JOBS];
+    int output = dup(STDOUT_FILENO), null = open("/dev/null", O_WRONLY);
+
+    for (size_t i = 0; i < BENCH_JOBS; ++i)
+        jobs[i] = (LmcJob){ .program = PROGS "product", .input = bench_files.input, };
+
+    // The results lines are discarded.
+    if (output < 0 || null < 0) err(EXIT_FAILURE, "%s", bench->name);
+    fflush(stdout);
+    dup2(null, STDOUT_FILENO);
+    for (size_t i = 0; i < runs; ++i)
+        if (lmc_batch(NULL, jobs, BENCH_JOBS, 0, 0, false))
+            errx(EXIT_FAILURE, "%s: failed", bench->name);
+    fflush(stdout);
+    dup2(output, STDOUT_FILENO);
+    close(output), close(null);
+}
+
+static void bench_prepare(Bench* bench)
+{
+    LmcError error = { 0 };
+    FILE* file = NULL;
+    const char* path = bench->input ? bench->body : bench_files.compiled;
+
+    if (bench->run == bench_compile) {
+        bench->bytes = bench_large(bench_files.source);
+        return;
+    }
+    if (bench->run == bench_batch) {
+        if (!(file = fopen(bench_files.input, "w"))) err(EXIT_FAILURE, "%s", bench_files.input);
+        fputs("ff ff\n", file);
+        fclose(file);
+        return;
+    }
+
+    if (!strcmp(bench->name, "bootstrap/v1_stop")) {
+        // The version 1 programs are loaded by the bootstrap: start
+        // address, size, then "stop x00".
+        memcpy(bench->image, (LmcRam[]){ 0x30, 0x02, 0x04, 0x00 }, bench->size = 4);
+        return;
+    }
+    // The micro-benchmarks and the tiny program are compiled.
+    if (!path || !bench->input) {
+        bench_source(bench_files.source, bench->input ? NULL : bench->body);
+        if (lmc_libCompile(bench_files.source, path = bench_files.compiled, &error))
+            errx(EXIT_FAILURE, "%s: %s", bench->name, error.message);
+    }
+
+    if (!(file = fopen(path, "rb"))) err(EXIT_FAILURE, "%s", path);
+    bench->size = fread(bench->image, sizeof(LmcRam), sizeof(bench->image), file);
+    fclose(file);
+}
+
+static size_t bench_source(const char* restrict path, const char* restrict body)
+{
+    const char* instruction = body;
+    char line[BUFSIZ] = { 0 }, *label = NULL;
+    unsigned int address = 0x34;
+    size_t size = 0, length = 0;
+    FILE* file = fopen(path, "w");
+
+    if (!file) err(EXIT_FAILURE, "%s", path);
+    fputs(body ? "start @ x30\nldx x00\nstack xf0\n" : "start @ x30\nstop x00\n", file);
+    // The body is repeated, then the loop is counted down from 0x2f.
+    for (unsigned int count = 0; body && *body && count < BENCH_BODY; ++count, address += 2) {
+        length = strcspn(instruction, ";");
+        snprintf(line, sizeof(line), "%.*s", (int)length, instruction);
+        if ((label = strstr(line, " next"))) sprintf(label, " x%02x", address + 2);
+        else if ((label = strstr(line, " sub"))) sprintf(label, " xee");
+        fprintf(file, "%s\n", line);
+        instruction = instruction[length] ? &instruction[length + 1] : body;
+    }
+    if (body) fprintf(
+        file,
+        "load @ x2f\nsub x01\nstore @ x2f\nbrz x%02x\njump x34\nstop x00\n"
+        // The subroutine of call-ret, placed below the stack.
+        "segment xee\nret x00\n"
+        "segment x20\n"
+        "x05 x00\nx20 x00\n"            // the value and its pointer
+        "xd0 xc0\nx10 xc0\nx00 x10\n"   // copy and fill parameters
+        "xc0 xd0\nx10 x10\nx00 x00\n",  // compare, then outs block
+        address + 10
+    );
+    size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+static size_t bench_large(const char* restrict path)
+{
+    size_t size = 0;
+    FILE* file = fopen(path, "w");
+
+    if (!file) err(EXIT_FAILURE, "%s", path);
+    fputs("/* A large source, filling the memory above the ROM. */\nstart @ x20\n", file);
+    for (unsigned int address = 0x20; address < LMC_MAXRAM - 2; address += 2)
+        fprintf(
+            file, "%-5s %s x%02x // %02x: %s\n",
+            address % 8 ? "add" : "load", address % 6 ? "@" : " ", address,
+            address, "the comments are part of the parsed source"
+        );
+    fputs("stop x00\n", file);
+    size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+static BenchResult bench_sample(const Bench* bench, size_t runs)
+{
+    size_t instructions = lmc_metricsCount(LMC_MINSTRUCTIONS);
+    double start = bench_now();
+
+    bench->run(bench, runs);
+    return (BenchResult){
+        .ns           = bench_now() - start,
+        .instructions = lmc_metricsCount(LMC_MINSTRUCTIONS) - instructions,
+        .units        = bench->run == bench_batch ? runs * BENCH_JOBS : runs,
+    };
+}
+
+static void bench_overhead(void)
+{
+    static Bench loop = { .name = "loop/empty", .run = bench_program, .body = "", };
+    double times[bench_options.samples];
+    BenchResult result = { 0 };
+    size_t runs = 1;
+
+    bench_prepare(&loop);
+    while ((result = bench_sample(&loop, runs)).ns < bench_options.mintime) runs *= 2;
+    for (size_t i = 0; i < bench_options.samples; ++i)
+        times[i] = (result = bench_sample(&loop, runs)).ns / runs;
+    bench_loop = (BenchResult){
+        .ns           = bench_median(times, bench_options.samples),
+        .instructions = result.instructions / runs,
+        .units        = 1,
+    };
+}
+
+static bool bench_measure(const Bench* bench)
+{
+    double times[bench_options.samples], deviations[bench_options.samples], median = 0, deviation = 0;
+    double base = 0, change = 0, instructions = 0, nanoseconds = 0;
+    size_t runs = 1, units = 0;
+    BenchResult result = { 0 };
+    bool regressed = false, perinstruction = !strcmp(bench->unit, "instruction");
+    char line[BUFSIZ] = { 0 };
+    int size = 0;
+
+    // The runs are doubled until a sample lasts long enough.
+    while ((result = bench_sample(bench, runs)).ns < bench_options.mintime) runs *= 2;
+    for (size_t i = 0; i < bench_options.samples; ++i) {
+        result = bench_sample(bench, runs);
+        // Only the loop body of the micro-benchmarks is timed, without
+        // the boot and the loop control.
+        if (perinstruction) {
+            units = result.instructions - bench_loop.instructions * runs;
+            result.ns = result.ns > bench_loop.ns * runs ? result.ns - bench_loop.ns * runs : 0;
+        }
+        else units = result.units;
+        times[i] = result.ns / (units ? units : 1);
+    }
+    median = bench_median(times, bench_options.samples);
+    for (size_t i = 0; i < bench_options.samples; ++i)
+        deviations[i] = times[i] > median ? times[i] - median : median - times[i];
+    deviation = bench_median(deviations, bench_options.samples);
+
+    size = snprintf(
+        line, sizeof(line),
+        "{\"name\":\"%s\",\"group\":\"%s\",\"unit\":\"%s\",\"samples\":%zu,\"runs\":%zu,"
+        "\"median\":%.3f,\"min\":%.3f,\"mad\":%.3f",
+        bench->name, bench->group, bench->unit, bench_options.samples, runs,
+        median, times[0], deviation
+    );
+    if (result.instructions) {
+        // The rates are derived from the median time.
+        instructions = perinstruction ? (double)units / runs : (double)result.instructions / result.units;
+        nanoseconds = perinstruction ? median : median / instructions;
+        size += snprintf(
+            &line[size], sizeof(line) - size, ",\"instructions\":%.0f,\"ns_per_instruction\":%.3f,\"mips\":%.3f",
+            instructions, nanoseconds, 1e3 / nanoseconds
+        );
+    }
+    if (!perinstruction)
+        size += snprintf(&line[size], sizeof(line) - size, ",\"per_second\":%.1f", 1e9 / median);
+    if (bench->bytes)
+        size += snprintf(&line[size], sizeof(line) - size, ",\"bytes_per_second\":%.0f", bench->bytes * 1e9 / median);
+
+    // A regression is slower than the baseline median by more than
+    // the tolerance, even at its best sample, to not be mistaken for
+    // noise.
+    if (bench_options.baseline && bench_baseline(bench->name, &base)) {
+        change = (median - base) * 100 / base;
+        regressed = (times[0] - base) * 100 / base > bench_options.tolerance;
+        size += snprintf(
+            &line[size], sizeof(line) - size, ",\"baseline\":%.3f,\"change\":%.1f,\"regression\":%s",
+            base, change, regressed ? "true" : "false"
+        );
+        if (regressed) warnx("%s: %+.1f%% per %s (regression)", bench->name, change, bench->unit);
+    }
+    snprintf(&line[size], sizeof(line) - size, "}\n");
+
+    fputs(line, stdout);
+    fflush(stdout);
+    if (bench_options.save) fputs(line, bench_options.save);
+    return regressed;
+}
+
+static bool bench_baseline(const char* restrict name, double* median)
+{
+    FILE* file = fopen(bench_options.baseline, "r");
+    char* line = NULL, *field = NULL, key[BUFSIZ] = { 0 };
+    size_t size = 0;
+    bool found = false;
+
+    if (!file) return false;
+    snprintf(key, sizeof(key), "{\"name\":\"%s\",", name);
+    while (!found && getline(&line, &size, file) >= 0) {
+        if (strncmp(line, key, strlen(key))) continue;
+        found = (field = strstr(line, "\"median\":")) && sscanf(field, "\"median\":%lf", median) == 1;
+    }
+    free(line);
+    fclose(file);
+    return found;
+}
+
+static double bench_median(double* values, size_t count)
+{
+    qsort(values, count, sizeof(double), bench_cmp);
+    return count % 2 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+static int bench_cmp(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double bench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
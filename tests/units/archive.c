@@ -0,0 +1,141 @@
+/**
+ * @file      archive.c
+ * @version   0.1.0
+ * @brief     LMC unit tests for the archive module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ */
+
+#include "tests/common.h"
+#include "lmc/computer.h"
+#include "lmc/archive.h"
+
+// clang-format off
+
+/******************************************************************************
+ * Preparation
+ ******************************************************************************/
+// clang-format on
+
+#define ARCHIVE   "/tmp/lmc-tests.lmca"
+#define UNPACKED  "/tmp/lmc-tests.d"
+#define DUPLICATE UNPACKED "/copy"
+
+void sccroll_before(void)
+{
+    char* files[] = { PRODUCT, QUOTIENT, DOUBLE, DUPLICATE, };
+    LmcRam content[BUFSIZ];
+    size_t size = test_load(PRODUCT, content);
+    FILE* copy = NULL;
+
+    assert(!mkdir(UNPACKED, 0755) || errno == EEXIST);
+    assert((copy = fopen(DUPLICATE, "wb")));
+    assert(fwrite(content, sizeof(LmcRam), size, copy) == size && !fclose(copy));
+    assert(lmc_pack(ARCHIVE, sizeof(files)/sizeof(*files), files) == EXIT_SUCCESS);
+}
+
+void sccroll_after(void)
+{
+    const char* names[] = { "product", "quotient", "double", "copy", };
+    char path[PATH_MAX];
+
+    for (size_t i = 0; i < sizeof(names)/sizeof(*names); ++i) {
+        snprintf(path, sizeof(path), UNPACKED "/%s", names[i]);
+        unlink(path);
+    }
+    rmdir(UNPACKED);
+    unlink(ARCHIVE);
+}
+
+// clang-format off
+
+/******************************************************************************
+ * Tests
+ ******************************************************************************/
+// clang-format on
+
+SCCROLL_TEST(archive_index)
+{
+    const char* names[] = { "copy", "double", "product", "quotient", };
+    LmcArchive* archive = lmc_archiveOpen(ARCHIVE);
+    LmcRam content[BUFSIZ];
+    const LmcRam* image = NULL;
+    size_t size = 0, stored = 0, names_size = 0;
+
+    // The entries are sorted by name.
+    assert(archive->count == 4);
+    for (size_t i = 0; i < archive->count; ++i) {
+        assert(!strcmp(lmc_archiveName(archive, i), names[i]));
+        names_size += strlen(names[i]) + 1;
+    }
+
+    assert((image = lmc_archiveFind(archive, "product", &size)));
+    assert(size == test_load(PRODUCT, content) && !memcmp(image, content, size));
+    assert(lmc_archiveFind(archive, "copy", &size) == image);
+    assert(!lmc_archiveFind(archive, "foobar", &size));
+
+    // The copy of the product program is stored once.
+    stored = test_load(QUOTIENT, content) + test_load(DOUBLE, content) + size;
+    assert(archive->size == sizeof(LmcArchiveHeader) + 4 * sizeof(LmcArchiveEntry) + names_size + stored);
+    lmc_archiveClose(archive);
+}
+
+SCCROLL_TEST(archive_unpack)
+{
+    const char* files[] = { PRODUCT, QUOTIENT, DOUBLE, };
+    const char* names[] = { "product", "quotient", "double", };
+    LmcRam expected[BUFSIZ], content[BUFSIZ];
+    char path[PATH_MAX];
+    size_t size = 0;
+
+    assert(lmc_unpack(ARCHIVE, UNPACKED) == EXIT_SUCCESS);
+    for (size_t i = 0; i < sizeof(files)/sizeof(*files); ++i) {
+        snprintf(path, sizeof(path), UNPACKED "/%s", names[i]);
+        size = test_load(files[i], expected);
+        assert(test_load(path, content) == size && !memcmp(content, expected, size));
+    }
+}
+
+SCCROLL_TEST(archive_order)
+{
+    LmcRam content[BUFSIZ];
+    size_t size = test_load(ARCHIVE, content);
+    LmcError error = { 0 };
+    jmp_buf handler;
+    FILE* file = NULL;
+
+    // The names must be strictly increasing, for the binary search:
+    // the second entry is given the name of the first one.
+    assert(size < BUFSIZ - 1);
+    memcpy(
+        &content[sizeof(LmcArchiveHeader) + sizeof(LmcArchiveEntry)],
+        &content[sizeof(LmcArchiveHeader)], sizeof(uint32_t)
+    );
+    assert((file = fopen(ARCHIVE, "wb")));
+    assert(fwrite(content, sizeof(LmcRam), size, file) == size && !fclose(file));
+    if (!setjmp(handler)) {
+        lmc_catch(&handler, &error);
+        lmc_archiveOpen(ARCHIVE);
+        assert(false);
+    }
+    assert(error.code == EINVAL && strstr(error.message, "malformed archive"));
+}
+
+SCCROLL_TEST(
+    archive_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob = "03\n08\n" },
+        [STDOUT_FILENO] = { .content.blob = "? >? >18" },
+    }
+)
+{
+    LmcArchive* archive = lmc_archiveOpen(ARCHIVE);
+
+    // The entry is not a file of the working directory.
+    lmc_setArchive(archive);
+    lmc_shell(BOOTSTRAP, "product");
+    lmc_setArchive(NULL);
+    lmc_archiveClose(archive);
+}
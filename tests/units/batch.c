@@ -0,0 +1,187 @@
+/**
+ * @file      batch.c
+ * @version   0.1.0
+ * @brief     LMC unit tests for the batch module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ */
+
+// The pinning test uses the GNU CPU affinity extensions.
+#define _GNU_SOURCE
+#include "tests/common.h"
+#include "lmc/batch.h"
+
+// clang-format off
+
+/******************************************************************************
+ * Preparation
+ ******************************************************************************/
+// clang-format on
+
+#define INPUT    "/tmp/lmc-tests.in"
+#define EXPECTED "/tmp/lmc-tests.out"
+#define MANIFEST "/tmp/lmc-tests.manifest"
+
+/**
+ * @since 0.1.0
+ * @brief Write a file.
+ * @param path The file path.
+ * @param content The file content.
+ */
+static void test_write(const char* path, const char* content)
+{
+    FILE* file = fopen(path, "w");
+    assert(file && fputs(content, file) >= 0 && !fclose(file));
+}
+
+void sccroll_before(void)
+{
+    test_write(INPUT, "03 08\n");
+    test_write(EXPECTED, "18");
+    test_write(MANIFEST,
+        "# product\n"
+        PRODUCT " " INPUT " " EXPECTED "\n"
+        "\n"
+        QUOTIENT " - " EXPECTED "\n"
+    );
+}
+
+void sccroll_after(void)
+{
+    unlink(INPUT);
+    unlink(EXPECTED);
+    unlink(MANIFEST);
+}
+
+/**
+ * @since 0.1.0
+ * @brief Execute jobs in batch, capturing their results.
+ * @param jobs The jobs.
+ * @param count The number of jobs.
+ * @param limit The max number of instructions per program.
+ * @param pinned Pin the workers.
+ * @param result The results destination, of #BUFSIZ bytes.
+ * @return The lmc_batch() status.
+ */
+static int test_batch(const LmcJob* jobs, size_t count, size_t limit, bool pinned, char* result)
+{
+    FILE* capture = tmpfile();
+    int saved = dup(STDOUT_FILENO), status = 0;
+
+    assert(capture && saved >= 0);
+    fflush(stdout);
+    dup2(fileno(capture), STDOUT_FILENO);
+    status = lmc_batch(BOOTSTRAP, jobs, count, 2, limit, pinned);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    rewind(capture);
+    memset(result, 0, BUFSIZ);
+    assert(fread(result, sizeof(char), BUFSIZ - 1, capture) > 0);
+    fclose(capture);
+    return status;
+}
+
+// clang-format off
+
+/******************************************************************************
+ * Tests
+ ******************************************************************************/
+// clang-format on
+
+SCCROLL_TEST(batch_prog)
+{
+    LmcJob jobs[] = {
+        { .program = PRODUCT, .input = INPUT, .expected = EXPECTED, },
+        { .program = DOUBLE,  .input = INPUT, },
+        { .program = PRODUCT, .input = INPUT, .expected = EXPECTED, },
+    };
+    char result[BUFSIZ];
+    char* line = result;
+
+    assert(test_batch(jobs, sizeof(jobs)/sizeof(*jobs), 0, false, result) == EXIT_SUCCESS);
+    // The results are in the jobs order.
+    assert(!strncmp(line, "{\"program\":\"" PRODUCT "\",\"status\":", 13 + strlen(PRODUCT)));
+    assert(strstr(line, "\"output\":\"18\",\"cycles\":"));
+    assert(strstr(line, "\"pass\":true}\n"));
+    assert((line = strchr(line, '\n') + 1) && strstr(line, "{\"program\":\"" DOUBLE "\""));
+    assert(strstr(line, "\"output\":\"0610\","));
+    assert((line = strchr(line, '\n') + 1) && strstr(line, "{\"program\":\"" PRODUCT "\""));
+    assert(!strchr(strchr(line, '\n') + 1, '\n'));
+}
+
+SCCROLL_TEST(batch_manifest)
+{
+    char result[BUFSIZ];
+    size_t count = 0;
+    LmcJob* jobs = lmc_manifest(MANIFEST, &count);
+
+    assert(count == 2);
+    assert(!strcmp(jobs[0].program, PRODUCT) && !strcmp(jobs[0].input, INPUT));
+    assert(!strcmp(jobs[1].program, QUOTIENT) && !jobs[1].input);
+    // The quotient program output differs from the expected one.
+    assert(test_batch(jobs, count, 0, false, result) == EXIT_FAILURE);
+    assert(strstr(result, "\"pass\":true}\n{"));
+    assert(strstr(result, "\"pass\":false}\n"));
+    lmc_manifestFree(jobs, count);
+}
+
+SCCROLL_TEST(
+    batch_limit,
+    .std = {
+        [STDERR_FILENO] = { .content.blob =
+            "batch: the instructions limit (1000) is reached: Timer expired"
+        },
+    }
+)
+{
+    LmcJob jobs[] = { { .program = FOREVER, }, };
+    char result[BUFSIZ];
+
+    assert(test_batch(jobs, 1, 1000, false, result) == EXIT_FAILURE);
+    assert(strstr(result, "\"status\":null,\"output\":\"\",\"cycles\":1000,"));
+}
+
+SCCROLL_TEST(batch_errors)
+{
+    LmcJob jobs[] = {
+        { .program = "foobar", },
+        { .program = PRODUCT, .input = "foobar", },
+        { .program = PRODUCT, .input = INPUT, .expected = "foobar", },
+        { .program = PRODUCT, .input = INPUT, .expected = EXPECTED, },
+    };
+    char result[BUFSIZ];
+
+    // The jobs which cannot be run only fail their own line.
+    assert(test_batch(jobs, sizeof(jobs)/sizeof(*jobs), 0, false, result) == EXIT_FAILURE);
+    assert(strstr(result,
+        "{\"program\":\"foobar\",\"status\":null,\"error\":\"foobar: No such file or directory\"}\n"
+        "{\"program\":\"" PRODUCT "\",\"status\":null,\"error\":\"foobar: No such file or directory\"}\n"
+        "{\"program\":\"" PRODUCT "\",\"status\":null,\"error\":\"foobar: No such file or directory\"}\n"
+        "{\"program\":\"" PRODUCT "\",\"status\":0,"
+    ));
+    assert(strstr(result, "\"pass\":true}\n"));
+}
+
+SCCROLL_TEST(batch_pin)
+{
+    LmcJob jobs[] = {
+        { .program = PRODUCT, .input = INPUT, .expected = EXPECTED, },
+        { .program = PRODUCT, .input = INPUT, .expected = EXPECTED, },
+    };
+    char result[BUFSIZ];
+    cpu_set_t allowed, last;
+    int cpu = CPU_SETSIZE;
+
+    // The workers are pinned to the allowed processors, here only the
+    // last one.
+    assert(!sched_getaffinity(0, sizeof(allowed), &allowed));
+    while (!CPU_ISSET(--cpu, &allowed));
+    CPU_ZERO(&last);
+    CPU_SET(cpu, &last);
+    assert(!sched_setaffinity(0, sizeof(last), &last));
+    assert(test_batch(jobs, sizeof(jobs)/sizeof(*jobs), 0, true, result) == EXIT_SUCCESS);
+    assert(!sched_setaffinity(0, sizeof(allowed), &allowed));
+}
@@ -0,0 +1,115 @@
+/**
+ * @file      binary.c
+ * @version   0.1.0
+ * @brief     LMC unit tests for the binary module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ */
+
+#include "tests/common.h"
+#include "lmc/computer.h"
+#include "lmc/compiler.h"
+
+// clang-format off
+
+/******************************************************************************
+ * Preparation
+ ******************************************************************************/
+// clang-format on
+
+#define COMPILED "/tmp/lmc-tests.bin"
+
+/**
+ * @since 0.1.0
+ * @brief Write a whole file.
+ * @param path The file path.
+ * @param content The content.
+ * @param size The content size.
+ */
+static void test_write(const char* path, const LmcRam* content, size_t size)
+{
+    FILE* file = fopen(path, "wb");
+    assert(file && fwrite(content, sizeof(LmcRam), size, file) == size && !fclose(file));
+}
+
+void sccroll_after(void) { unlink(COMPILED); }
+
+// clang-format off
+
+/******************************************************************************
+ * Tests
+ ******************************************************************************/
+// clang-format on
+
+SCCROLL_TEST(binary_read)
+{
+    LmcRam content[BUFSIZ];
+    LmcBinary binary = { 0 };
+    size_t size = test_load(PRODUCT, content);
+
+    assert(lmc_binaryRead(PRODUCT, content, size, &binary) == 1);
+    assert(binary.entry == 0x30 && binary.count == 1 && binary.size == size);
+    assert(binary.segments[0].address == 0x30);
+    assert(binary.contents + binary.segments[0].size == content + size);
+
+    // The version 1 programs are left to the bootstrap.
+    size = test_load(V1PRODUCT, content);
+    assert(!lmc_binaryRead(V1PRODUCT, content, size, &binary));
+}
+
+SCCROLL_TEST(
+    binary_segments,
+    .std = {
+        [STDOUT_FILENO] = { .content.blob = "4223" },
+    }
+)
+{
+    LmcRam content[BUFSIZ];
+    LmcBinary binary = { 0 };
+    size_t size = 0;
+
+    assert(!lmc_compile(SEGMENTS LMC_EXT, COMPILED));
+    size = test_load(COMPILED, content);
+    assert(lmc_binaryRead(COMPILED, content, size, &binary) == 1 && binary.count == 2);
+    assert(binary.segments[1].address == 0x80 && binary.segments[1].size == 2);
+    // No padding is stored between the segments.
+    assert(size == sizeof(LmcBinaryHeader) + 2 * sizeof(LmcSegment) + 6 + 2);
+    assert(!lmc_shell(BOOTSTRAP, COMPILED));
+}
+
+SCCROLL_TEST(
+    binary_corrupted,
+    .code = { .type = SCCSTATUS, .value = EXIT_FAILURE },
+    .std = {
+        [STDERR_FILENO] = { .content.blob =
+            "binary: " COMPILED ": corrupted program: Bad message"
+        },
+    }
+)
+{
+    LmcRam content[BUFSIZ];
+    size_t size = test_load(PRODUCT, content);
+
+    content[size - 1] ^= 0x01;
+    test_write(COMPILED, content, size);
+    lmc_shell(BOOTSTRAP, COMPILED);
+}
+
+SCCROLL_TEST(
+    binary_truncated,
+    .code = { .type = SCCSTATUS, .value = EXIT_FAILURE },
+    .std = {
+        [STDERR_FILENO] = { .content.blob =
+            "binary: " COMPILED ": truncated program (16 bytes): Exec format error"
+        },
+    }
+)
+{
+    LmcRam content[BUFSIZ];
+
+    test_load(PRODUCT, content);
+    test_write(COMPILED, content, 16);
+    lmc_shell(BOOTSTRAP, COMPILED);
+}
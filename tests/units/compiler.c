@@ -84,8 +84,8 @@ void test_prep(void)
         memset(compname, 0, sizeof(compname));
     }
 
-    program_files[dummycode].content = DUMMYCODE;
-    program_files[dummycode].size = sizeof(char)*DUMMYCODELEN;
+    program_files[dummycode].content = DUMMYBIN;
+    program_files[dummycode].size = sizeof(char)*DUMMYBINLEN;
 }
 
 void lmc_compile_errtests(void) { lmc_compile(PRODUCT LMC_EXT, NULL); }
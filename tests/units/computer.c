@@ -14,6 +14,8 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 // clang-format off
 
@@ -22,6 +24,10 @@
  ******************************************************************************/
 // clang-format on
 
+#define FIFO      "/tmp/lmc-tests.fifo"
+#define TRUNCATED "/tmp/lmc-tests.v1"
+#define REPLACED  "/tmp/lmc-tests.boot"
+
 static const char* bootstrap = NULL;
 static const char* file = NULL;
 
@@ -136,6 +142,122 @@ SCCROLL_TEST(
     test_lmc_shell();
 }
 
+SCCROLL_TEST(
+    v1_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob = "03\n08\n" },
+        [STDOUT_FILENO] = { .content.blob = "? >? >18" },
+    }
+)
+{ assert(!lmc_shell(BOOTSTRAP, V1PRODUCT)); }
+
+SCCROLL_TEST(
+    fifo_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob = "03\n08\n" },
+        [STDOUT_FILENO] = { .content.blob = "? >? >18" },
+    }
+)
+{
+    LmcRam content[BUFSIZ];
+    size_t size = test_load(PRODUCT, content);
+    pid_t writer = 0;
+    int fd = -1, status = 0;
+
+    // The program is not mapped but read from the FIFO at once.
+    assert(!mkfifo(FIFO, 0600));
+    assert((writer = fork()) >= 0);
+    if (!writer) {
+        if ((fd = open(FIFO, O_WRONLY)) < 0 || write(fd, content, size) != (ssize_t)size)
+            _exit(EXIT_FAILURE);
+        _exit(EXIT_SUCCESS);
+    }
+    assert(!lmc_shell(BOOTSTRAP, FIFO));
+    assert(waitpid(writer, &status, 0) == writer && WIFEXITED(status) && !WEXITSTATUS(status));
+    unlink(FIFO);
+}
+
+SCCROLL_TEST(
+    truncated_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob =
+            // The program end, then its input.
+            "10\n3e\n41\n32\n04\n00\n40\n31\n12\n3a\n21\n"
+            "01\n48\n31\n40\n32\n60\n30\n48\n32\n10\n3e\n"
+            "03\n08\n"
+        },
+        [STDOUT_FILENO] = { .content.blob =
+            "? >? >? >? >? >? >? >? >? >? >? >"
+            "? >? >? >? >? >? >? >? >? >? >? >"
+            "? >? >18"
+        },
+        [STDERR_FILENO] = { .content.blob =
+            "computer: " TRUNCATED ": truncated program (10 bytes): Exec format error"
+        },
+    }
+)
+{
+    LmcRam content[BUFSIZ];
+    FILE* truncated = fopen(TRUNCATED, "wb");
+
+    // The program is still executed, the user completing it.
+    test_load(V1PRODUCT, content);
+    assert(truncated && fwrite(content, sizeof(LmcRam), 10, truncated) == 10 && !fclose(truncated));
+    assert(!lmc_shell(BOOTSTRAP, TRUNCATED));
+    unlink(TRUNCATED);
+}
+
+SCCROLL_TEST(
+    cached_bootstrap,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob =
+            "03\n08\n"
+            "02\n05\n"
+            "30\n02\n04\n00\n"
+            "04\n04\n"
+        },
+        [STDOUT_FILENO] = { .content.blob =
+            "? >? >18"
+            "? >? >0a"
+            "? >? >? >? >ffff"
+            "? >? >10"
+        },
+    }
+)
+{
+    // The programs share the loaded bootstrap, replaced when another
+    // one is given.
+    assert(!lmc_shell(BOOTSTRAP, PRODUCT));
+    assert(!lmc_shell(BOOTSTRAP, PRODUCT));
+    assert(!lmc_shell(ALTBOOTSTRAP, NULL));
+    assert(!lmc_shell(BOOTSTRAP, PRODUCT));
+}
+
+SCCROLL_TEST(
+    replaced_bootstrap,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob = "03\n08\n" "30\n02\n04\n00\n" },
+        [STDOUT_FILENO] = { .content.blob = "? >? >18" "? >? >? >? >ffff" },
+    }
+)
+{
+    const char* sources[] = { BOOTSTRAP, ALTBOOTSTRAP };
+    LmcRam content[BUFSIZ];
+    size_t size = 0;
+    FILE* copy = NULL;
+
+    // The cached bootstrap is loaded again once its file is replaced
+    // under the same path.
+    for (int i = 0; i < 2; ++i) {
+        size = test_load(sources[i], content);
+        assert((copy = fopen(REPLACED ".new", "wb")));
+        assert(fwrite(content, sizeof(LmcRam), size, copy) == size && !fclose(copy));
+        assert(!rename(REPLACED ".new", REPLACED));
+        assert(!lmc_shell(REPLACED, i ? NULL : PRODUCT));
+    }
+    unlink(REPLACED);
+}
+
 SCCROLL_TEST(
     div_by_zero,
     .std = {
@@ -145,6 +267,132 @@ SCCROLL_TEST(
 )
 { assert(lmc_shell(BOOTSTRAP, QUOTIENT) == 1); }
 
+SCCROLL_TEST(
+    data_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob = "03 08\n07 zz\t07" },
+        [STDOUT_FILENO] = { .content.blob = "1831" },
+        [STDERR_FILENO] = { .content.blob =
+            "computer: Not a valid hexadecimal value: 'zz': Invalid argument"
+        },
+    }
+)
+{
+    lmc_setData("-", false);
+    bootstrap = BOOTSTRAP;
+    file = PRODUCT;
+    test_lmc_shell();
+    test_lmc_shell();
+}
+
+SCCROLL_TEST(
+    pipe_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob = "03\n08\n" },
+        [STDOUT_FILENO] = { .content.blob = "? >? >60" },
+    }
+)
+{
+    char* files[] = { PRODUCT, DOUBLE, DOUBLE };
+    lmc_pipeline(BOOTSTRAP, sizeof(files)/sizeof(char*), files);
+}
+
+SCCROLL_TEST(
+    pipe_data_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob = "03 08 10" },
+        [STDOUT_FILENO] = { .content.blob = "0c2040" },
+    }
+)
+{
+    char* files[] = { DOUBLE, DOUBLE };
+    lmc_setData("-", false);
+    lmc_pipeline(BOOTSTRAP, sizeof(files)/sizeof(char*), files);
+}
+
+SCCROLL_TEST(session_prog)
+{
+    enum { count = 8 };
+    LmcSession* sessions[count] = { 0 };
+    int in[count][2] = { 0 }, out[count][2] = { 0 };
+    char result[BUFSIZ] = { 0 };
+
+    for (int i = 0; i < count; ++i) {
+        assert(!pipe(in[i]) && !pipe(out[i]));
+        sessions[i] = lmc_sessionOpen(BOOTSTRAP, PRODUCT, in[i][0], out[i][1]);
+        // The second word is split, thus the session is suspended.
+        assert(write(in[i][1], "03\n0", 4) == 4);
+    }
+    for (int i = 0; i < count; ++i) assert(lmc_sessionResume(sessions[i]));
+    for (int i = 0; i < count; ++i) {
+        assert(write(in[i][1], "8\n", 2) == 2);
+        close(in[i][1]);
+    }
+
+    lmc_schedule(sessions, count, 3);
+    for (int i = 0; i < count; ++i) {
+        assert(!lmc_sessionClose(sessions[i]));
+        assert(read(out[i][0], result, BUFSIZ) == 8);
+        assert(!strncmp(result, "? >? >18", 8));
+    }
+}
+
+SCCROLL_TEST(
+    session_invalid,
+    .std = {
+        [STDERR_FILENO] = { .content.blob =
+            "computer: Not a valid hexadecimal value: 'zz': Invalid argument\n"
+            "computer: Not a valid hexadecimal value: 'x0': Invalid argument\n"
+            "computer: Not a valid hexadecimal value: 'x1': Invalid argument\n"
+            "computer: Not a valid hexadecimal value: 'x2': Invalid argument\n"
+            "computer: Not a valid hexadecimal value: 'x3': Invalid argument\n"
+            "computer: Not a valid hexadecimal value: 'x4': Invalid argument\n"
+            "computer: Not a valid hexadecimal value: 'x5': Invalid argument\n"
+            "computer: Not a valid hexadecimal value: 'x6': Invalid argument\n"
+            "computer: Not a valid hexadecimal value: 'x7': Invalid argument\n"
+            "computer: too many invalid values, stopping"
+        },
+    }
+)
+{
+    const char* inputs[] = { "03 zz 08", "03 x0 x1 x2 x3 x4 x5 x6 x7 08" };
+    const char* outputs[] = { "? >? >18", "? >? >" };
+    LmcSession* session = NULL;
+    int in[2] = { 0 }, out[2] = { 0 };
+    char result[BUFSIZ] = { 0 };
+
+    // The invalid words are skipped under the same prompt, but too
+    // many of them stop the session.
+    for (int i = 0; i < 2; ++i) {
+        assert(!pipe(in) && !pipe(out));
+        session = lmc_sessionOpen(BOOTSTRAP, PRODUCT, in[0], out[1]);
+        assert(write(in[1], inputs[i], strlen(inputs[i])) == (ssize_t)strlen(inputs[i]));
+        close(in[1]);
+        lmc_schedule(&session, 1, 1);
+        lmc_sessionClose(session);
+        close(out[1]);
+        assert(read(out[0], result, BUFSIZ) == (ssize_t)strlen(outputs[i]));
+        assert(!strncmp(result, outputs[i], strlen(outputs[i])));
+        close(in[0]), close(out[0]);
+    }
+}
+
+SCCROLL_TEST(
+    data_raw_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob = "\x03\x08\x0f\x03" },
+        [STDOUT_FILENO] = { .content.blob = "1805" },
+    }
+)
+{
+    lmc_setData("-", true);
+    bootstrap = BOOTSTRAP;
+    file = PRODUCT;
+    test_lmc_shell();
+    file = QUOTIENT;
+    test_lmc_shell();
+}
+
 SCCROLL_TEST(
     file_prog_errors_handling,
     .std = {
@@ -215,6 +463,252 @@ SCCROLL_TEST(
 )
 { lmc_shell(BOOTSTRAP, CMDLINE); }
 
+SCCROLL_TEST(
+    stack_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob =
+            "30\n16\n"
+            "1a\nf0\n" // stack   xf0
+            "00\n42\n" // load    x42
+            "0a\n00\n" // push    x00
+            "18\n3e\n" // call    x3e
+            "0b\n00\n" // pop     x00
+            "48\n50\n" // store @ x50
+            "10\n42\n" // jump    x42
+            "01\n23\n" // out     x23 (subroutine)
+            "19\n00\n" // ret     x00
+            "41\n50\n" // out   @ x50
+            "04\n00\n" // stop    x00
+        },
+        [STDOUT_FILENO] = { .content.blob =
+            "? >? >"
+            "? >? >? >? >? >? >? >? >? >? >? >"
+            "? >? >? >? >? >? >? >? >? >? >? >"
+            "2342"
+        },
+     }
+)
+{ assert(!lmc_shell(BOOTSTRAP, CMDLINE)); }
+
+SCCROLL_TEST(
+    stack_error,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob =
+            // Programming error: write in the stack
+            "30\n06\n"
+            "1a\nf0\n" // stack   xf0
+            "48\nf8\n" // store @ xf8 (error)
+            "04\n00\n" // stop    x00
+        },
+        [STDOUT_FILENO] = { .content.blob =
+            "? >? >"
+            "? >? >"
+            "? >? >"
+            "? >? >"
+        },
+        [STDERR_FILENO] = { .content.blob =
+            "computer: f8: stack only: Bad address"
+        },
+     }
+)
+{ lmc_shell(BOOTSTRAP, CMDLINE); }
+
+SCCROLL_TEST(
+    stack_overflow,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob =
+            // Programming error: no stack reserved
+            "30\n04\n"
+            "0a\n00\n" // push x00 (error)
+            "04\n00\n" // stop x00
+        },
+        [STDOUT_FILENO] = { .content.blob =
+            "? >? >"
+            "? >? >"
+            "? >? >"
+        },
+        [STDERR_FILENO] = { .content.blob =
+            "computer: ff: stack overflow: Bad address"
+        },
+     }
+)
+{ lmc_shell(BOOTSTRAP, CMDLINE); }
+
+SCCROLL_TEST(
+    stack_underflow,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob =
+            // Programming error: return with an empty stack
+            "30\n06\n"
+            "1a\nf0\n" // stack xf0
+            "19\n00\n" // ret   x00 (error)
+            "04\n00\n" // stop  x00
+        },
+        [STDOUT_FILENO] = { .content.blob =
+            "? >? >"
+            "? >? >"
+            "? >? >"
+            "? >? >"
+        },
+        [STDERR_FILENO] = { .content.blob =
+            "computer: 00: stack underflow: Bad address"
+        },
+     }
+)
+{ lmc_shell(BOOTSTRAP, CMDLINE); }
+
+SCCROLL_TEST(
+    block_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob =
+            "30\n1c\n"
+            "28\n40\n"         // copy      x40
+            "2a\n43\n"         // fill      x43
+            "29\n49\n"         // compare   x49
+            "12\n3a\n"         // brz       x3a
+            "04\n01\n"         // stop      x01
+            "41\n62\n"         // out     @ x62
+            "41\n64\n"         // out     @ x64
+            "04\n00\n"         // stop      x00
+            "60\n46\n03\n"     // 40 copy parameters
+            "63\naa\n02\n"     // 43 fill parameters
+            "11\n22\n33\n"     // 46 data
+            "60\n46\n03\n"     // 49 compare parameters
+        },
+        [STDOUT_FILENO] = { .content.blob =
+            "? >? >"
+            "? >? >? >? >? >? >? >? >? >? >? >? >? >? >"
+            "? >? >? >? >? >? >? >? >? >? >? >? >? >? >"
+            "33aa"
+        },
+     }
+)
+{ assert(!lmc_shell(BOOTSTRAP, CMDLINE)); }
+
+SCCROLL_TEST(
+    block_rom_error,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob =
+            // Programming error: fill the ROM
+            "30\n07\n"
+            "2a\n34\n"     // fill x34 (error)
+            "04\n00\n"     // stop x00
+            "10\n00\n04\n" // 34 fill parameters
+        },
+        [STDOUT_FILENO] = { .content.blob =
+            "? >? >"
+            "? >? >"
+            "? >? >"
+            "? >? >? >"
+        },
+        [STDERR_FILENO] = { .content.blob =
+            "computer: 10: read only: Bad address"
+        },
+     }
+)
+{ lmc_shell(BOOTSTRAP, CMDLINE); }
+
+SCCROLL_TEST(
+    block_io_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob =
+            "30\n11\n"
+            "2c\n40\n" // ins  x40
+            "2d\n40\n" // outs x40
+            "04\n00\n" // stop x00
+            "00\n00\n00\n00\n00\n00\n00\n00\n00\n00\n"
+            "03\n"     // 40 block length
+            "aa\nbb\ncc\n"
+        },
+        [STDOUT_FILENO] = { .content.blob =
+            "? >? >"
+            "? >? >? >? >? >? >? >? >? >? >? >? >? >? >? >? >? >"
+            "? >"
+            "aabbcc"
+        },
+     }
+)
+{ assert(!lmc_shell(BOOTSTRAP, CMDLINE)); }
+
+SCCROLL_TEST(
+    indexed_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob =
+            "30\n14\n"
+            "02\n03\n"         // ldx      x03
+            "81\n40\n"         // out   +@ x40
+            "06\n00\n"         // dex      x00
+            "a0\n40\n"         // add   +@ x40
+            "48\n44\n"         // store  @ x44
+            "41\n44\n"         // out    @ x44
+            "04\n00\n"         // stop     x00
+            "00\n00\n"         // 3e
+            "11\n22\n33\n44\n" // 40 array
+        },
+        [STDOUT_FILENO] = { .content.blob =
+            "? >? >"
+            "? >? >? >? >? >? >? >? >? >? >"
+            "? >? >? >? >? >? >? >? >? >? >"
+            "4433"
+        },
+     }
+)
+{ assert(!lmc_shell(BOOTSTRAP, CMDLINE)); }
+
+SCCROLL_TEST(
+    carry_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob =
+            // 0x01ff + 0x0001 = 0x0200
+            "30\n16\n"
+            "00\nff\n" // load    xff
+            "20\n01\n" // add     x01
+            "13\n38\n" // brc     x38
+            "04\n01\n" // stop    x01
+            "48\n50\n" // store @ x50
+            "00\n01\n" // load    x01
+            "30\n00\n" // adc     x00
+            "48\n51\n" // store @ x51
+            "41\n51\n" // out   @ x51
+            "41\n50\n" // out   @ x50
+            "04\n00\n" // stop    x00
+        },
+        [STDOUT_FILENO] = { .content.blob =
+            "? >? >"
+            "? >? >? >? >? >? >? >? >? >? >? >"
+            "? >? >? >? >? >? >? >? >? >? >? >"
+            "0200"
+        },
+     }
+)
+{ assert(!lmc_shell(BOOTSTRAP, CMDLINE)); }
+
+SCCROLL_TEST(
+    borrow_prog,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob =
+            // 0x0200 - 0x0001 = 0x01ff
+            "30\n12\n"
+            "00\n00\n" // load    x00
+            "21\n01\n" // sub     x01
+            "48\n50\n" // store @ x50
+            "00\n02\n" // load    x02
+            "31\n00\n" // sbc     x00
+            "48\n51\n" // store @ x51
+            "41\n51\n" // out   @ x51
+            "41\n50\n" // out   @ x50
+            "04\n00\n" // stop    x00
+        },
+        [STDOUT_FILENO] = { .content.blob =
+            "? >? >"
+            "? >? >? >? >? >? >? >? >? >"
+            "? >? >? >? >? >? >? >? >? >"
+            "01ff"
+        },
+     }
+)
+{ assert(!lmc_shell(BOOTSTRAP, CMDLINE)); }
+
 SCCROLL_TEST(
     notanumber_errors_handling,
     .std = {
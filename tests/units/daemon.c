@@ -0,0 +1,282 @@
+/**
+ * @file      daemon.c
+ * @version   0.1.0
+ * @brief     LMC unit tests for the daemon module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ */
+
+#include "tests/common.h"
+#include "lmc/daemon.h"
+
+#include <dirent.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+// clang-format off
+
+/******************************************************************************
+ * Preparation
+ ******************************************************************************/
+// clang-format on
+
+#define SOCKET    "/tmp/lmc-tests.sock"
+#define CORRUPTED "/tmp/lmc-tests.bad"
+
+static pid_t daemon_pid = 0;
+
+void sccroll_before(void)
+{
+    if (!(daemon_pid = fork())) exit(lmc_daemon(SOCKET, BOOTSTRAP, 2, 1, 1000));
+    assert(daemon_pid > 0);
+}
+
+void sccroll_after(void)
+{
+    kill(daemon_pid, SIGTERM);
+    waitpid(daemon_pid, NULL, 0);
+    unlink(SOCKET);
+}
+
+/**
+ * @since 0.1.0
+ * @brief Send a request to a daemon.
+ * @param path The daemon socket path.
+ * @param header The request header line.
+ * @param program The compiled program file path.
+ * @param input The program input.
+ * @return The connection, shut down for writing.
+ */
+static int test_send(const char* path, const char* header, const char* program, const char* input)
+{
+    struct sockaddr_un address = { .sun_family = AF_UNIX, };
+    char image[LMC_MAXRAM] = { 0 };
+    FILE* file = fopen(program, "rb");
+    size_t size = fread(image, sizeof(char), LMC_MAXRAM, file);
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    fclose(file);
+    strcpy(address.sun_path, path);
+    // The daemon may not be listening yet.
+    while (connect(client, (struct sockaddr*)&address, sizeof(address))) usleep(1000);
+    assert(write(client, header, strlen(header)) == (ssize_t)strlen(header));
+    assert(write(client, image, size) == (ssize_t)size);
+    assert(write(client, input, strlen(input)) == (ssize_t)strlen(input));
+    shutdown(client, SHUT_WR);
+    return client;
+}
+
+/**
+ * @since 0.1.0
+ * @brief Read the whole daemon answer, then close the connection.
+ * @param client The connection.
+ * @param result The daemon answer destination, of #BUFSIZ bytes.
+ */
+static void test_answer(int client, char* result)
+{
+    ssize_t done = 0, total = 0;
+
+    while ((done = read(client, &result[total], BUFSIZ - total - 1)) > 0) total += done;
+    result[total] = '\0';
+    close(client);
+}
+
+/**
+ * @since 0.1.0
+ * @brief Send a program and its input to the daemon.
+ * @param header The request header line.
+ * @param program The compiled program file path.
+ * @param input The program input.
+ * @param result The daemon answer destination, of #BUFSIZ bytes.
+ */
+static void test_request(const char* header, const char* program, const char* input, char* result)
+{
+    test_answer(test_send(SOCKET, header, program, input), result);
+}
+
+/**
+ * @since 0.1.0
+ * @brief List the running worker processes of a daemon.
+ * @param supervisor The daemon supervisor process.
+ * @param workers The workers destination.
+ * @param max The max number of workers.
+ * @return The number of workers found.
+ */
+static size_t test_workers(pid_t supervisor, pid_t* workers, size_t max)
+{
+    DIR* proc = opendir("/proc");
+    struct dirent* entry = NULL;
+    char path[PATH_MAX] = { 0 };
+    FILE* file = NULL;
+    pid_t pid = 0, parent = 0;
+    char state = 0;
+    size_t count = 0;
+
+    assert(proc);
+    while (count < max && (entry = readdir(proc))) {
+        if ((pid = atoi(entry->d_name)) <= 0) continue;
+        snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+        if (!(file = fopen(path, "r"))) continue;
+        // The stopped workers are not counted until restarted.
+        if (fscanf(file, "%*d (%*[^)]) %c %d", &state, &parent) == 2 && parent == supervisor && state != 'Z')
+            workers[count++] = pid;
+        fclose(file);
+    }
+    closedir(proc);
+    return count;
+}
+
+// clang-format off
+
+/******************************************************************************
+ * Tests
+ ******************************************************************************/
+// clang-format on
+
+SCCROLL_TEST(daemon_prog)
+{
+    char result[BUFSIZ] = { 0 };
+
+    test_request("\n", PRODUCT, "03 08", result);
+    assert(!strcmp(result, "18\n00\n"));
+    test_request("0\n", QUOTIENT, "ff\n00\n", result);
+    assert(!strcmp(result, "\n01\n"));
+    // The status at the end of the input depends on the microcodes.
+    test_request("\n", DOUBLE, "01 02 03", result);
+    assert(!strncmp(result, "020406\n", 7));
+}
+
+SCCROLL_TEST(
+    daemon_limit,
+    .std = {
+        [STDERR_FILENO] = { .content.blob =
+            "daemon: the instructions limit (1000) is reached: Timer expired"
+        },
+    }
+)
+{
+    char result[BUFSIZ] = { 0 };
+
+    // The request limit cannot exceed the daemon one.
+    test_request("1000000\n", FOREVER, "", result);
+    assert(!strcmp(result, "\n--\n"));
+}
+
+SCCROLL_TEST(
+    daemon_request_limit,
+    .std = {
+        [STDERR_FILENO] = { .content.blob =
+            "daemon: the instructions limit (10) is reached: Timer expired"
+        },
+    }
+)
+{
+    char result[BUFSIZ] = { 0 };
+    test_request("10\n", FOREVER, "", result);
+    assert(!strcmp(result, "\n--\n"));
+}
+
+SCCROLL_TEST(
+    daemon_header,
+    .std = {
+        [STDERR_FILENO] = { .content.blob =
+            "daemon: invalid request header: Protocol error"
+        },
+    }
+)
+{
+    char result[BUFSIZ] = { 0 };
+
+    // The invalid requests are closed without status.
+    test_request("ten\n", PRODUCT, "03 08", result);
+    assert(!strcmp(result, ""));
+}
+
+SCCROLL_TEST(
+    daemon_corrupted,
+    .std = {
+        [STDERR_FILENO] = { .content.blob =
+            "daemon: session: corrupted program: Bad message"
+        },
+    }
+)
+{
+    char result[BUFSIZ] = { 0 };
+    LmcRam image[BUFSIZ];
+    size_t size = test_load(PRODUCT, image);
+    FILE* file = fopen(CORRUPTED, "wb");
+
+    image[size - 1] ^= 0x01;
+    assert(file && fwrite(image, sizeof(LmcRam), size, file) == size);
+    fclose(file);
+    // The rejected program is answered with an error instead of a
+    // status.
+    test_request("\n", CORRUPTED, "03 08", result);
+    unlink(CORRUPTED);
+    assert(!strcmp(result, "\nerror: invalid program\n"));
+}
+
+SCCROLL_TEST(daemon_restart)
+{
+    char result[BUFSIZ] = { 0 };
+    pid_t pid = 0, workers[2] = { 0 }, restarted[2] = { 0 };
+    int status = 0;
+
+    // The workers orphaned by the supervisor are adopted by the test,
+    // to check how they are stopped.
+    assert(!prctl(PR_SET_CHILD_SUBREAPER, 1));
+    if (!(pid = fork())) {
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        // The restart warning holds the worker pid.
+        assert(freopen("/dev/null", "w", stderr));
+        exit(lmc_daemon(SOCKET ".restart", BOOTSTRAP, 2, 1, 0));
+    }
+    assert(pid > 0);
+
+    // A killed worker is replaced by a new process, and the daemon
+    // still answers.
+    test_answer(test_send(SOCKET ".restart", "\n", PRODUCT, "03 08"), result);
+    while (test_workers(pid, workers, 2) < 2) usleep(1000);
+    kill(workers[0], SIGKILL);
+    do usleep(1000);
+    while (test_workers(pid, restarted, 2) < 2 || restarted[0] == workers[0] || restarted[1] == workers[0]);
+    test_answer(test_send(SOCKET ".restart", "\n", PRODUCT, "03 08"), result);
+    assert(!strcmp(result, "18\n00\n"));
+
+    // The workers are stopped with their supervisor.
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    for (size_t i = 0; i < 2; ++i) {
+        assert(waitpid(restarted[i], &status, 0) == restarted[i]);
+        assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGTERM);
+    }
+    unlink(SOCKET ".restart");
+}
+
+SCCROLL_TEST(daemon_yield)
+{
+    struct pollfd forever = { .events = POLLIN, };
+    char result[BUFSIZ] = { 0 };
+    pid_t pid = 0;
+
+    // A single worker thread, with the default limit, stopped with
+    // the test even if it fails.
+    if (!(pid = fork())) {
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        exit(lmc_daemon(SOCKET ".yield", BOOTSTRAP, 0, 1, 0));
+    }
+    assert(pid > 0);
+
+    // The long computation lets the other sessions of its thread run.
+    forever.fd = test_send(SOCKET ".yield", "\n", FOREVER, "");
+    test_answer(test_send(SOCKET ".yield", "\n", PRODUCT, "03 08"), result);
+    assert(!strcmp(result, "18\n00\n"));
+    assert(!poll(&forever, 1, 0));
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    close(forever.fd);
+    unlink(SOCKET ".yield");
+}
@@ -0,0 +1,242 @@
+/**
+ * @file      hooks.c
+ * @version   0.1.0
+ * @brief     LMC unit tests for the instrumentation hooks.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * The hooks are only compiled if the _HOOKS macro is defined (see the
+ * tests-hooks recipe), which is the only one building these tests.
+ */
+
+#include "tests/common.h"
+#include "lmc/library.h"
+
+// clang-format off
+
+/******************************************************************************
+ * Preparation
+ ******************************************************************************/
+// clang-format on
+
+#define COMPILED "/tmp/lmc-hooks.bin"
+
+/**
+ * @struct TestEvents
+ * @since 0.1.0
+ * @brief The events recorded by the test hooks.
+ */
+typedef struct TestEvents {
+    size_t fetches;      /**< Instructions fetched. */
+    size_t operands;     /**< Operands resolved. */
+    LmcRam last[3];      /**< Last operand: opcode, address, value. */
+    size_t reads;        /**< Memory bytes read. */
+    size_t writes;       /**< Memory bytes written. */
+    LmcRam input[8];     /**< Input words. */
+    size_t inputs;       /**< Number of input words. */
+    LmcRam output[8];    /**< Output words. */
+    size_t outputs;      /**< Number of output words. */
+    int halted;          /**< Number of halts. */
+    LmcRam status;       /**< The halt status. */
+} TestEvents;
+
+/**
+ * @since 0.1.0
+ * @brief Count the instructions fetched, for LmcHooks::fetch.
+ * @param context The #TestEvents.
+ * @param pc The instruction address.
+ */
+static void test_fetch(void* context, LmcRam pc)
+{
+    TestEvents* events = context;
+    (void) pc, ++events->fetches;
+}
+
+/**
+ * @since 0.1.0
+ * @brief Count the memory bytes read, for LmcHooks::read.
+ * @param context The #TestEvents.
+ * @param address The section address.
+ * @param length The section length.
+ */
+static void test_memread(void* context, unsigned int address, size_t length)
+{
+    TestEvents* events = context;
+    (void) address, events->reads += length;
+}
+
+/**
+ * @since 0.1.0
+ * @brief Count the memory bytes written, for LmcHooks::write.
+ * @param context The #TestEvents.
+ * @param address The section address.
+ * @param length The section length.
+ */
+static void test_memwrite(void* context, unsigned int address, size_t length)
+{
+    TestEvents* events = context;
+    (void) address, events->writes += length;
+}
+
+/**
+ * @since 0.1.0
+ * @brief Record the last operand, for LmcHooks::operand.
+ * @param context The #TestEvents.
+ * @param opcode The instruction opcode.
+ * @param address The operand address.
+ * @param value The operand value.
+ */
+static void test_operand(void* context, LmcRam opcode, LmcRam address, LmcRam value)
+{
+    TestEvents* events = context;
+    ++events->operands;
+    events->last[0] = opcode, events->last[1] = address, events->last[2] = value;
+}
+
+/**
+ * @since 0.1.0
+ * @brief Record the input words, for LmcHooks::input.
+ * @param context The #TestEvents.
+ * @param words The words.
+ * @param size The number of words.
+ */
+static void test_input(void* context, const LmcRam* words, size_t size)
+{
+    TestEvents* events = context;
+    memcpy(&events->input[events->inputs], words, size);
+    events->inputs += size;
+}
+
+/**
+ * @since 0.1.0
+ * @brief Record the output words, for LmcHooks::output.
+ * @param context The #TestEvents.
+ * @param words The words.
+ * @param size The number of words.
+ */
+static void test_output(void* context, const LmcRam* words, size_t size)
+{
+    TestEvents* events = context;
+    memcpy(&events->output[events->outputs], words, size);
+    events->outputs += size;
+}
+
+/**
+ * @since 0.1.0
+ * @brief Record the halt, for LmcHooks::halt.
+ * @param context The #TestEvents.
+ * @param status The word register value.
+ */
+static void test_halt(void* context, LmcRam status)
+{
+    TestEvents* events = context;
+    ++events->halted, events->status = status;
+}
+
+void sccroll_after(void)
+{
+    unlink(COMPILED);
+    lmc_setHooks(NULL);
+}
+
+// clang-format off
+
+/******************************************************************************
+ * Tests
+ ******************************************************************************/
+// clang-format on
+
+SCCROLL_TEST(hooks_product)
+{
+    LmcRam image[BUFSIZ];
+    const char* input = "03 08";
+    LmcIo io = { .read = test_read, .context = &input, };
+    TestEvents events = { 0 };
+    LmcHooks hooks = {
+        .context = &events,
+        .fetch   = test_fetch,
+        .operand = test_operand,
+        .read    = test_memread,
+        .write   = test_memwrite,
+        .input   = test_input,
+        .output  = test_output,
+        .halt    = test_halt,
+    };
+
+    lmc_setHooks(&hooks);
+    assert(!lmc_execute(NULL, image, test_load(PRODUCT, image), &io, 0));
+
+    // The same instructions as counted by the statistics, the last one
+    // being the halt.
+    assert(events.fetches == 73 && events.operands == 73 && events.writes == 18);
+    assert(events.last[0] == HLT && events.reads > events.fetches);
+    assert(events.inputs == 2 && events.input[0] == 0x03 && events.input[1] == 0x08);
+    assert(events.outputs == 1 && events.output[0] == 0x18);
+    assert(events.halted == 1 && !events.status);
+}
+
+SCCROLL_TEST(hooks_session)
+{
+    const char* input = "03\n08\n";
+    TestEvents events[2] = { 0 };
+    LmcSession* sessions[2] = { 0 };
+    int in[2][2] = { 0 }, out[2] = { 0 };
+
+    // The first session reads its input at once, the second one byte
+    // by byte, thus is suspended and restarted on each input word.
+    for (int i = 0; i < 2; ++i) {
+        LmcHooks hooks = {
+            .context = &events[i],
+            .fetch   = test_fetch,
+            .operand = test_operand,
+            .halt    = test_halt,
+        };
+        lmc_setHooks(&hooks);
+        assert(!pipe(in[i]) && (out[i] = open("/dev/null", O_WRONLY)) >= 0);
+        sessions[i] = lmc_sessionOpen(BOOTSTRAP, PRODUCT, in[i][0], out[i]);
+    }
+    assert(write(in[0][1], input, strlen(input)) == (ssize_t)strlen(input));
+    close(in[0][1]);
+    while (lmc_sessionResume(sessions[0]));
+    for (size_t i = 0; i < strlen(input); ++i) {
+        assert(write(in[1][1], input + i, 1) == 1);
+        lmc_sessionResume(sessions[1]);
+    }
+    close(in[1][1]);
+    while (lmc_sessionResume(sessions[1]));
+
+    // The restarted instructions are reported once, and the sessions
+    // halt once, even if resumed again once stopped.
+    for (int i = 0; i < 2; ++i) {
+        assert(!lmc_sessionResume(sessions[i]) && !lmc_sessionClose(sessions[i]));
+        close(out[i]);
+    }
+    assert(events[0].fetches == events[1].fetches && events[0].operands == events[1].operands);
+    assert(events[0].fetches == 73 && events[0].operands == 73);
+    assert(events[0].halted == 1 && events[1].halted == 1 && !events[1].status);
+}
+
+SCCROLL_TEST(hooks_partial)
+{
+    LmcRam image[BUFSIZ], status = 0;
+    LmcError error = { 0 };
+    LmcRun run = { .program = image, };
+    TestEvents events = { 0 };
+    LmcHooks hooks = { .context = &events, .write = test_memwrite, .halt = test_halt, };
+
+    assert(!lmc_libCompile(SELFMOD LMC_EXT, COMPILED, &error));
+    run.size = test_load(COMPILED, image);
+
+    // The failed ROM write is not reported, and the unset hooks are
+    // skipped.
+    lmc_setHooks(&hooks);
+    assert(!lmc_libRun(&run, &status, &error) && error.code == EFAULT);
+    assert(events.writes == 1 && events.halted == 1 && !events.fetches);
+
+    // The hooks are copied at boot, and removed for the next ones.
+    lmc_setHooks(NULL);
+    assert(!lmc_libRun(&run, &status, &error));
+    assert(events.writes == 1 && events.halted == 1);
+}
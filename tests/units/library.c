@@ -0,0 +1,175 @@
+/**
+ * @file      library.c
+ * @version   0.1.0
+ * @brief     LMC unit tests for the library module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ */
+
+#include "tests/common.h"
+#include "lmc/library.h"
+
+// clang-format off
+
+/******************************************************************************
+ * Preparation
+ ******************************************************************************/
+// clang-format on
+
+#define COMPILED "/tmp/lmc-tests.bin"
+
+/**
+ * @struct TestBuffers
+ * @since 0.1.0
+ * @brief The input and output of a test execution.
+ */
+typedef struct TestBuffers {
+    const char* input;     /**< The input. */
+    size_t size;           /**< The input size left. */
+    char output[BUFSIZ];   /**< The output. */
+    size_t written;        /**< The output size. */
+    size_t max;            /**< Max output size. */
+} TestBuffers;
+
+/**
+ * @since 0.1.0
+ * @brief Read the test input, for LmcIo::read.
+ * @param context The #TestBuffers.
+ * @param dest The destination.
+ * @param size Max number of bytes to read.
+ * @return The number of bytes read.
+ */
+static size_t test_input(void* context, LmcRam* dest, size_t size)
+{
+    TestBuffers* buffers = context;
+    size = size < buffers->size ? size : buffers->size;
+    memcpy(dest, buffers->input, size);
+    buffers->input += size, buffers->size -= size;
+    return size;
+}
+
+/**
+ * @since 0.1.0
+ * @brief Write the test output, for LmcIo::write.
+ * @param context The #TestBuffers.
+ * @param data The data.
+ * @param size The data size.
+ * @return The number of bytes written, less than @p size once
+ * TestBuffers::max is reached.
+ */
+static size_t test_write(void* context, const char* data, size_t size)
+{
+    TestBuffers* buffers = context;
+    size = buffers->written + size > buffers->max ? buffers->max - buffers->written : size;
+    memcpy(&buffers->output[buffers->written], data, size);
+    buffers->written += size;
+    return size;
+}
+
+void sccroll_after(void) { unlink(COMPILED); }
+
+// clang-format off
+
+/******************************************************************************
+ * Tests
+ ******************************************************************************/
+// clang-format on
+
+SCCROLL_TEST(library_run)
+{
+    LmcRam image[BUFSIZ], status = 0xff;
+    TestBuffers buffers = { .input = "03 08", .size = 5, .max = BUFSIZ, };
+    LmcRun run = {
+        .bootstrap = BOOTSTRAP,
+        .program   = image,
+        .size      = test_load(PRODUCT, image),
+        .io        = { .read = test_input, .write = test_write, .context = &buffers, },
+    };
+    LmcError error = { 0 };
+
+    // The output has no prompts.
+    assert(!lmc_libRun(&run, &status, &error) && !error.code && !status);
+    assert(buffers.written == 2 && !memcmp(buffers.output, "18", 2));
+
+    // The raw input bytes, and the default bootstrap.
+    buffers = (TestBuffers){ .input = "\x03\x08", .size = 2, .max = BUFSIZ, };
+    run.io.binary = true, run.bootstrap = NULL;
+    assert(!lmc_libRun(&run, &status, &error));
+    assert(buffers.written == 2 && !memcmp(buffers.output, "18", 2));
+
+    // A closed output shuts down the computer.
+    buffers = (TestBuffers){ .input = "\x03\x08", .size = 2, };
+    assert(!lmc_libRun(&run, &status, &error) && !buffers.written);
+}
+
+SCCROLL_TEST(library_limit)
+{
+    LmcRam image[BUFSIZ], status = 0;
+    LmcRun run = {
+        .bootstrap = BOOTSTRAP,
+        .program   = image,
+        .size      = test_load(FOREVER, image),
+        .limit     = 100,
+    };
+    LmcError error = { 0 };
+
+    assert(!lmc_libRun(&run, &status, &error) && error.code == ETIME);
+    assert(!strcmp(error.message, "the instructions limit (100) is reached: Timer expired"));
+}
+
+SCCROLL_TEST(library_errors)
+{
+    LmcRam image[BUFSIZ], status = 0;
+    LmcRun run = { .bootstrap = "foobar", .program = image, .size = test_load(PRODUCT, image), };
+    LmcError error = { 0 };
+
+    // The fatal errors are returned, and the next executions run.
+    assert(lmc_libRun(&run, &status, &error) == -1 && error.code == ENOENT);
+    assert(!strcmp(error.message, "foobar: could not load bootstrap: No such file or directory"));
+
+    run.bootstrap = BOOTSTRAP;
+    image[run.size - 1] ^= 0x01;
+    assert(lmc_libRun(&run, &status, &error) == -1 && error.code == EBADMSG);
+    assert(!strcmp(error.message, "program: corrupted program: Bad message"));
+
+    image[run.size - 1] ^= 0x01;
+    assert(!lmc_libRun(&run, &status, &error) && !error.code);
+}
+
+SCCROLL_TEST(library_compile)
+{
+    LmcError error = { 0 };
+
+    assert(lmc_libCompile(MALFORMED LMC_EXT, COMPILED, &error) == -1);
+    assert(strstr(error.message, "syntax error"));
+    assert(lmc_libCompile("foobar", COMPILED, &error) == -1 && error.code == ENOENT);
+    assert(!lmc_libCompile(PRODUCT LMC_EXT, COMPILED, &error) && !access(COMPILED, R_OK));
+}
+
+SCCROLL_TEST(library_descriptors)
+{
+    const char* bootstraps[] = { NOSIZEBOOTSTRAP, TRUNCBOOTSTRAP, WRONGBOOTSTRAP, BIGBOOTSTRAP, "foobar", };
+    LmcRam image[BUFSIZ], status = 0;
+    LmcRun run = { .program = image, .size = test_load(PRODUCT, image), };
+    LmcError error = { 0 };
+    jmp_buf handler;
+    int next = dup(STDIN_FILENO);
+
+    // The caught errors close their files: the next descriptor is
+    // still free after them.
+    close(next);
+    for (size_t i = 0; i < sizeof(bootstraps)/sizeof(char*); ++i) {
+        run.bootstrap = bootstraps[i];
+        assert(lmc_libRun(&run, &status, &error) == -1);
+    }
+    assert(lmc_libCompile(PRODUCT LMC_EXT, "/dev/full", &error) == -1 && error.code == ENOSPC);
+    if (!setjmp(handler)) {
+        lmc_catch(&handler, &error);
+        lmc_sessionOpen(BOOTSTRAP, PROGS, STDIN_FILENO, STDOUT_FILENO);
+        assert(false);
+    }
+    assert(error.code == EISDIR);
+    assert(dup(STDIN_FILENO) == next);
+}
@@ -0,0 +1,137 @@
+/**
+ * @file      metrics.c
+ * @version   0.1.0
+ * @brief     LMC unit tests for the live metrics.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ */
+
+#include "tests/common.h"
+#include "lmc/library.h"
+
+// clang-format off
+
+/******************************************************************************
+ * Preparation
+ ******************************************************************************/
+// clang-format on
+
+#define EXPORT "/tmp/lmc-metrics.prom"
+#define REPORT "/tmp/lmc-metrics.txt"
+
+/**
+ * @since 0.1.0
+ * @brief Get the value of a metric.
+ * @param path The metrics file, written by lmc_metricsWrite() if @c
+ * REPORT.
+ * @param metric The metric name.
+ * @return The metric value, @c -1 if not found.
+ */
+static double test_value(const char* path, const char* metric)
+{
+    LmcRam content[BUFSIZ] = { 0 };
+    char line[BUFSIZ] = { 0 };
+    const char* found = NULL;
+    FILE* file = NULL;
+    double value = -1;
+
+    if (!strcmp(path, REPORT)) {
+        assert((file = fopen(REPORT, "w")));
+        lmc_metricsWrite(file);
+        fclose(file);
+    }
+    test_load(path, content);
+    snprintf(line, sizeof(line), "\n%s ", metric);
+    if ((found = strstr((char*)content, line))) sscanf(found + strlen(line), "%lf", &value);
+    return value;
+}
+
+/**
+ * @since 0.1.0
+ * @brief Count a completed program, in a thread.
+ * @param unused Unused.
+ * @return @c NULL.
+ */
+static void* test_count(void* unused)
+{
+    (void) unused;
+    lmc_metricsAdd(LMC_MCOMPLETED, 1);
+    return NULL;
+}
+
+void sccroll_after(void) { unlink(EXPORT), unlink(REPORT); }
+
+// clang-format off
+
+/******************************************************************************
+ * Tests
+ ******************************************************************************/
+// clang-format on
+
+SCCROLL_TEST(metrics_counters)
+{
+    LmcRam image[BUFSIZ];
+    const char* input = "03 08";
+    LmcIo io = { .read = test_read, .context = &input, };
+    size_t size = test_load(PRODUCT, image);
+    double instructions = test_value(REPORT, "lmc_instructions_total");
+    double completed = test_value(REPORT, "lmc_programs_completed_total");
+    double failed = test_value(REPORT, "lmc_programs_failed_total");
+    double inputs = test_value(REPORT, "lmc_input_bytes_total");
+    double outputs = test_value(REPORT, "lmc_output_bytes_total");
+
+    // The program is counted once stopped, with its instructions and
+    // input words.
+    assert(!lmc_execute(NULL, image, size, &io, 0));
+    assert(test_value(REPORT, "lmc_instructions_total") == instructions + 73);
+    assert(test_value(REPORT, "lmc_programs_completed_total") == completed + 1);
+    assert(test_value(REPORT, "lmc_programs_failed_total") == failed);
+    assert(test_value(REPORT, "lmc_input_bytes_total") == inputs + 2);
+    assert(test_value(REPORT, "lmc_output_bytes_total") > outputs);
+
+    // The programs stopped by the limit are failed.
+    input = "03 08";
+    lmc_execute(NULL, image, size, &io, 10);
+    assert(test_value(REPORT, "lmc_instructions_total") == instructions + 83);
+    assert(test_value(REPORT, "lmc_programs_failed_total") == failed + 1);
+
+    lmc_metricsQueue(3);
+    assert(test_value(REPORT, "lmc_queue_depth") == 3);
+    lmc_metricsQueue(-3);
+    assert(!test_value(REPORT, "lmc_queue_depth") && test_value(REPORT, "lmc_mips") >= 0);
+}
+
+SCCROLL_TEST(metrics_slots)
+{
+    size_t completed = lmc_metricsCount(LMC_MCOMPLETED);
+    pthread_t thread;
+
+    // The slots of the stopped threads are reused with their counts.
+    for (size_t i = 0; i < 2 * LMC_METRICSLOTS; ++i) {
+        assert(!pthread_create(&thread, NULL, test_count, NULL));
+        assert(!pthread_join(thread, NULL));
+    }
+    assert(lmc_metricsCount(LMC_MCOMPLETED) == completed + 2 * LMC_METRICSLOTS);
+}
+
+SCCROLL_TEST(metrics_export)
+{
+    struct stat file;
+
+    // Without delay, the file is only written on SIGUSR1 and at the
+    // stop.
+    lmc_metricsStart(EXPORT, 0);
+    assert(stat(EXPORT, &file) && errno == ENOENT);
+    kill(getpid(), SIGUSR1);
+    for (size_t i = 0; i < 1000 && stat(EXPORT, &file); ++i) usleep(1000);
+    assert(test_value(EXPORT, "lmc_queue_depth") == 0);
+
+    unlink(EXPORT);
+    lmc_metricsQueue(1);
+    lmc_metricsStop();
+    assert(test_value(EXPORT, "lmc_queue_depth") == 1);
+    assert(stat(EXPORT ".tmp", &file) && errno == ENOENT);
+    lmc_metricsQueue(-1);
+}
@@ -0,0 +1,196 @@
+/**
+ * @file      shard.c
+ * @version   0.1.0
+ * @brief     LMC unit tests for the shard module.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ */
+
+#include "tests/common.h"
+#include "lmc/shard.h"
+
+// clang-format off
+
+/******************************************************************************
+ * Preparation
+ ******************************************************************************/
+// clang-format on
+
+#define INPUT    "/tmp/lmc-tests.in"
+#define EXPECTED "/tmp/lmc-tests.out"
+
+/**
+ * @since 0.1.0
+ * @brief Write a file.
+ * @param path The file path.
+ * @param content The file content.
+ */
+static void test_write(const char* path, const char* content)
+{
+    FILE* file = fopen(path, "w");
+    assert(file && fputs(content, file) >= 0 && !fclose(file));
+}
+
+void sccroll_before(void)
+{
+    test_write(INPUT, "03 08\n");
+    test_write(EXPECTED, "18");
+}
+
+void sccroll_after(void)
+{
+    unlink(INPUT);
+    unlink(EXPECTED);
+}
+
+/**
+ * @since 0.1.0
+ * @brief Redirect a standard stream to a temporary file.
+ * @param fd The standard stream file descriptor.
+ * @param capture The temporary file.
+ * @return The saved standard stream, to restore with test_restore().
+ */
+static int test_redirect(int fd, FILE* capture)
+{
+    int saved = dup(fd);
+    assert(capture && saved >= 0);
+    fflush(stdout);
+    assert(dup2(fileno(capture), fd) == fd);
+    return saved;
+}
+
+/**
+ * @since 0.1.0
+ * @brief Restore a standard stream redirected by test_redirect().
+ * @param fd The standard stream file descriptor.
+ * @param saved The saved standard stream.
+ */
+static void test_restore(int fd, int saved)
+{
+    fflush(stdout);
+    dup2(saved, fd);
+    close(saved);
+}
+
+/**
+ * @since 0.1.0
+ * @brief Read a temporary file.
+ * @param capture The temporary file, closed.
+ * @param result The content destination, of #BUFSIZ bytes.
+ */
+static void test_capture(FILE* capture, char* result)
+{
+    rewind(capture);
+    memset(result, 0, BUFSIZ);
+    assert(fread(result, sizeof(char), BUFSIZ - 1, capture) > 0);
+    fclose(capture);
+}
+
+// clang-format off
+
+/******************************************************************************
+ * Tests
+ ******************************************************************************/
+// clang-format on
+
+SCCROLL_TEST(shard_prog)
+{
+    LmcJob jobs[] = {
+        { .program = PRODUCT, .input = INPUT, .expected = EXPECTED, },
+        { .program = DOUBLE,  .input = INPUT, },
+        { .program = PRODUCT, .input = INPUT, .expected = EXPECTED, },
+        { .program = DOUBLE,  .input = INPUT, },
+        { .program = PRODUCT, .input = INPUT, .expected = EXPECTED, },
+    };
+    char result[BUFSIZ];
+    char* line = result;
+    FILE* capture = tmpfile();
+    size_t stopped = lmc_metricsCount(LMC_MCOMPLETED) + lmc_metricsCount(LMC_MFAILED);
+    int saved = test_redirect(STDOUT_FILENO, capture);
+    int status = lmc_coordinate(BOOTSTRAP, jobs, sizeof(jobs)/sizeof(*jobs), 2, 2, 1, 0);
+
+    test_restore(STDOUT_FILENO, saved);
+    test_capture(capture, result);
+    assert(status == EXIT_SUCCESS);
+    // The shards results are merged in the jobs order.
+    for (size_t i = 0; i < sizeof(jobs)/sizeof(*jobs); ++i, line = strchr(line, '\n') + 1) {
+        assert(!strncmp(line, "{\"program\":\"", 12));
+        assert(!strncmp(&line[12], jobs[i].program, strlen(jobs[i].program)));
+        assert(strstr(line, i % 2 ? "\"output\":\"0610\"" : "\"pass\":true}\n"));
+    }
+    assert(!*line);
+    // The workers programs are counted in the coordinator metrics.
+    stopped = lmc_metricsCount(LMC_MCOMPLETED) + lmc_metricsCount(LMC_MFAILED) - stopped;
+    assert(stopped == sizeof(jobs)/sizeof(*jobs));
+}
+
+SCCROLL_TEST(shard_worker)
+{
+    char result[BUFSIZ];
+    FILE* input = tmpfile();
+    FILE* capture = tmpfile();
+    int in = 0, out = 0;
+
+    assert(input);
+    fprintf(input,
+        "shard 2\n"
+        PRODUCT " " INPUT " " EXPECTED "\n"
+        QUOTIENT " - " EXPECTED "\n"
+        "shard 1\n"
+        DOUBLE " " INPUT "\n"
+    );
+    rewind(input);
+    in  = test_redirect(STDIN_FILENO, input);
+    out = test_redirect(STDOUT_FILENO, capture);
+    clearerr(stdin);
+    assert(lmc_shardWorker(BOOTSTRAP, 1, 0, false) == EXIT_SUCCESS);
+    test_restore(STDOUT_FILENO, out);
+    test_restore(STDIN_FILENO, in);
+    fclose(input);
+
+    test_capture(capture, result);
+    assert(strstr(result, "\"pass\":true}\n{"));
+    // The shards counters: completed and failed programs,
+    // instructions, input and output bytes.
+    assert(strstr(result, "\"pass\":false}\nend 1 2 0 74 2 2\n{"));
+    assert(strstr(result, "\"output\":\"0610\","));
+    assert(!strcmp(strrchr(result, '}'), "}\nend 0 0 1 14 2 4\n"));
+}
+
+SCCROLL_TEST(shard_replace)
+{
+    LmcJob jobs[] = {
+        { .program = PRODUCT, .input = INPUT, .expected = EXPECTED, },
+        // The expected output cannot be read, which stops the worker.
+        { .program = PRODUCT, .input = INPUT, .expected = "/tmp", },
+        { .program = PRODUCT, .input = INPUT, .expected = EXPECTED, },
+        { .program = PRODUCT, .input = INPUT, .expected = EXPECTED, },
+    };
+    char result[BUFSIZ], errors[BUFSIZ];
+    char* line = result, * stop = errors;
+    FILE* capture = tmpfile();
+    FILE* log = tmpfile();
+    int out = test_redirect(STDOUT_FILENO, capture);
+    int saved = test_redirect(STDERR_FILENO, log);
+    int status = lmc_coordinate(BOOTSTRAP, jobs, sizeof(jobs)/sizeof(*jobs), 1, 4, 1, 0);
+    size_t stops = 0;
+
+    test_restore(STDERR_FILENO, saved);
+    test_restore(STDOUT_FILENO, out);
+    test_capture(capture, result);
+    test_capture(log, errors);
+    assert(status == EXIT_FAILURE);
+    // The other results of the shard are kept or run again, and only
+    // the job stopping the workers is given up.
+    for (size_t i = 0; i < sizeof(jobs)/sizeof(*jobs); ++i, line = strchr(line, '\n') + 1) {
+        assert(!strncmp(line, "{\"program\":\"" PRODUCT "\",\"status\":", 23 + strlen(PRODUCT)));
+        assert(strstr(line, i == 1 ? "\"status\":null,\"error\":\"the worker stopped\"}\n" : "\"pass\":true}\n"));
+    }
+    assert(!*line);
+    // The first worker may stop before sending the first result, run
+    // again alone by the next one.
+    while ((stop = strstr(stop, "stopped (status 1)"))) ++stops, ++stop;
+    assert(stops == LMC_SHARDTRIES || stops == LMC_SHARDTRIES + 1);
+}
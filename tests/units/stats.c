@@ -0,0 +1,126 @@
+/**
+ * @file      stats.c
+ * @version   0.1.0
+ * @brief     LMC unit tests for the execution statistics.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * The statistics are only compiled if the _STATS macro is defined
+ * (see the tests-stats recipe), which is the only one building these
+ * tests.
+ */
+
+#include "tests/common.h"
+#include "lmc/library.h"
+
+// clang-format off
+
+/******************************************************************************
+ * Preparation
+ ******************************************************************************/
+// clang-format on
+
+#define COMPILED "/tmp/lmc-stats.bin"
+#define PROFILE "/tmp/lmc-stats.callgrind"
+
+void sccroll_after(void) { unlink(COMPILED), unlink(PROFILE), unlink(PROFILE ".2"); }
+
+// clang-format off
+
+/******************************************************************************
+ * Tests
+ ******************************************************************************/
+// clang-format on
+
+SCCROLL_TEST(stats_product)
+{
+    LmcRam image[BUFSIZ];
+    const char* input = "03 08";
+    LmcIo io = { .read = test_read, .context = &input, };
+    LmcStats stats = { 0 };
+
+    lmc_execute(NULL, image, test_load(PRODUCT, image), &io, 0);
+    lmc_getStats(&stats);
+
+    // The program starts on its variables, executed as "load 00".
+    assert(stats.cycles == 73 && stats.opcodes[LOAD] == 2 && stats.opcodes[HLT] == 1);
+    assert(stats.opcodes[LOAD | VAR] == 17 && stats.opcodes[ADD | VAR] == 8);
+    assert(stats.opcodes[BRZ] == 9 && stats.taken == 1 && stats.untaken == 8);
+    assert(stats.inputs == 2 && stats.outputs == 1 && !stats.faults);
+    assert(stats.writes == 18 && stats.selfmod == 18 && stats.seconds > 0);
+}
+
+SCCROLL_TEST(stats_selfmod)
+{
+    LmcRam image[BUFSIZ], status = 0;
+    LmcError error = { 0 };
+    LmcRun run = { .program = image, };
+    LmcStats stats = { 0 };
+
+    assert(!lmc_libCompile(SELFMOD LMC_EXT, COMPILED, &error));
+    run.size = test_load(COMPILED, image);
+    assert(!lmc_libRun(&run, &status, &error) && error.code == EFAULT);
+    lmc_getStats(&stats);
+
+    // The failed ROM write is not counted.
+    assert(stats.cycles == 3 && stats.opcodes[LOAD] == 1 && stats.opcodes[STORE | VAR] == 2);
+    assert(stats.writes == 1 && stats.selfmod == 1 && stats.faults == 1);
+    assert(!stats.inputs && !stats.outputs && !stats.taken && !stats.untaken);
+}
+
+SCCROLL_TEST(stats_session)
+{
+    const char* input = "03\n08\n";
+    LmcSession* sessions[2] = { 0 };
+    int in[2][2] = { 0 }, out[2] = { 0 };
+
+    // The first session reads its input at once, the second one byte
+    // by byte, thus is suspended and restarted on each input word.
+    for (int i = 0; i < 2; ++i) {
+        assert(!pipe(in[i]) && (out[i] = open("/dev/null", O_WRONLY)) >= 0);
+        sessions[i] = lmc_sessionOpen(BOOTSTRAP, PRODUCT, in[i][0], out[i]);
+    }
+    assert(write(in[0][1], input, strlen(input)) == (ssize_t)strlen(input));
+    close(in[0][1]);
+    while (lmc_sessionResume(sessions[0]));
+    for (size_t i = 0; i < strlen(input); ++i) {
+        assert(write(in[1][1], input + i, 1) == 1);
+        lmc_sessionResume(sessions[1]);
+    }
+    close(in[1][1]);
+    while (lmc_sessionResume(sessions[1]));
+
+    // The restarted instructions are counted once.
+    assert(sessions[0]->vm.stats.cycles == sessions[1]->vm.stats.cycles);
+    assert(sessions[0]->vm.stats.reads == sessions[1]->vm.stats.reads);
+    assert(sessions[0]->vm.stats.inputs == 2 && sessions[1]->vm.stats.inputs == 2);
+    assert(!memcmp(
+        sessions[0]->vm.stats.opcodes, sessions[1]->vm.stats.opcodes,
+        sizeof(sessions[0]->vm.stats.opcodes)
+    ));
+    for (int i = 0; i < 2; ++i) assert(!lmc_sessionClose(sessions[i])), close(out[i]);
+}
+
+SCCROLL_TEST(stats_profile)
+{
+    char content[BUFSIZ] = { 0 };
+    FILE* file = NULL;
+
+    lmc_setProfile(PROFILE);
+    assert(!lmc_shell(NULL, CALLS) && !lmc_shell(NULL, CALLS));
+    lmc_setProfile(NULL);
+    assert(!access(PROFILE ".2", R_OK));
+    assert((file = fopen(PROFILE, "r")));
+    assert(fread(content, sizeof(char), BUFSIZ - 1, file));
+    fclose(file);
+
+    // The instructions are mapped to the source lines, and each call
+    // of the subroutine executes its four instructions.
+    assert(strstr(content, "events: Ir Cycles\nsummary: 13 "));
+    assert(strstr(content, "fl=" CALLS LMC_EXT "\n\nfn=0x30\n0x30 3 1 "));
+    assert(strstr(content, "cfn=0x40\ncalls=1 0x40 13\n0x32 4 4 "));
+    assert(strstr(content, "cfn=0x40\ncalls=1 0x40 13\n0x34 5 4 "));
+    assert(strstr(content, "fn=0x40\n0x40 13 2 "));
+}
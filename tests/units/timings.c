@@ -0,0 +1,77 @@
+/**
+ * @file      timings.c
+ * @version   0.1.0
+ * @brief     LMC unit tests for the host timings.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ *
+ * The timings are only compiled if the _TIMINGS macro is defined (see
+ * the tests-timings recipe), which is the only one building these
+ * tests.
+ */
+
+#include "tests/common.h"
+#include "lmc/library.h"
+
+// clang-format off
+
+/******************************************************************************
+ * Preparation
+ ******************************************************************************/
+// clang-format on
+
+#define COMPILED "/tmp/lmc-timings.bin"
+#define REPORT "/tmp/lmc-timings.txt"
+
+/**
+ * @since 0.1.0
+ * @brief Get the count of a timer in the report.
+ * @param report The report.
+ * @param timer The timer name.
+ * @return The timer count, @c 0 if not reported.
+ */
+static size_t test_count(const char* report, const char* timer)
+{
+    char line[BUFSIZ] = { 0 };
+    size_t count = 0;
+
+    snprintf(line, sizeof(line), "\n%s ", timer);
+    if (!(report = strstr(report, line))) return 0;
+    sscanf(report + strlen(line), "%zu", &count);
+    return count;
+}
+
+void sccroll_after(void) { unlink(COMPILED), unlink(REPORT); }
+
+// clang-format off
+
+/******************************************************************************
+ * Tests
+ ******************************************************************************/
+// clang-format on
+
+SCCROLL_TEST(timings_report)
+{
+    LmcRam image[BUFSIZ], report[BUFSIZ] = { 0 };
+    const char* input = "03 08";
+    LmcIo io = { .read = test_read, .context = &input, };
+    LmcError error = { 0 };
+    FILE* file = NULL;
+
+    assert(!lmc_execute(NULL, image, test_load(PRODUCT, image), &io, 0));
+    assert(!lmc_libCompile(PRODUCT LMC_EXT, COMPILED, &error));
+    assert((file = fopen(REPORT, "w")));
+    lmc_timingsReport(file);
+    fclose(file);
+    test_load(REPORT, report);
+
+    // The phases are timed for each instruction, and the third one
+    // only after the instructions with an argument.
+    assert(!strncmp((char*)report, "timer (ns) ", 11));
+    assert(test_count((char*)report, "phaseOne") == 73 && test_count((char*)report, "phaseTwo") == 73);
+    assert(test_count((char*)report, "phaseThree") == 62);
+    assert(test_count((char*)report, "busInput") == 2 && test_count((char*)report, "busOutput") == 1);
+    assert(test_count((char*)report, "yyparse") == 1 && test_count((char*)report, "compilerWrite") == 1);
+}
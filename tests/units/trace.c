@@ -0,0 +1,80 @@
+/**
+ * @file      trace.c
+ * @version   0.1.0
+ * @brief     LMC unit tests for the execution traces.
+ * @author    Alexandre Martos
+ * @email     contact@amartos.fr
+ * @copyright 2023 Alexandre Martos <contact@amartos.fr>
+ * @license   GPLv3
+ */
+
+#include "tests/common.h"
+#include "lmc/library.h"
+
+// clang-format off
+
+/******************************************************************************
+ * Preparation
+ ******************************************************************************/
+// clang-format on
+
+#define TRACE "/tmp/lmc-trace.bin"
+#define TEXT "/tmp/lmc-trace.txt"
+
+void sccroll_after(void) { unlink(TRACE), unlink(TRACE ".2"), unlink(TEXT); }
+
+// clang-format off
+
+/******************************************************************************
+ * Tests
+ ******************************************************************************/
+// clang-format on
+
+SCCROLL_TEST(trace_print)
+{
+    LmcRam image[BUFSIZ], content[BUFSIZ] = { 0 };
+    const char* input = "03 08";
+    LmcIo io = { .read = test_read, .context = &input, };
+    size_t lines = 0, size = 0;
+    FILE* file = NULL;
+
+    lmc_setTrace(TRACE);
+    assert(!lmc_execute(NULL, image, test_load(PRODUCT, image), &io, 0));
+    lmc_setTrace(NULL);
+    assert((file = fopen(TEXT, "w")));
+    assert(lmc_tracePrint(TRACE, file) == EXIT_SUCCESS);
+    fclose(file);
+
+    // The 73 instructions and the 2 inputs follow the unknown program.
+    size = test_load(TEXT, content);
+    for (size_t i = 0; i < size; ++i) lines += content[i] == '\n';
+    assert(lines == 76);
+    assert(strstr((char*)content, "program: -\n30: 00 00  load       acc 00\n"));
+    assert(strstr((char*)content, "input: 08\n36: 49 31  in @       acc 00  [31] 08\n"));
+    assert(strstr((char*)content, "42: 21 01  sub        acc 07\n44: 48 31  store @    acc 07  [31] 07\n"));
+}
+
+SCCROLL_TEST(
+    trace_replay,
+    .std = {
+        [STDIN_FILENO]  = { .content.blob = "03\n08\n" },
+        [STDOUT_FILENO] = { .content.blob = "? >? >1818" },
+    }
+)
+{
+    LmcRam first[BUFSIZ], second[BUFSIZ];
+    char program[PATH_MAX] = { 0 };
+    size_t size = 0;
+
+    lmc_setTrace(TRACE);
+    assert(!lmc_shell(BOOTSTRAP, PRODUCT));
+    // The input is replayed without prompts.
+    lmc_setReplay(TRACE, program);
+    assert(!strcmp(program, PRODUCT) && !lmc_shell(BOOTSTRAP, program));
+    lmc_setTrace(NULL);
+    lmc_setData(NULL, false);
+
+    // The replay executes the same instructions.
+    size = test_load(TRACE, first);
+    assert(size == test_load(TRACE ".2", second) && !memcmp(first, second, size));
+}